@@ -6,27 +6,49 @@
 #include <unistd.h>
 
 struct MarketData {
+    uint64_t sequence;
     uint64_t timestamp;
     double price;
     uint32_t volume;
 };
 
+// The server sends struct.pack('QQdI'): 28 packed bytes, while sizeof(MarketData)
+// is 32 with padding, so fields are copied from their wire offsets.
+constexpr size_t WIRE_SIZE = 28;
+
 // Parsing function (works on raw bytes, no extra allocations)
 inline MarketData parse(const char* buffer) {
     MarketData data;
-    std::memcpy(&data, buffer, sizeof(MarketData));
+    std::memcpy(&data.sequence, buffer, 8);
+    std::memcpy(&data.timestamp, buffer + 8, 8);
+    std::memcpy(&data.price, buffer + 16, 8);
+    std::memcpy(&data.volume, buffer + 24, 4);
     return data;
 }
 
+// TCP may return fewer bytes than asked for
+inline bool read_exact(int sock, char* buffer, size_t size) {
+    while (size > 0) {
+        ssize_t n = read(sock, buffer, size);
+        if (n <= 0) return false;
+        buffer += n;
+        size -= n;
+    }
+    return true;
+}
+
 int main() {
-    char buffer[sizeof(MarketData)];
+    // One read() per message is the simple version; orderbook/feed_handler.h
+    // batches many messages per syscall, and orderbook/tick_store.h replays
+    // recorded ticks from columnar blocks instead of rows.
+    char buffer[WIRE_SIZE];
     int sock = socket(AF_INET, SOCK_STREAM, 0);
     // Assume already connected...
 
     auto start = std::chrono::high_resolution_clock::now();
 
     for (int i = 0; i < 1000000; i++) {
-        read(sock, buffer, sizeof(buffer));
+        if (!read_exact(sock, buffer, sizeof(buffer))) break;
         MarketData md = parse(buffer);
         // Decision logic here (fast math, no heap allocation)
     }
@@ -1,19 +1,24 @@
 # market_data_server.py
+import random
 import socket
 import struct
+import sys
 import time
 
 HOST = 'localhost'
 PORT = 5555
 
-def generate_market_data():
+# A and B lines of the redundant multicast feed ("multicast" mode)
+LINES = [('239.255.0.1', 30001), ('239.255.0.2', 30001)]
+
+def generate_market_data(sequence):
     """Generates infinite market data packets"""
     timestamp = int(time.time() * 1e9)  # nanosecond precision
     price = 100.0 + (time.time() % 10)  # oscillating price
     volume = 100
-    return struct.pack('QdI', timestamp, price, volume)  # 8+8+4 = 20 bytes
+    return struct.pack('QQdI', sequence, timestamp, price, volume)  # 8+8+8+4 = 28 bytes
 
-def main():
+def serve_tcp():
     with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
         s.bind((HOST, PORT))
         s.listen()
@@ -22,12 +27,35 @@ def main():
         conn, addr = s.accept()
         with conn:
             print(f"Connected by {addr}")
+            sequence = 0
             try:
                 while True:
-                    data = generate_market_data()
+                    data = generate_market_data(sequence)
                     conn.sendall(data)
+                    sequence += 1
             except (ConnectionResetError, BrokenPipeError):
                 print("Client disconnected")
 
+def serve_multicast(loss):
+    """Sends every message on both lines, each copy dropped with probability loss"""
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        s.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+        s.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+        print(f"Python Market Data Server sending to {LINES} (loss {loss})")
+        sequence = 0
+        while True:
+            data = generate_market_data(sequence)
+            for line in LINES:
+                if random.random() >= loss:
+                    s.sendto(data, line)
+            sequence += 1
+            time.sleep(0.0001)
+
+def main():
+    if len(sys.argv) > 1 and sys.argv[1] == 'multicast':
+        serve_multicast(float(sys.argv[2]) if len(sys.argv) > 2 else 0.0)
+    else:
+        serve_tcp()
+
 if __name__ == "__main__":
     main()
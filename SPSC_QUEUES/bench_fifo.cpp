@@ -0,0 +1,231 @@
+// Throughput and round-trip latency of the FIFOs in this directory.
+//
+//   g++ -std=c++20 -O3 -march=native -pthread bench_fifo.cpp -o bench_fifo
+//   ./bench_fifo [producer_core] [consumer_core] [ops]
+//
+// Cores default to 0 and 1 (-1 leaves a thread unpinned); ops defaults to 10M.
+// Fifo1 is not threadsafe, so it is only measured pushing and popping on a
+// single thread, as the floor the threadsafe designs are compared against.
+
+#include "spsc_q1.cpp"
+#include "spsc_q2.cpp"
+#include "spsc_q3.h"
+#include "huge_page_allocator.h"
+#include "shm_fifo.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Element of a chosen size; the first word carries the sequence number
+template<size_t Bytes>
+struct Payload {
+    static_assert(Bytes >= sizeof(uint64_t));
+    uint64_t seq;
+    char pad[Bytes - sizeof(uint64_t)];
+};
+
+/// The obvious alternative: a bounded std::deque behind a std::mutex
+template<typename T>
+class MutexFifo {
+public:
+    explicit MutexFifo(size_t capacity) : capacity_{capacity} {}
+
+    bool push(T const& value) {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (queue_.size() == capacity_) return false;
+        queue_.push_back(value);
+        return true;
+    }
+
+    bool pop(T& value) {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (queue_.empty()) return false;
+        value = queue_.front();
+        queue_.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<T> queue_;
+    size_t capacity_;
+};
+
+/// ShmFifo behind the constructor the benches use: each instance gets a
+/// fresh segment, mapped by both threads of this process
+template<typename T>
+class SegmentFifo : public ShmFifo<T> {
+public:
+    explicit SegmentFifo(size_t capacity) : ShmFifo<T>{next_name(), capacity} {}
+
+private:
+    static std::string next_name() {
+        static int count = 0;
+        return "/bench_fifo." + std::to_string(getpid()) + "." + std::to_string(count++);
+    }
+};
+
+void pin(int core) {
+    if (core < 0) return;
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+        std::cerr << "warning: could not pin to core " << core << "\n";
+    }
+}
+
+struct Options {
+    int producer_core = 0;
+    int consumer_core = 1;
+    uint64_t ops = 10'000'000;
+};
+
+void report(std::string const& name, size_t bytes, size_t capacity, double ops_per_sec,
+            std::vector<int64_t>* rtt = nullptr) {
+    std::cout << std::left << std::setw(12) << name << std::right
+              << std::setw(7) << bytes << std::setw(10) << capacity
+              << std::setw(14) << std::fixed << std::setprecision(2) << ops_per_sec / 1e6;
+    if (rtt && !rtt->empty()) {
+        std::sort(rtt->begin(), rtt->end());
+        auto pct = [&](double p) { return (*rtt)[static_cast<size_t>(p * (rtt->size() - 1))]; };
+        std::cout << std::setw(10) << pct(0.50) << std::setw(10) << pct(0.99) << std::setw(10) << pct(0.999);
+    }
+    std::cout << "\n";
+}
+
+/// One thread pushes ops elements while another pops and checks them
+template<typename Fifo, typename T>
+double throughput(Options const& opt, size_t capacity) {
+    Fifo fifo(capacity);
+    std::thread consumer([&] {
+        pin(opt.consumer_core);
+        T value;
+        for (uint64_t i = 0; i < opt.ops; ++i) {
+            while (!fifo.pop(value)) {}
+            if (value.seq != i) {
+                std::cerr << "out of order: " << value.seq << " != " << i << "\n";
+                std::abort();
+            }
+        }
+    });
+
+    pin(opt.producer_core);
+    T value{};
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < opt.ops; ++i) {
+        value.seq = i;
+        while (!fifo.push(value)) {}
+    }
+    consumer.join();
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    return opt.ops / elapsed.count();
+}
+
+/// Ping-pong through two fifos; each sample is one full round trip in ns
+template<typename Fifo, typename T>
+std::vector<int64_t> round_trip(Options const& opt, size_t capacity) {
+    const uint64_t samples = std::max<uint64_t>(opt.ops / 100, 1000);
+    Fifo ping(capacity);
+    Fifo pong(capacity);
+
+    std::thread echo([&] {
+        pin(opt.consumer_core);
+        T value;
+        for (uint64_t i = 0; i < samples; ++i) {
+            while (!ping.pop(value)) {}
+            while (!pong.push(value)) {}
+        }
+    });
+
+    pin(opt.producer_core);
+    std::vector<int64_t> rtt;
+    rtt.reserve(samples);
+    T value{};
+    for (uint64_t i = 0; i < samples; ++i) {
+        value.seq = i;
+        auto start = Clock::now();
+        while (!ping.push(value)) {}
+        while (!pong.pop(value)) {}
+        rtt.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+    echo.join();
+    return rtt;
+}
+
+template<typename T>
+double single_thread(Options const& opt, size_t capacity) {
+    Fifo1<T> fifo(capacity);
+    T value{};
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < opt.ops; ++i) {
+        value.seq = i;
+        fifo.push(value);
+        fifo.pop(value);
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    if (value.seq != opt.ops - 1) std::abort();
+    return opt.ops / elapsed.count();
+}
+
+template<size_t Bytes>
+void run_size(Options const& opt, size_t capacity) {
+    using T = Payload<Bytes>;
+    report("Fifo1 (1T)", Bytes, capacity, single_thread<T>(opt, capacity));
+
+    auto rtt = round_trip<MutexFifo<T>, T>(opt, capacity);
+    report("mutex+deque", Bytes, capacity, throughput<MutexFifo<T>, T>(opt, capacity), &rtt);
+
+    rtt = round_trip<Fifo2<T>, T>(opt, capacity);
+    report("Fifo2", Bytes, capacity, throughput<Fifo2<T>, T>(opt, capacity), &rtt);
+
+    rtt = round_trip<Fifo3<T>, T>(opt, capacity);
+    report("Fifo3", Bytes, capacity, throughput<Fifo3<T>, T>(opt, capacity), &rtt);
+
+    // Same ring on prefaulted huge pages local to the constructing thread
+    using HugeFifo3 = Fifo3<T, HugePageAllocator<T>>;
+    rtt = round_trip<HugeFifo3, T>(opt, capacity);
+    report("Fifo3/huge", Bytes, capacity, throughput<HugeFifo3, T>(opt, capacity), &rtt);
+
+    // Same cursor scheme through a shared-memory segment, as between processes
+    rtt = round_trip<SegmentFifo<T>, T>(opt, capacity);
+    report("ShmFifo", Bytes, capacity, throughput<SegmentFifo<T>, T>(opt, capacity), &rtt);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (argc > 1) opt.producer_core = std::atoi(argv[1]);
+    if (argc > 2) opt.consumer_core = std::atoi(argv[2]);
+    if (argc > 3) opt.ops = std::strtoull(argv[3], nullptr, 10);
+
+    std::cout << "producer core " << opt.producer_core << ", consumer core " << opt.consumer_core
+              << ", " << opt.ops << " ops per run\n\n";
+    std::cout << std::left << std::setw(12) << "queue" << std::right
+              << std::setw(7) << "bytes" << std::setw(10) << "capacity"
+              << std::setw(14) << "Mops/s" << std::setw(10) << "p50 ns"
+              << std::setw(10) << "p99 ns" << std::setw(10) << "p99.9 ns" << "\n";
+
+    for (size_t capacity : {size_t{1024}, size_t{65536}}) {
+        run_size<8>(opt, capacity);
+        run_size<64>(opt, capacity);
+        run_size<256>(opt, capacity);
+    }
+    return 0;
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+
+/// Backing memory placed for a latency-critical thread: on huge pages (fewer
+/// TLB misses), on one NUMA node (no remote-node accesses) and faulted in
+/// before it is returned (no page faults on first touch while trading).
+///
+/// Mappings of at least SMALL_LIMIT bytes are rounded to 2 MiB and take
+/// explicit huge pages (MAP_HUGETLB) when the system has them reserved,
+/// falling back to transparent huge pages on an aligned mapping; smaller
+/// ones, and any asked for with huge = false, stay on 4 KiB pages. mbind()
+/// is issued through syscall(2), so nothing links against libnuma.
+namespace huge_pages {
+
+constexpr size_t PAGE = size_t{4} << 10;
+constexpr size_t HUGE_PAGE = size_t{2} << 20;
+constexpr size_t SMALL_LIMIT = HUGE_PAGE / 2;
+
+/// Node argument meaning "the node of the CPU the caller is running on"
+constexpr int LOCAL_NODE = -1;
+
+/// NUMA node of the calling CPU, 0 if the kernel cannot tell
+inline int current_node() noexcept {
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) return 0;
+    return static_cast<int>(node);
+}
+
+/// Bytes actually mapped for a request of `bytes`
+inline size_t mapping_size(size_t bytes, bool huge = true) noexcept {
+    if (bytes == 0) bytes = 1;
+    size_t page = huge && bytes >= SMALL_LIMIT ? HUGE_PAGE : PAGE;
+    return (bytes + page - 1) & ~(page - 1);
+}
+
+/// Binds [address, address + bytes) to `node`; must precede the first touch.
+/// Fails quietly on kernels without NUMA support, leaving first-touch
+/// placement, which the prefault on the calling thread makes local anyway.
+inline void bind(void* address, size_t bytes, int node) noexcept {
+    constexpr int MPOL_PREFERRED = 1;
+    if (node < 0) node = current_node();
+    if (node >= 64) return;
+    unsigned long mask = 1ul << node;
+    syscall(SYS_mbind, address, bytes, MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0);
+}
+
+/// Faults every page of the range in for writing
+inline void prefault(void* address, size_t bytes) noexcept {
+    if (madvise(address, bytes, MADV_POPULATE_WRITE) == 0) return;
+    // Kernels before 5.14: touching each page does the same on fresh memory
+    auto* memory = static_cast<volatile unsigned char*>(address);
+    for (size_t at = 0; at < bytes; at += PAGE) memory[at] = 0;
+}
+
+/// Maps, binds and prefaults mapping_size(bytes, huge) bytes aligned to
+/// their page size. Returns nullptr if the memory cannot be mapped.
+inline void* map(size_t bytes, int node = LOCAL_NODE, bool huge = true) noexcept {
+    const size_t size = mapping_size(bytes, huge);
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    if (huge && size >= HUGE_PAGE) {
+        void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+        if (mapping != MAP_FAILED) {
+            bind(mapping, size, node);
+            prefault(mapping, size);
+            return mapping;
+        }
+
+        // No reserved huge pages: over-map so a 2 MiB aligned run fits, trim
+        // the ends and ask for transparent huge pages on what is left
+        void* raw = mmap(nullptr, size + HUGE_PAGE, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (raw == MAP_FAILED) return nullptr;
+        auto* start = static_cast<unsigned char*>(raw);
+        auto address = reinterpret_cast<uintptr_t>(start);
+        auto* aligned = reinterpret_cast<unsigned char*>((address + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1));
+        if (aligned > start) munmap(start, aligned - start);
+        munmap(aligned + size, start + size + HUGE_PAGE - (aligned + size));
+        madvise(aligned, size, MADV_HUGEPAGE);
+        bind(aligned, size, node);
+        prefault(aligned, size);
+        return aligned;
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (mapping == MAP_FAILED) return nullptr;
+    bind(mapping, size, node);
+    prefault(mapping, size);
+    return mapping;
+}
+
+/// Releases a mapping from map(bytes, node, huge); pass the same bytes and huge
+inline void unmap(void* address, size_t bytes, bool huge = true) noexcept {
+    if (address) munmap(address, mapping_size(bytes, huge));
+}
+
+}
+
+
+/// Standard allocator over huge_pages::map, for the Alloc parameter of
+/// Fifo1/2/3 and SequencedFifo: every allocate() is its own mapping, which
+/// suits a queue's single ring. The node is fixed at construction;
+/// LOCAL_NODE resolves when allocate() runs, so build the queue on (or pin
+/// the constructing thread to) the core that will use it.
+template<typename T>
+class HugePageAllocator
+{
+public:
+    using value_type = T;
+
+    explicit HugePageAllocator(int node = huge_pages::LOCAL_NODE) noexcept
+        : node_{node}
+    {}
+
+    template<typename U>
+    HugePageAllocator(HugePageAllocator<U> const& other) noexcept
+        : node_{other.node()}
+    {}
+
+    T* allocate(size_t count) {
+        void* memory = huge_pages::map(count * sizeof(T), node_);
+        if (memory == nullptr) throw std::bad_alloc();
+        return static_cast<T*>(memory);
+    }
+
+    void deallocate(T* pointer, size_t count) noexcept {
+        huge_pages::unmap(pointer, count * sizeof(T));
+    }
+
+    int node() const noexcept { return node_; }
+
+    template<typename U>
+    bool operator==(HugePageAllocator<U> const& other) const noexcept { return node_ == other.node(); }
+
+private:
+    int node_;
+};
+
+
+/// The same placement as a std::pmr::memory_resource, for the order book's
+/// pools (BookConfig::memory). Requests are served from 2 MiB-or-larger
+/// mappings carved by a bump pointer; freed memory is only returned when the
+/// resource is destroyed, which suits pools that grow to a working size and
+/// then recycle their own slots. Not thread-safe: one resource per book.
+class HugePageResource : public std::pmr::memory_resource
+{
+public:
+    explicit HugePageResource(int node = huge_pages::LOCAL_NODE, size_t slab_bytes = huge_pages::HUGE_PAGE)
+        : node_{node}
+        , slabBytes_{huge_pages::mapping_size(slab_bytes < huge_pages::HUGE_PAGE ? huge_pages::HUGE_PAGE : slab_bytes)}
+    {}
+
+    ~HugePageResource() override {
+        while (slabs_) {
+            Slab* next = slabs_->next;
+            huge_pages::unmap(slabs_, slabs_->size);
+            slabs_ = next;
+        }
+    }
+
+    HugePageResource(HugePageResource const&) = delete;
+    HugePageResource& operator=(HugePageResource const&) = delete;
+
+    /// Maps and prefaults slabs up front so the first `bytes` of requests
+    /// never reach mmap
+    void reserve(size_t bytes) {
+        if (remaining() < bytes) addSlab(bytes);
+    }
+
+    /// Bytes mapped so far
+    size_t mapped() const noexcept { return mapped_; }
+
+private:
+    struct Slab {
+        Slab* next;
+        size_t size;
+    };
+
+    size_t remaining() const noexcept { return slabs_ ? end_ - cursor_ : 0; }
+
+    void addSlab(size_t min_bytes) {
+        size_t size = huge_pages::mapping_size(sizeof(Slab) + alignof(std::max_align_t) + min_bytes);
+        if (size < slabBytes_) size = slabBytes_;
+        auto* slab = static_cast<Slab*>(huge_pages::map(size, node_));
+        if (slab == nullptr) throw std::bad_alloc();
+        slab->next = slabs_;
+        slab->size = size;
+        slabs_ = slab;
+        cursor_ = reinterpret_cast<uintptr_t>(slab + 1);
+        end_ = reinterpret_cast<uintptr_t>(slab) + size;
+        mapped_ += size;
+    }
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        uintptr_t start = (cursor_ + alignment - 1) & ~(uintptr_t{alignment} - 1);
+        if (slabs_ == nullptr || start + bytes > end_) {
+            addSlab(bytes + alignment);
+            start = (cursor_ + alignment - 1) & ~(uintptr_t{alignment} - 1);
+        }
+        cursor_ = start + bytes;
+        return reinterpret_cast<void*>(start);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+
+    int node_;
+    size_t slabBytes_;
+    Slab* slabs_ = nullptr;
+    uintptr_t cursor_ = 0;
+    uintptr_t end_ = 0;
+    size_t mapped_ = 0;
+};
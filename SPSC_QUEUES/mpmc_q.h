@@ -0,0 +1,180 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+
+namespace fifo_detail {
+
+/// One ring slot of a sequenced FIFO. `sequence` says whose turn it is:
+/// equal to the cursor that may push into it next, or that cursor + 1 once
+/// the slot holds a value that may be popped.
+template<typename T, typename SizeType>
+struct SequencedCell
+{
+    std::atomic<SizeType> sequence;
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T* value() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+};
+
+}
+
+
+/// Bounded lock-free multi-producer FIFO (Vyukov-style per-slot sequence numbers)
+///
+/// Producers claim a slot by CAS on the shared push cursor and publish it by
+/// storing its sequence number, so they never wait on each other's copies.
+/// With `MultiConsumer == false` the pop cursor is owned by the one consumer
+/// and advanced with a plain store; with `true` consumers claim slots by CAS
+/// exactly like producers do. Construction, allocation and cursor layout
+/// follow Fifo3. The capacity is rounded up to a power of two.
+template<typename T, bool MultiConsumer, typename Alloc = std::allocator<T>>
+class SequencedFifo
+    : private std::allocator_traits<Alloc>::template rebind_alloc<
+          fifo_detail::SequencedCell<T, typename std::allocator_traits<Alloc>::size_type>>
+{
+public:
+    using value_type = T;
+    using size_type = typename std::allocator_traits<Alloc>::size_type;
+
+private:
+    using Cell = fifo_detail::SequencedCell<T, size_type>;
+    using CellAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Cell>;
+    using cell_traits = std::allocator_traits<CellAlloc>;
+
+public:
+    explicit SequencedFifo(size_type capacity, Alloc const& alloc = Alloc{})
+        : CellAlloc{alloc}
+        , capacity_{std::bit_ceil(capacity)}
+        , mask_{capacity_ - 1}
+        , ring_{cell_traits::allocate(*this, capacity_)}
+    {
+        for (size_type i = 0; i < capacity_; ++i) {
+            new (&ring_[i].sequence) std::atomic<size_type>(i);
+        }
+    }
+
+    SequencedFifo(SequencedFifo const&) = delete;
+    SequencedFifo& operator=(SequencedFifo const&) = delete;
+    SequencedFifo(SequencedFifo&&) = delete;
+    SequencedFifo& operator=(SequencedFifo&&) = delete;
+
+    ~SequencedFifo() {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        for (; popCursor != pushCursor; ++popCursor) {
+            ring_[popCursor & mask_].value()->~T();
+        }
+        cell_traits::deallocate(*this, ring_, capacity_);
+    }
+
+    /// Returns the number of elements in the fifo; only a snapshot while
+    /// other threads are pushing or popping
+    auto size() const noexcept {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        return pushCursor >= popCursor ? pushCursor - popCursor : size_type{0};
+    }
+
+    /// Returns whether the container has no elements
+    auto empty() const noexcept { return size() == 0; }
+
+    /// Returns the number of elements that can be held in the fifo
+    auto capacity() const noexcept { return capacity_; }
+
+
+    /// Push one object onto the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T const& value) { return emplace(value); }
+
+    /// Construct one object in place at the back of the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    template<typename... Args>
+    auto emplace(Args&&... args) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &ring_[pushCursor & mask_];
+            auto sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence - pushCursor);
+            if (diff == 0) {
+                if (pushCursor_.compare_exchange_weak(pushCursor, pushCursor + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // the slot one lap back has not been popped yet
+            } else {
+                pushCursor = pushCursor_.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->storage) T(std::forward<Args>(args)...);
+        cell->sequence.store(pushCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Pop one object from the fifo.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto pop(T& value) {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &ring_[popCursor & mask_];
+            auto sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence - (popCursor + 1));
+            if (diff == 0) {
+                if constexpr (MultiConsumer) {
+                    if (popCursor_.compare_exchange_weak(popCursor, popCursor + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else {
+                    popCursor_.store(popCursor + 1, std::memory_order_relaxed);
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // nothing published in this slot yet
+            } else {
+                assert(MultiConsumer);
+                popCursor = popCursor_.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(*cell->value());
+        cell->value()->~T();
+        cell->sequence.store(popCursor + capacity_, std::memory_order_release);
+        return true;
+    }
+
+private:
+    size_type capacity_;
+    size_type mask_;
+    Cell* ring_;
+
+    using CursorType = std::atomic<size_type>;
+    static_assert(CursorType::is_always_lock_free);
+
+    // See Fifo3 for why std::hardware_destructive_interference_size is not used
+    static constexpr auto hardware_destructive_interference_size = size_type{64};
+
+    /// Claimed by CAS from every push thread
+    alignas(hardware_destructive_interference_size) CursorType pushCursor_;
+
+    /// Advanced by the pop thread(s)
+    alignas(hardware_destructive_interference_size) CursorType popCursor_;
+
+    // Padding to avoid false sharing with adjacent objects
+    char padding_[hardware_destructive_interference_size - sizeof(size_type)];
+};
+
+
+/// Many producers, one consumer: gateway threads feeding one matching thread
+template<typename T, typename Alloc = std::allocator<T>>
+using MpscFifo = SequencedFifo<T, false, Alloc>;
+
+/// Many producers, many consumers: e.g. several matchers feeding a persistence pool
+template<typename T, typename Alloc = std::allocator<T>>
+using MpmcFifo = SequencedFifo<T, true, Alloc>;
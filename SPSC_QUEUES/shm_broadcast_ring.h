@@ -0,0 +1,267 @@
+#pragma once
+
+#include "shm_segment.h"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+
+/// One writer, any number of readers, in POSIX shared memory (shm_open +
+/// mmap), so readers may live in other processes.
+///
+/// The cursor scheme is Fifo3's, turned into a broadcast: the writer owns
+/// the only shared cursor and readers keep theirs privately, each caching
+/// the writer's cursor and reloading it only when it has caught up. Readers
+/// map the segment read-only and never write to it, so adding one costs the
+/// writer nothing, and the writer never waits for a slow one: it overwrites
+/// the oldest slot instead.
+///
+/// Every slot carries the cursor of the element it holds, stamped after the
+/// value is stored and cleared before it is overwritten, with the value
+/// held as relaxed atomic words as in SeqLock. A reader that copied a slot
+/// checks the stamp again afterwards; if the writer lapped it meanwhile, the
+/// copy is discarded and the reader resumes at the oldest element still in
+/// the ring, counting the ones it lost.
+namespace shm_ring {
+
+constexpr uint64_t MAGIC = 0x31474e4952445342ull;  // "BSDRING1"
+
+// N.B. std::hardware_destructive_interference_size is not used, see Fifo3
+constexpr size_t CACHE_LINE = 64;
+
+template<typename T>
+struct Slot {
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    /// Cursor of the element held plus one; 0 while it is being replaced
+    std::atomic<uint64_t> stamp;
+    std::atomic<uint64_t> words[WORDS];
+};
+
+struct Header {
+    /// Stored last by the writer, once the rest is in place
+    std::atomic<uint64_t> magic;
+    uint64_t capacity;
+    uint64_t elementSize;
+    uint64_t slotSize;
+
+    /// Elements ever pushed; stored by the writer only
+    alignas(CACHE_LINE) std::atomic<uint64_t> pushCursor;
+};
+
+template<typename T>
+constexpr size_t slotStride() {
+    return (sizeof(Slot<T>) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+}
+
+template<typename T>
+constexpr size_t segmentSize(size_t capacity) {
+    return sizeof(Header) + capacity * slotStride<T>();
+}
+
+}
+
+
+/// Writer side: creates (or recreates) the segment and publishes into it
+template<typename T>
+class ShmBroadcastWriter
+{
+    static_assert(std::is_trivially_copyable_v<T>, "ShmBroadcastWriter copies elements word by word");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    using Slot = shm_ring::Slot<T>;
+
+public:
+    /// name is a shm_open name ("/trades"). The capacity is rounded up to a
+    /// power of two. Throws std::runtime_error if the segment cannot be
+    /// created, sized or mapped.
+    ShmBroadcastWriter(std::string name, size_t capacity, bool unlinkOnClose = true)
+        : name_{std::move(name)}
+        , capacity_{std::bit_ceil(capacity < 2 ? size_t{2} : capacity)}
+        , mask_{capacity_ - 1}
+        , size_{shm_ring::segmentSize<T>(capacity_)}
+        , unlink_{unlinkOnClose}
+    {
+        void* base = shm_segment::create(name_, size_, "ShmBroadcastWriter");
+
+        // A fresh segment reads as zeros: every stamp empty, cursor at 0
+        header_ = static_cast<shm_ring::Header*>(base);
+        header_->capacity = capacity_;
+        header_->elementSize = sizeof(T);
+        header_->slotSize = shm_ring::slotStride<T>();
+        header_->pushCursor.store(0, std::memory_order_relaxed);
+        header_->magic.store(shm_ring::MAGIC, std::memory_order_release);
+        slots_ = reinterpret_cast<unsigned char*>(base) + sizeof(shm_ring::Header);
+    }
+
+    ~ShmBroadcastWriter() {
+        shm_segment::detach(header_, size_);
+        if (unlink_) shm_segment::remove(name_);
+    }
+
+    ShmBroadcastWriter(ShmBroadcastWriter const&) = delete;
+    ShmBroadcastWriter& operator=(ShmBroadcastWriter const&) = delete;
+
+    /// Publishes one element; never blocks and never fails
+    void push(T const& value) noexcept {
+        write(pushCursor_, value);
+        ++pushCursor_;
+        header_->pushCursor.store(pushCursor_, std::memory_order_release);
+    }
+
+    /// Publishes a run with a single release store of the cursor
+    void push_n(T const* values, size_t count) noexcept {
+        if (count == 0) return;
+        for (size_t i = 0; i < count; ++i) {
+            write(pushCursor_ + i, values[i]);
+        }
+        pushCursor_ += count;
+        header_->pushCursor.store(pushCursor_, std::memory_order_release);
+    }
+
+    /// Elements pushed so far
+    uint64_t cursor() const noexcept { return pushCursor_; }
+
+    auto capacity() const noexcept { return capacity_; }
+
+private:
+    Slot& slot(uint64_t cursor) noexcept {
+        return *reinterpret_cast<Slot*>(slots_ + (cursor & mask_) * shm_ring::slotStride<T>());
+    }
+
+    void write(uint64_t cursor, T const& value) noexcept {
+        uint64_t buffer[Slot::WORDS] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+
+        Slot& s = slot(cursor);
+        s.stamp.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < Slot::WORDS; ++i) {
+            s.words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        s.stamp.store(cursor + 1, std::memory_order_release);
+    }
+
+    std::string name_;
+    size_t capacity_;
+    size_t mask_;
+    size_t size_;
+    bool unlink_;
+    shm_ring::Header* header_;
+    unsigned char* slots_;
+
+    /// Exclusive to the writer; the shared copy is header_->pushCursor
+    uint64_t pushCursor_ = 0;
+};
+
+
+/// Reader side: any number per segment, in any process, one thread each
+template<typename T>
+class ShmBroadcastReader
+{
+    static_assert(std::is_trivially_copyable_v<T>, "ShmBroadcastReader copies elements word by word");
+
+    using Slot = shm_ring::Slot<T>;
+
+public:
+    /// Attaches to a segment made by ShmBroadcastWriter<T>. A reader starts
+    /// at the writer's cursor and sees only what is pushed after it; pass
+    /// fromOldest to start at the oldest element still in the ring. Throws
+    /// std::runtime_error if the segment is missing or not a ring of T.
+    explicit ShmBroadcastReader(std::string const& name, bool fromOldest = false) {
+        void const* base = shm_segment::attach(name, false, sizeof(shm_ring::Header), size_, "ShmBroadcastReader");
+
+        header_ = static_cast<shm_ring::Header const*>(base);
+        const uint64_t magic = header_->magic.load(std::memory_order_acquire);
+        capacity_ = header_->capacity;
+        if (magic != shm_ring::MAGIC || header_->elementSize != sizeof(T) ||
+            header_->slotSize != shm_ring::slotStride<T>() ||
+            !std::has_single_bit(capacity_) || size_ < shm_ring::segmentSize<T>(capacity_)) {
+            shm_segment::detach(base, size_);
+            throw std::runtime_error("ShmBroadcastReader: not a broadcast ring of this type: " + name);
+        }
+        mask_ = capacity_ - 1;
+        slots_ = reinterpret_cast<unsigned char const*>(base) + sizeof(shm_ring::Header);
+
+        pushCursorCached_ = header_->pushCursor.load(std::memory_order_acquire);
+        popCursor_ = fromOldest ? oldest(pushCursorCached_) : pushCursorCached_;
+    }
+
+    ~ShmBroadcastReader() {
+        shm_segment::detach(header_, size_);
+    }
+
+    ShmBroadcastReader(ShmBroadcastReader const&) = delete;
+    ShmBroadcastReader& operator=(ShmBroadcastReader const&) = delete;
+
+    /// Copies the next element into value.
+    /// @return `true` if there was one; `false` if the reader has caught up.
+    /// If the writer lapped the reader, the reader skips to the oldest
+    /// element still held and lost() grows by the number skipped.
+    bool pop(T& value) noexcept {
+        for (;;) {
+            if (popCursor_ == pushCursorCached_) {
+                pushCursorCached_ = header_->pushCursor.load(std::memory_order_acquire);
+                if (popCursor_ == pushCursorCached_) return false;
+            }
+            if (tryRead(popCursor_, value)) {
+                ++popCursor_;
+                return true;
+            }
+            // Overwritten before or while it was copied
+            pushCursorCached_ = header_->pushCursor.load(std::memory_order_acquire);
+            const uint64_t resume = oldest(pushCursorCached_) + 1;  // the oldest may be next to go
+            lost_ += resume - popCursor_;
+            popCursor_ = resume;
+        }
+    }
+
+    /// Cursor of the next element pop() returns: the writer's count of
+    /// elements pushed before it
+    uint64_t cursor() const noexcept { return popCursor_; }
+
+    /// Elements the writer overwrote before this reader got to them
+    uint64_t lost() const noexcept { return lost_; }
+
+    auto capacity() const noexcept { return capacity_; }
+
+private:
+    Slot const& slot(uint64_t cursor) const noexcept {
+        return *reinterpret_cast<Slot const*>(slots_ + (cursor & mask_) * shm_ring::slotStride<T>());
+    }
+
+    uint64_t oldest(uint64_t pushCursor) const noexcept {
+        return pushCursor > capacity_ ? pushCursor - capacity_ : 0;
+    }
+
+    bool tryRead(uint64_t cursor, T& value) const noexcept {
+        Slot const& s = slot(cursor);
+        if (s.stamp.load(std::memory_order_acquire) != cursor + 1) return false;
+
+        uint64_t buffer[Slot::WORDS];
+        for (size_t i = 0; i < Slot::WORDS; ++i) {
+            buffer[i] = s.words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.stamp.load(std::memory_order_relaxed) != cursor + 1) return false;
+
+        std::memcpy(&value, buffer, sizeof(T));
+        return true;
+    }
+
+    shm_ring::Header const* header_;
+    unsigned char const* slots_;
+    size_t size_;
+    uint64_t capacity_;
+    uint64_t mask_;
+
+    uint64_t popCursor_;
+    uint64_t pushCursorCached_;
+    uint64_t lost_ = 0;
+};
@@ -0,0 +1,301 @@
+#pragma once
+
+#include "shm_segment.h"
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+
+/// Fifo3 between processes: the header and the ring live in a named POSIX
+/// shared-memory segment, so the producer and the consumer may be separate
+/// programs.
+///
+/// Nothing in the segment is a pointer, since each process maps it at its
+/// own address: the header records where the ring starts as an offset from
+/// the segment base, and the cursors are plain counts. What each side
+/// caches of the other's cursor stays in its own ShmFifo object, outside
+/// the segment, so the fast path touches shared memory exactly as Fifo3
+/// does.
+namespace shm_fifo {
+
+constexpr uint64_t MAGIC = 0x4f4649464d485350ull;  // "PSHMFIFO"
+constexpr uint32_t VERSION = 1;
+
+// N.B. std::hardware_destructive_interference_size is not used, see Fifo3
+constexpr size_t CACHE_LINE = 64;
+
+struct Header {
+    /// Stored last by the creator, once the rest is in place
+    std::atomic<uint64_t> magic;
+    uint32_t version;
+    uint32_t elementSize;
+    uint64_t elementAlign;
+    uint64_t capacity;
+    uint64_t ringOffset;
+
+    /// Loaded and stored by the producer; loaded by the consumer
+    alignas(CACHE_LINE) std::atomic<uint64_t> pushCursor;
+
+    /// Loaded and stored by the consumer; loaded by the producer
+    alignas(CACHE_LINE) std::atomic<uint64_t> popCursor;
+};
+
+template<typename T>
+constexpr uint64_t ringOffset() {
+    constexpr uint64_t align = alignof(T) > CACHE_LINE ? alignof(T) : CACHE_LINE;
+    return (sizeof(Header) + align - 1) / align * align;
+}
+
+template<typename T>
+constexpr size_t segmentSize(uint64_t capacity) {
+    return ringOffset<T>() + capacity * sizeof(T);
+}
+
+}
+
+
+/// One producer and one consumer, each in any process, one thread each.
+/// T must be trivially copyable: the bytes of an element are all that
+/// crosses, and elements left in the ring are not destroyed.
+template<typename T>
+class ShmFifo
+{
+    static_assert(std::is_trivially_copyable_v<T>, "ShmFifo elements cross processes as bytes");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "cursors must be address-free");
+
+public:
+    using value_type = T;
+    using size_type = uint64_t;
+
+    /// Creates the segment `name` (a shm_open name, "/orders"), replacing
+    /// any old one, and removes it again when this object is destroyed.
+    /// The capacity is rounded up to a power of two. Throws
+    /// std::runtime_error if the segment cannot be created, sized or mapped.
+    ShmFifo(std::string name, size_type capacity)
+        : name_{std::move(name)}
+        , owner_{true}
+    {
+        const size_type rounded = std::bit_ceil(capacity < 2 ? size_type{2} : capacity);
+        size_ = shm_fifo::segmentSize<T>(rounded);
+        base_ = static_cast<unsigned char*>(shm_segment::create(name_, size_, "ShmFifo"));
+
+        // A fresh segment reads as zeros: both cursors at 0
+        auto* header = reinterpret_cast<shm_fifo::Header*>(base_);
+        header->version = shm_fifo::VERSION;
+        header->elementSize = sizeof(T);
+        header->elementAlign = alignof(T);
+        header->capacity = rounded;
+        header->ringOffset = shm_fifo::ringOffset<T>();
+        header->magic.store(shm_fifo::MAGIC, std::memory_order_release);
+        map(header);
+    }
+
+    /// Attaches to a segment created by ShmFifo<T> in another process (or
+    /// this one). Throws std::runtime_error if it is missing or is not a
+    /// fifo of T of this version.
+    explicit ShmFifo(std::string name)
+        : name_{std::move(name)}
+        , owner_{false}
+    {
+        base_ = static_cast<unsigned char*>(
+            shm_segment::attach(name_, true, sizeof(shm_fifo::Header), size_, "ShmFifo"));
+
+        auto* header = reinterpret_cast<shm_fifo::Header*>(base_);
+        const uint64_t magic = header->magic.load(std::memory_order_acquire);
+        if (magic != shm_fifo::MAGIC || header->version != shm_fifo::VERSION ||
+            header->elementSize != sizeof(T) || header->elementAlign != alignof(T) ||
+            header->ringOffset != shm_fifo::ringOffset<T>() || !std::has_single_bit(header->capacity) ||
+            size_ < shm_fifo::segmentSize<T>(header->capacity)) {
+            shm_segment::detach(base_, size_);
+            throw std::runtime_error("ShmFifo: not a fifo of this type: " + name_);
+        }
+        map(header);
+        pushCursorCached_ = pushCursor_->load(std::memory_order_acquire);
+        popCursorCached_ = popCursor_->load(std::memory_order_acquire);
+    }
+
+    // The mapping is owned; the fifo cannot be copied or moved
+    ShmFifo(ShmFifo const&) = delete;
+    ShmFifo& operator=(ShmFifo const&) = delete;
+    ShmFifo(ShmFifo&&) = delete;
+    ShmFifo& operator=(ShmFifo&&) = delete;
+
+    ~ShmFifo() {
+        shm_segment::detach(base_, size_);
+        if (owner_) shm_segment::remove(name_);
+    }
+
+
+    /// Returns the number of elements in the fifo
+    auto size() const noexcept {
+        auto pushCursor = pushCursor_->load(std::memory_order_relaxed);
+        auto popCursor = popCursor_->load(std::memory_order_relaxed);
+        return pushCursor - popCursor;
+    }
+
+    /// Returns whether the container has no elements
+    auto empty() const noexcept { return size() == 0; }
+
+    /// Returns whether the container has capacity() elements
+    auto full() const noexcept { return size() == capacity(); }
+
+    /// Returns the number of elements that can be held in the fifo
+    /// (the requested capacity rounded up to a power of two)
+    auto capacity() const noexcept { return capacity_; }
+
+
+    /// Push one object onto the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T const& value) {
+        auto pushCursor = pushCursor_->load(std::memory_order_relaxed);
+        if (full(pushCursor, popCursorCached_)) {
+            popCursorCached_ = popCursor_->load(std::memory_order_acquire);
+            if (full(pushCursor, popCursorCached_)) {
+                return false;
+            }
+        }
+        new (element(pushCursor)) T(value);
+        pushCursor_->store(pushCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Pop one object from the fifo.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto pop(T& value) {
+        auto popCursor = popCursor_->load(std::memory_order_relaxed);
+        if (empty(pushCursorCached_, popCursor)) {
+            pushCursorCached_ = pushCursor_->load(std::memory_order_acquire);
+            if (empty(pushCursorCached_, popCursor)) {
+                return false;
+            }
+        }
+        value = *element(popCursor);
+        popCursor_->store(popCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Construct one object in place at the back of the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    template<typename... Args>
+    auto emplace(Args&&... args) {
+        auto pushCursor = pushCursor_->load(std::memory_order_relaxed);
+        if (full(pushCursor, popCursorCached_)) {
+            popCursorCached_ = popCursor_->load(std::memory_order_acquire);
+            if (full(pushCursor, popCursorCached_)) {
+                return false;
+            }
+        }
+        new (element(pushCursor)) T(std::forward<Args>(args)...);
+        pushCursor_->store(pushCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Push up to `count` objects from `values` and publish them all with a
+    /// single release store, so the consumer sees the run at once.
+    /// @return the number of objects pushed
+    auto try_push_n(T const* values, size_type count) {
+        auto pushCursor = pushCursor_->load(std::memory_order_relaxed);
+        auto room = capacity_ - (pushCursor - popCursorCached_);
+        if (room < count) {
+            popCursorCached_ = popCursor_->load(std::memory_order_acquire);
+            room = capacity_ - (pushCursor - popCursorCached_);
+        }
+        auto n = room < count ? room : count;
+        for (size_type i = 0; i < n; ++i) {
+            new (element(pushCursor + i)) T(values[i]);
+        }
+        if (n != 0) {
+            pushCursor_->store(pushCursor + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    /// Pop up to `count` objects into `values` and release their slots with
+    /// a single store.
+    /// @return the number of objects popped
+    auto try_pop_n(T* values, size_type count) {
+        auto popCursor = popCursor_->load(std::memory_order_relaxed);
+        auto available = pushCursorCached_ - popCursor;
+        if (available < count) {
+            pushCursorCached_ = pushCursor_->load(std::memory_order_acquire);
+            available = pushCursorCached_ - popCursor;
+        }
+        auto n = available < count ? available : count;
+        for (size_type i = 0; i < n; ++i) {
+            values[i] = *element(popCursor + i);
+        }
+        if (n != 0) {
+            popCursor_->store(popCursor + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    /// Returns the oldest object in place without copying it, or `nullptr`
+    /// if fifo is empty. The object stays valid until consume() is called.
+    T* front() {
+        auto popCursor = popCursor_->load(std::memory_order_relaxed);
+        if (empty(pushCursorCached_, popCursor)) {
+            pushCursorCached_ = pushCursor_->load(std::memory_order_acquire);
+            if (empty(pushCursorCached_, popCursor)) {
+                return nullptr;
+            }
+        }
+        return element(popCursor);
+    }
+
+    /// Removes the object returned by front(); front() must have returned non-null.
+    void consume() {
+        auto popCursor = popCursor_->load(std::memory_order_relaxed);
+        assert(not empty(pushCursorCached_, popCursor));
+        popCursor_->store(popCursor + 1, std::memory_order_release);
+    }
+
+private:
+    void map(shm_fifo::Header* header) noexcept {
+        capacity_ = header->capacity;
+        mask_ = capacity_ - 1;
+        ring_ = reinterpret_cast<T*>(base_ + header->ringOffset);
+        pushCursor_ = &header->pushCursor;
+        popCursor_ = &header->popCursor;
+    }
+
+    auto full(size_type pushCursor, size_type popCursor) const noexcept {
+        return (pushCursor - popCursor) == capacity_;
+    }
+    static auto empty(size_type pushCursor, size_type popCursor) noexcept {
+        return pushCursor == popCursor;
+    }
+    auto element(size_type cursor) noexcept {
+        return &ring_[cursor & mask_];
+    }
+
+private:
+    std::string name_;
+    bool owner_;
+    unsigned char* base_;
+    size_t size_;
+
+    // This process's view of the segment, resolved once from its offsets
+    size_type capacity_;
+    size_type mask_;
+    T* ring_;
+    std::atomic<uint64_t>* pushCursor_;
+    std::atomic<uint64_t>* popCursor_;
+
+    /// Exclusive to the push thread
+    alignas(shm_fifo::CACHE_LINE) size_type popCursorCached_{};
+
+    /// Exclusive to the pop thread
+    alignas(shm_fifo::CACHE_LINE) size_type pushCursorCached_{};
+
+    // Padding to avoid false sharing with adjacent objects
+    char padding_[shm_fifo::CACHE_LINE - sizeof(size_type)];
+};
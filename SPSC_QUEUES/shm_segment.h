@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/// Named POSIX shared-memory segments (shm_open + mmap), for the queues
+/// whose header and ring are shared between processes. Failures throw
+/// std::runtime_error naming the caller (`who`) and the segment.
+namespace shm_segment {
+
+/// Creates the segment, replacing any old one of that name, and maps
+/// `bytes` of it read-write. The new memory reads as zeros.
+inline void* create(std::string const& name, size_t bytes, char const* who) {
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) throw std::runtime_error(std::string{who} + ": cannot open " + name);
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error(std::string{who} + ": cannot size " + name);
+    }
+    void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw std::runtime_error(std::string{who} + ": cannot map " + name);
+    }
+    return base;
+}
+
+/// Maps all of an existing segment, read-only unless writable, and sets
+/// bytes to its size. Fails for segments smaller than min_bytes.
+inline void* attach(std::string const& name, bool writable, size_t min_bytes, size_t& bytes, char const* who) {
+    int fd = shm_open(name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+    if (fd < 0) throw std::runtime_error(std::string{who} + ": cannot open " + name);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < min_bytes) {
+        close(fd);
+        throw std::runtime_error(std::string{who} + ": not a segment of this kind: " + name);
+    }
+    bytes = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) throw std::runtime_error(std::string{who} + ": cannot map " + name);
+    return base;
+}
+
+inline void detach(void const* base, size_t bytes) noexcept {
+    munmap(const_cast<void*>(base), bytes);
+}
+
+inline void remove(std::string const& name) noexcept {
+    shm_unlink(name.c_str());
+}
+
+}
@@ -3,6 +3,7 @@
 #include <cassert>
 #include <cstdlib>
 #include <memory>
+#include <utility>
 
 
 /// Non-threadsafe circular FIFO; has data races
@@ -74,6 +75,66 @@ public:
         return true;
     }
 
+    /// Construct one object in place at the back of the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    template<typename... Args>
+    auto emplace(Args&&... args) {
+        if (full()) {
+            return false;
+        }
+        new (&ring_[pushCursor_ % capacity_]) T(std::forward<Args>(args)...);
+        ++pushCursor_;
+        return true;
+    }
+
+    /// Push up to `count` objects from `values`, advancing the cursor once.
+    /// @return the number of objects pushed
+    auto try_push_n(T const* values, size_type count) {
+        size_type pushCursor = pushCursor_;
+        size_type n = capacity() - size();
+        if (n > count) {
+            n = count;
+        }
+        for (size_type i = 0; i < n; ++i) {
+            new (&ring_[(pushCursor + i) % capacity_]) T(values[i]);
+        }
+        pushCursor_ = pushCursor + n;
+        return n;
+    }
+
+    /// Pop up to `count` objects into `values`, advancing the cursor once.
+    /// @return the number of objects popped
+    auto try_pop_n(T* values, size_type count) {
+        size_type popCursor = popCursor_;
+        size_type n = size();
+        if (n > count) {
+            n = count;
+        }
+        for (size_type i = 0; i < n; ++i) {
+            T& element = ring_[(popCursor + i) % capacity_];
+            values[i] = std::move(element);
+            element.~T();
+        }
+        popCursor_ = popCursor + n;
+        return n;
+    }
+
+    /// Returns the oldest object without removing it, or `nullptr` if fifo is empty.
+    /// The object stays valid until consume() is called.
+    T* front() {
+        if (empty()) {
+            return nullptr;
+        }
+        return &ring_[popCursor_ % capacity_];
+    }
+
+    /// Removes the object returned by front(); the fifo must not be empty.
+    void consume() {
+        assert(not empty());
+        ring_[popCursor_ % capacity_].~T();
+        ++popCursor_;
+    }
+
 private:
     size_type capacity_;
     T* ring_;
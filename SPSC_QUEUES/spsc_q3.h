@@ -0,0 +1,218 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <memory>
+#include <new>
+#include <utility>
+
+
+/// Threadsafe, efficient circular FIFO
+///
+/// The capacity is rounded up to a power of two so a cursor maps to its slot
+/// with a mask instead of a division. Each side also keeps a private copy of
+/// the other side's cursor and reloads the shared atomic only when the ring
+/// looks full (producer) or empty (consumer), so the cursor cache lines move
+/// between cores only when they have to.
+template<typename T, typename Alloc = std::allocator<T>>
+class Fifo3 : private Alloc
+{
+public:
+    using value_type = T;
+    using allocator_traits = std::allocator_traits<Alloc>;
+    using size_type = typename allocator_traits::size_type;
+
+    explicit Fifo3(size_type capacity, Alloc const& alloc = Alloc{})
+        : Alloc{alloc}
+        , capacity_{std::bit_ceil(capacity)}
+        , mask_{capacity_ - 1}
+        , ring_{allocator_traits::allocate(*this, capacity_)}
+    {}
+
+    // The cursors are shared with another thread; the fifo cannot move
+    Fifo3(Fifo3 const&) = delete;
+    Fifo3& operator=(Fifo3 const&) = delete;
+    Fifo3(Fifo3&&) = delete;
+    Fifo3& operator=(Fifo3&&) = delete;
+
+    ~Fifo3() {
+        while(not empty()) {
+            element(popCursor_)->~T();
+            ++popCursor_;
+        }
+        allocator_traits::deallocate(*this, ring_, capacity_);
+    }
+
+
+    /// Returns the number of elements in the fifo
+    auto size() const noexcept {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+
+        assert(popCursor <= pushCursor);
+        return pushCursor - popCursor;
+    }
+
+    /// Returns whether the container has no elements
+    auto empty() const noexcept { return size() == 0; }
+
+    /// Returns whether the container has capacity_() elements
+    auto full() const noexcept { return size() == capacity(); }
+
+    /// Returns the number of elements that can be held in the fifo
+    /// (the requested capacity rounded up to a power of two)
+    auto capacity() const noexcept { return capacity_; }
+
+
+    /// Push one object onto the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T const& value) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        if (full(pushCursor, popCursorCached_)) {
+            popCursorCached_ = popCursor_.load(std::memory_order_acquire);
+            if (full(pushCursor, popCursorCached_)) {
+                return false;
+            }
+        }
+        new (element(pushCursor)) T(value);
+        pushCursor_.store(pushCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Pop one object from the fifo.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto pop(T& value) {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        if (empty(pushCursorCached_, popCursor)) {
+            pushCursorCached_ = pushCursor_.load(std::memory_order_acquire);
+            if (empty(pushCursorCached_, popCursor)) {
+                return false;
+            }
+        }
+        value = *element(popCursor);
+        element(popCursor)->~T();
+        popCursor_.store(popCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Construct one object in place at the back of the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    template<typename... Args>
+    auto emplace(Args&&... args) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        if (full(pushCursor, popCursorCached_)) {
+            popCursorCached_ = popCursor_.load(std::memory_order_acquire);
+            if (full(pushCursor, popCursorCached_)) {
+                return false;
+            }
+        }
+        new (element(pushCursor)) T(std::forward<Args>(args)...);
+        pushCursor_.store(pushCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Push up to `count` objects from `values` and publish them all with a
+    /// single release store, so the consumer sees the run at once.
+    /// @return the number of objects pushed
+    auto try_push_n(T const* values, size_type count) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        auto room = capacity_ - (pushCursor - popCursorCached_);
+        if (room < count) {
+            popCursorCached_ = popCursor_.load(std::memory_order_acquire);
+            room = capacity_ - (pushCursor - popCursorCached_);
+        }
+        auto n = room < count ? room : count;
+        for (size_type i = 0; i < n; ++i) {
+            new (element(pushCursor + i)) T(values[i]);
+        }
+        if (n != 0) {
+            pushCursor_.store(pushCursor + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    /// Pop up to `count` objects into `values` and release their slots with
+    /// a single store.
+    /// @return the number of objects popped
+    auto try_pop_n(T* values, size_type count) {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        auto available = pushCursorCached_ - popCursor;
+        if (available < count) {
+            pushCursorCached_ = pushCursor_.load(std::memory_order_acquire);
+            available = pushCursorCached_ - popCursor;
+        }
+        auto n = available < count ? available : count;
+        for (size_type i = 0; i < n; ++i) {
+            values[i] = std::move(*element(popCursor + i));
+            element(popCursor + i)->~T();
+        }
+        if (n != 0) {
+            popCursor_.store(popCursor + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    /// Returns the oldest object in place without copying it, or `nullptr`
+    /// if fifo is empty. The object stays valid until consume() is called.
+    T* front() {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        if (empty(pushCursorCached_, popCursor)) {
+            pushCursorCached_ = pushCursor_.load(std::memory_order_acquire);
+            if (empty(pushCursorCached_, popCursor)) {
+                return nullptr;
+            }
+        }
+        return element(popCursor);
+    }
+
+    /// Removes the object returned by front(); front() must have returned non-null.
+    void consume() {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        assert(not empty(pushCursorCached_, popCursor));
+        element(popCursor)->~T();
+        popCursor_.store(popCursor + 1, std::memory_order_release);
+    }
+
+private:
+    auto full(size_type pushCursor, size_type popCursor) const noexcept {
+        return (pushCursor - popCursor) == capacity_;
+    }
+    static auto empty(size_type pushCursor, size_type popCursor) noexcept {
+        return pushCursor == popCursor;
+    }
+    auto element(size_type cursor) noexcept {
+        return &ring_[cursor & mask_];
+    }
+
+private:
+    size_type capacity_;
+    size_type mask_;
+    T* ring_;
+
+    using CursorType = std::atomic<size_type>;
+    static_assert(CursorType::is_always_lock_free);
+
+    // N.B. std::hardware_destructive_interference_size is not used directly
+    // error: use of ‘std::hardware_destructive_interference_size’ [-Werror=interference-size]
+    // note: its value can vary between compiler versions or with different ‘-mtune’ or ‘-mcpu’ flags
+    // note: if this use is part of a public ABI, change it to instead use a constant variable you define
+    // note: the default value for the current CPU tuning is 64 bytes
+    // note: you can stabilize this value with ‘--param hardware_destructive_interference_size=64’, or disable this warning with ‘-Wno-interference-size’
+    static constexpr auto hardware_destructive_interference_size = size_type{64};
+
+    /// Loaded and stored by the push thread; loaded by the pop thread
+    alignas(hardware_destructive_interference_size) CursorType pushCursor_;
+
+    /// Exclusive to the push thread
+    alignas(hardware_destructive_interference_size) size_type popCursorCached_{};
+
+    /// Loaded and stored by the pop thread; loaded by the push thread
+    alignas(hardware_destructive_interference_size) CursorType popCursor_;
+
+    /// Exclusive to the pop thread
+    alignas(hardware_destructive_interference_size) size_type pushCursorCached_{};
+
+    // Padding to avoid false sharing with adjacent objects
+    char padding_[hardware_destructive_interference_size - sizeof(size_type)];
+};
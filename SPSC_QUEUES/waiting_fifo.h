@@ -0,0 +1,183 @@
+#pragma once
+
+#include "spsc_q3.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+
+namespace fifo_detail {
+
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#endif
+}
+
+/// Spins on `ready` with exponentially more pause instructions between
+/// probes, up to `max_pauses`. Returns whether `ready` became true within
+/// `rounds` probes.
+template<typename Ready>
+bool spin_with_backoff(Ready& ready, uint32_t rounds, uint32_t max_pauses) {
+    uint32_t pauses = 1;
+    for (uint32_t i = 0; i < rounds; ++i) {
+        if (ready()) {
+            return true;
+        }
+        for (uint32_t p = 0; p < pauses; ++p) {
+            cpu_relax();
+        }
+        if (pauses < max_pauses) {
+            pauses *= 2;
+        }
+    }
+    return false;
+}
+
+}
+
+
+/// Never gives the core back: spins with `pause` backoff. For consumers on
+/// dedicated, isolated cores. The producer side costs nothing.
+struct BusySpinWait
+{
+    template<typename Ready>
+    void wait(Ready&& ready) {
+        while (not fifo_detail::spin_with_backoff(ready, 1024, 64)) {
+        }
+    }
+
+    void notify() noexcept {}
+    void wake() noexcept {}
+};
+
+/// Spins for a while, then calls `std::this_thread::yield()` between probes.
+/// The producer side costs nothing.
+struct SpinYieldWait
+{
+    template<typename Ready>
+    void wait(Ready&& ready) {
+        if (fifo_detail::spin_with_backoff(ready, 256, 64)) {
+            return;
+        }
+        while (not ready()) {
+            std::this_thread::yield();
+        }
+    }
+
+    void notify() noexcept {}
+    void wake() noexcept {}
+};
+
+/// Spins for a while, then parks on `std::atomic::wait` (a futex on Linux).
+/// The producer reads one flag after each push and only issues the wake-up
+/// syscall when the consumer is actually parked.
+class SpinParkWait
+{
+public:
+    template<typename Ready>
+    void wait(Ready&& ready) {
+        if (fifo_detail::spin_with_backoff(ready, 256, 64)) {
+            return;
+        }
+        for (;;) {
+            auto epoch = epoch_.load(std::memory_order_acquire);
+            parked_.store(true, std::memory_order_relaxed);
+            // Pairs with the fence in notify(): either the producer sees
+            // parked_, or this re-check sees its element.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (ready()) {
+                parked_.store(false, std::memory_order_relaxed);
+                return;
+            }
+            epoch_.wait(epoch, std::memory_order_acquire);
+            parked_.store(false, std::memory_order_relaxed);
+            if (ready()) {
+                return;
+            }
+        }
+    }
+
+    void notify() noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked_.load(std::memory_order_relaxed)) {
+            wake();
+        }
+    }
+
+    void wake() noexcept {
+        epoch_.fetch_add(1, std::memory_order_release);
+        epoch_.notify_one();
+    }
+
+private:
+    static constexpr size_t hardware_destructive_interference_size = 64;
+
+    /// Stored by the pop thread; loaded by the push thread after every push
+    alignas(hardware_destructive_interference_size) std::atomic<bool> parked_{false};
+
+    /// Bumped by the push thread to release a parked pop thread
+    alignas(hardware_destructive_interference_size) std::atomic<uint32_t> epoch_{0};
+};
+
+
+/// Fifo3 whose consumer can block according to a wait strategy instead of
+/// polling `pop` in its own loop.
+template<typename T, typename Wait = BusySpinWait, typename Alloc = std::allocator<T>>
+class WaitingFifo
+{
+public:
+    using value_type = T;
+    using size_type = typename Fifo3<T, Alloc>::size_type;
+
+    explicit WaitingFifo(size_type capacity, Alloc const& alloc = Alloc{})
+        : fifo_{capacity, alloc}
+    {}
+
+    auto size() const noexcept { return fifo_.size(); }
+    auto empty() const noexcept { return fifo_.empty(); }
+    auto capacity() const noexcept { return fifo_.capacity(); }
+
+    /// Push one object and wake the consumer if the strategy parked it.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T const& value) {
+        if (not fifo_.push(value)) {
+            return false;
+        }
+        wait_.notify();
+        return true;
+    }
+
+    /// Pop one object without waiting.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto try_pop(T& value) { return fifo_.pop(value); }
+
+    /// Wait per the strategy until an object can be popped or `stop()`
+    /// returns true. Call wake() after making `stop()` true so that a parked
+    /// consumer notices.
+    /// @return `true` if an object was popped; `false` if stopped.
+    template<typename Stop>
+    auto pop(T& value, Stop&& stop) {
+        bool popped = false;
+        wait_.wait([&] { return (popped = fifo_.pop(value)) || stop(); });
+        return popped;
+    }
+
+    /// Wait per the strategy until an object can be popped.
+    void pop(T& value) {
+        wait_.wait([&] { return fifo_.pop(value); });
+    }
+
+    /// Releases a parked consumer so it re-evaluates its stop condition.
+    void wake() noexcept { wait_.wake(); }
+
+private:
+    Fifo3<T, Alloc> fifo_;
+    Wait wait_;
+};
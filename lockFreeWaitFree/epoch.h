@@ -0,0 +1,197 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+// Epoch-based reclamation: readers announce the global epoch while inside a
+// critical section; a writer that unlinks a node retires it into the bucket
+// of the current epoch. The global epoch only advances once every active
+// reader has caught up with it, so a bucket retired in epoch e is unreachable
+// to everyone once the global epoch reaches e + 2 and is freed as a batch.
+//
+// Compared to hazard pointers, readers pay one store per critical section
+// rather than one per node, but a reader stalled inside a critical section
+// holds back all reclamation.
+namespace epoch {
+
+constexpr size_t MAX_THREADS = 128;
+
+// Retirements a thread accumulates before trying to advance and collect
+constexpr size_t RETIRE_BATCH = 64;
+
+constexpr size_t BUCKETS = 3;
+
+// Participant word: (epoch << 1) | 1 while inside a critical section, 0 outside
+struct alignas(64) Participant {
+    std::atomic<uint64_t> announced{0};
+    std::atomic<bool> owned{false};
+};
+
+struct Retired {
+    void* pointer;
+    void (*deleter)(void*);
+};
+
+struct Bucket {
+    uint64_t epoch = 0;
+    std::vector<Retired> items;
+
+    void free_all() {
+        for (Retired const& r : items) r.deleter(r.pointer);
+        items.clear();
+    }
+};
+
+alignas(64) inline std::atomic<uint64_t> global_epoch{0};
+inline Participant participants[MAX_THREADS];
+
+// Retire lists of threads that exited before their buckets became safe
+inline std::mutex orphan_mutex;
+inline std::vector<Bucket> orphans;
+
+// Advances the global epoch by one if every active participant has seen it
+inline bool try_advance() {
+    uint64_t current = global_epoch.load(std::memory_order_seq_cst);
+    for (Participant const& p : participants) {
+        uint64_t announced = p.announced.load(std::memory_order_seq_cst);
+        if ((announced & 1) && (announced >> 1) != current) {
+            return false;
+        }
+    }
+    return global_epoch.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst);
+}
+
+inline bool safe_to_free(Bucket const& bucket, uint64_t current) {
+    return bucket.epoch + 2 <= current;
+}
+
+// Per-thread state: one owned participant, critical-section nesting depth
+// and one retire bucket per live epoch
+class ThreadRecord {
+public:
+    ThreadRecord() {
+        for (Participant& candidate : participants) {
+            bool expected = false;
+            if (candidate.owned.compare_exchange_strong(expected, true)) {
+                participant = &candidate;
+                break;
+            }
+        }
+        if (participant == nullptr) std::abort();  // more than MAX_THREADS live threads
+        for (Bucket& bucket : buckets) bucket.items.reserve(RETIRE_BATCH);
+    }
+
+    ~ThreadRecord() {
+        participant->announced.store(0, std::memory_order_seq_cst);
+        try_advance();
+        collect();
+        {
+            std::lock_guard<std::mutex> lock{orphan_mutex};
+            for (Bucket& bucket : buckets) {
+                if (!bucket.items.empty()) orphans.push_back(std::move(bucket));
+            }
+        }
+        participant->owned.store(false, std::memory_order_release);
+    }
+
+    ThreadRecord(ThreadRecord const&) = delete;
+    ThreadRecord& operator=(ThreadRecord const&) = delete;
+
+    // Frees this thread's buckets that no reader can still reach, and sweeps
+    // the orphans if no other thread is already doing so
+    void collect() {
+        uint64_t current = global_epoch.load(std::memory_order_acquire);
+        for (Bucket& bucket : buckets) {
+            if (safe_to_free(bucket, current)) bucket.free_all();
+        }
+        std::unique_lock<std::mutex> lock{orphan_mutex, std::try_to_lock};
+        if (lock.owns_lock() && !orphans.empty()) {
+            size_t kept = 0;
+            for (Bucket& bucket : orphans) {
+                if (safe_to_free(bucket, current)) {
+                    bucket.free_all();
+                } else {
+                    orphans[kept++] = std::move(bucket);
+                }
+            }
+            orphans.resize(kept);
+        }
+    }
+
+    Participant* participant = nullptr;
+    uint32_t nesting = 0;
+    size_t pending = 0;
+    Bucket buckets[BUCKETS];
+};
+
+inline ThreadRecord& this_thread() {
+    thread_local ThreadRecord record;
+    return record;
+}
+
+// Claims this thread's participant slot up front; otherwise the first
+// enter() or retire() does it
+inline void register_thread() {
+    this_thread();
+}
+
+// Begins a critical section; nodes read from here until the matching exit()
+// stay allocated. Sections nest.
+inline void enter() {
+    ThreadRecord& record = this_thread();
+    if (record.nesting++ == 0) {
+        uint64_t current = global_epoch.load(std::memory_order_relaxed);
+        record.participant->announced.store((current << 1) | 1, std::memory_order_seq_cst);
+    }
+}
+
+inline void exit() {
+    ThreadRecord& record = this_thread();
+    if (--record.nesting == 0) {
+        record.participant->announced.store(0, std::memory_order_release);
+    }
+}
+
+// Scoped critical section
+class Guard {
+public:
+    Guard() { enter(); }
+    ~Guard() { exit(); }
+    Guard(Guard const&) = delete;
+    Guard& operator=(Guard const&) = delete;
+};
+
+// Frees everything retired by exited threads and by this one. Only call
+// when no thread is inside a critical section, e.g. at shutdown.
+inline void reclaim_all() {
+    for (Bucket& bucket : this_thread().buckets) bucket.free_all();
+    std::lock_guard<std::mutex> lock{orphan_mutex};
+    for (Bucket& bucket : orphans) bucket.free_all();
+    orphans.clear();
+}
+
+// Hands an unlinked node over for deletion once every reader that could
+// have seen it has left its critical section
+template<typename T>
+void retire(T* p) {
+    ThreadRecord& record = this_thread();
+    uint64_t current = global_epoch.load(std::memory_order_acquire);
+    Bucket& bucket = record.buckets[current % BUCKETS];
+    if (bucket.epoch != current) {
+        // The bucket last held epoch current - BUCKETS or older: already safe
+        bucket.free_all();
+        bucket.epoch = current;
+    }
+    bucket.items.push_back({p, [](void* q) { delete static_cast<T*>(q); }});
+    if (++record.pending >= RETIRE_BATCH) {
+        record.pending = 0;
+        try_advance();
+        record.collect();
+    }
+}
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+// Hazard pointers: a reader publishes the node it is about to dereference in
+// its own slot; a writer that unlinks a node retires it instead of deleting,
+// and retired nodes are freed in batches once no slot names them.
+namespace hazard {
+
+constexpr size_t MAX_THREADS = 128;
+
+// Retired nodes a thread accumulates before scanning the slots
+constexpr size_t SCAN_THRESHOLD = 2 * MAX_THREADS;
+
+struct alignas(64) Slot {
+    std::atomic<void*> pointer{nullptr};
+    std::atomic<bool> owned{false};
+};
+
+struct Retired {
+    void* pointer;
+    void (*deleter)(void*);
+};
+
+inline Slot slots[MAX_THREADS];
+
+// Nodes left behind by exiting threads while still hazardous; swept by
+// exiting threads and by a retire's scan whenever the lock is free
+inline std::mutex orphan_mutex;
+inline std::vector<Retired> orphans;
+
+// Frees every entry of retired that no slot currently protects
+inline void scan(std::vector<Retired>& retired) {
+    std::vector<void*> protected_pointers;
+    protected_pointers.reserve(MAX_THREADS);
+    for (Slot& slot : slots) {
+        if (void* p = slot.pointer.load(std::memory_order_seq_cst)) {
+            protected_pointers.push_back(p);
+        }
+    }
+    std::sort(protected_pointers.begin(), protected_pointers.end());
+
+    auto still_hazardous = [&](Retired const& r) {
+        if (std::binary_search(protected_pointers.begin(), protected_pointers.end(), r.pointer)) {
+            return true;
+        }
+        r.deleter(r.pointer);
+        return false;
+    };
+    retired.erase(std::remove_if(retired.begin(), retired.end(), [&](Retired const& r) {
+        return !still_hazardous(r);
+    }), retired.end());
+}
+
+// Per-thread state: one owned slot and the thread's retired list
+class ThreadRecord {
+public:
+    ThreadRecord() {
+        for (Slot& candidate : slots) {
+            bool expected = false;
+            if (candidate.owned.compare_exchange_strong(expected, true)) {
+                slot = &candidate;
+                break;
+            }
+        }
+        if (slot == nullptr) std::abort();  // more than MAX_THREADS live threads
+        retired.reserve(SCAN_THRESHOLD);
+    }
+
+    ~ThreadRecord() {
+        slot->pointer.store(nullptr, std::memory_order_release);
+        scan(retired);
+        {
+            std::lock_guard<std::mutex> lock{orphan_mutex};
+            orphans.insert(orphans.end(), retired.begin(), retired.end());
+            scan(orphans);
+        }
+        slot->owned.store(false, std::memory_order_release);
+    }
+
+    ThreadRecord(ThreadRecord const&) = delete;
+    ThreadRecord& operator=(ThreadRecord const&) = delete;
+
+    Slot* slot = nullptr;
+    std::vector<Retired> retired;
+};
+
+inline ThreadRecord& this_thread() {
+    thread_local ThreadRecord record;
+    return record;
+}
+
+// Publishes p as in use by this thread. The caller must re-validate that p
+// is still reachable after this store before dereferencing it.
+inline void protect(void* p) {
+    this_thread().slot->pointer.store(p, std::memory_order_seq_cst);
+}
+
+inline void clear() {
+    this_thread().slot->pointer.store(nullptr, std::memory_order_release);
+}
+
+// Hands an unlinked node over for deletion once no thread protects it
+template<typename T>
+void retire(T* p) {
+    ThreadRecord& record = this_thread();
+    record.retired.push_back({p, [](void* q) { delete static_cast<T*>(q); }});
+    if (record.retired.size() >= SCAN_THRESHOLD) {
+        scan(record.retired);
+        // Never waits: a busy lock means another thread is sweeping them
+        std::unique_lock<std::mutex> lock{orphan_mutex, std::try_to_lock};
+        if (lock.owns_lock() && !orphans.empty()) {
+            scan(orphans);
+        }
+    }
+}
+
+}
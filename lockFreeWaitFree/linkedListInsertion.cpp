@@ -1,10 +1,12 @@
+#include "epoch.h"
+
 #include <atomic>
 #include <iostream>
 #include <thread>
 
 struct Node {
     int value;
-    Node* next; // raw pointer is fine here
+    Node* next; // raw pointer is fine here: unlinked nodes go through epoch::retire
     Node(int v) : value(v), next(nullptr) {}
 };
 
@@ -14,6 +16,16 @@ class LockFreeList {
 public:
     LockFreeList() : head(nullptr) {}
 
+    // Not concurrent with other operations
+    ~LockFreeList() {
+        Node* curr = head.load();
+        while (curr) {
+            Node* next = curr->next;
+            delete curr;
+            curr = next;
+        }
+    }
+
     void insert(int val) {
         Node* newNode = new Node(val);
         Node* oldHead;
@@ -25,7 +37,21 @@ public:
         } while (!head.compare_exchange_strong(oldHead, newNode));
     }
 
+    // Unlinks the head node. Reading head->next is only safe because the
+    // epoch guard keeps a concurrently popped head from being freed.
+    bool pop_front(int& val) {
+        epoch::Guard guard;
+        Node* oldHead = head.load();
+        do {
+            if (!oldHead) return false;
+        } while (!head.compare_exchange_strong(oldHead, oldHead->next));
+        val = oldHead->value;
+        epoch::retire(oldHead);
+        return true;
+    }
+
     void print() {
+        epoch::Guard guard;
         Node* curr = head.load();
         while (curr) {
             std::cout << curr->value << " ";
@@ -46,8 +72,17 @@ int main() {
         for (int i = 1; i <= 5; i++) list.insert(i * 100);
     });
 
+    std::thread t3([&]() {
+        int val;
+        for (int i = 1; i <= 5; i++) {
+            if (list.pop_front(val)) std::cout << "popped " << val << "\n";
+        }
+    });
+
     t1.join();
     t2.join();
+    t3.join();
+    epoch::reclaim_all(); // all threads joined: nothing can be reading
 
     list.print();
 }
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "hazard_pointers.h"
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+// Treiber stack grown out of LockFreeList: the same CAS-at-head insert, plus
+// a pop that is safe under concurrency.
+//
+// ABA: head is a single 64-bit word holding the node pointer in the low 48
+// bits and a modification counter in the high 16, so a head that was popped
+// and pushed back between a thread's load and its CAS fails that CAS.
+// Reclamation: a popping thread protects the head with a hazard pointer
+// before reading head->next, and popped nodes are retired, not deleted.
+template<typename T>
+class LockFreeStack {
+    static_assert(sizeof(void*) == 8, "tag packing assumes 48-bit user-space addresses");
+
+    struct Node {
+        T value;
+        Node* next;
+    };
+
+    static constexpr int TAG_SHIFT = 48;
+    static constexpr uint64_t POINTER_MASK = (uint64_t{1} << TAG_SHIFT) - 1;
+
+    static Node* pointer(uint64_t word) { return reinterpret_cast<Node*>(word & POINTER_MASK); }
+    static uint64_t with_next_tag(uint64_t old_word, Node* p) {
+        uint64_t tag = (old_word >> TAG_SHIFT) + 1;
+        return (reinterpret_cast<uint64_t>(p) & POINTER_MASK) | (tag << TAG_SHIFT);
+    }
+
+    std::atomic<uint64_t> head{0};
+
+public:
+    LockFreeStack() = default;
+    LockFreeStack(const LockFreeStack&) = delete;
+    LockFreeStack& operator=(const LockFreeStack&) = delete;
+
+    // Not concurrent with other operations
+    ~LockFreeStack() {
+        Node* curr = pointer(head.load(std::memory_order_relaxed));
+        while (curr) {
+            Node* next = curr->next;
+            delete curr;
+            curr = next;
+        }
+    }
+
+    template<typename... Args>
+    void push(Args&&... args) {
+        Node* node = new Node{T(std::forward<Args>(args)...), nullptr};
+        uint64_t old_head = head.load(std::memory_order_relaxed);
+        do {
+            node->next = pointer(old_head);
+        } while (!head.compare_exchange_weak(old_head, with_next_tag(old_head, node),
+                                             std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    std::optional<T> pop() {
+        uint64_t old_head = head.load(std::memory_order_acquire);
+        for (;;) {
+            Node* node = pointer(old_head);
+            if (node == nullptr) {
+                hazard::clear();
+                return std::nullopt;
+            }
+
+            // protect, this load, the unlinking CAS below and scan's reads
+            // of the slots are all seq_cst: either this thread sees the node
+            // unlinked here, or the thread retiring it sees the protection
+            hazard::protect(node);
+            uint64_t current = head.load(std::memory_order_seq_cst);
+            if (current != old_head) {
+                old_head = current;
+                continue;  // node may already be gone; re-protect the new head
+            }
+
+            if (head.compare_exchange_weak(old_head, with_next_tag(old_head, node->next),
+                                           std::memory_order_seq_cst, std::memory_order_acquire)) {
+                hazard::clear();
+                std::optional<T> value{std::move(node->value)};
+                hazard::retire(node);
+                return value;
+            }
+        }
+    }
+
+    // A snapshot only; other threads may push or pop concurrently
+    bool empty() const {
+        return pointer(head.load(std::memory_order_acquire)) == nullptr;
+    }
+};
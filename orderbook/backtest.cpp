@@ -0,0 +1,235 @@
+#include "backtest.h"
+#include "journal.h"
+#include "runtime.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    // [begin, end) of the tasks a worker still has, begin in the high half
+    struct alignas(64) TaskRange {
+        std::atomic<uint64_t> bounds{0};
+    };
+
+    constexpr uint64_t pack(uint32_t begin, uint32_t end) { return (uint64_t{begin} << 32) | end; }
+    constexpr uint32_t begin_of(uint64_t bounds) { return static_cast<uint32_t>(bounds >> 32); }
+    constexpr uint32_t end_of(uint64_t bounds) { return static_cast<uint32_t>(bounds); }
+
+    // The front task of range, if any
+    bool take(TaskRange& range, uint32_t& task) {
+        uint64_t bounds = range.bounds.load(std::memory_order_relaxed);
+        while (begin_of(bounds) < end_of(bounds)) {
+            if (range.bounds.compare_exchange_weak(bounds, pack(begin_of(bounds) + 1, end_of(bounds)),
+                                                   std::memory_order_relaxed)) {
+                task = begin_of(bounds);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The back half of victim, rounded up so a last task can be stolen too
+    bool steal(TaskRange& victim, uint32_t& first, uint32_t& last) {
+        uint64_t bounds = victim.bounds.load(std::memory_order_relaxed);
+        while (begin_of(bounds) < end_of(bounds)) {
+            const uint32_t middle = end_of(bounds) - (end_of(bounds) - begin_of(bounds) + 1) / 2;
+            if (victim.bounds.compare_exchange_weak(bounds, pack(begin_of(bounds), middle),
+                                                    std::memory_order_relaxed)) {
+                first = middle;
+                last = end_of(bounds);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void add_trade(BacktestResult& result, double price, uint64_t quantity) {
+        if (result.trades == 0) {
+            result.open = result.high = result.low = price;
+        }
+        result.high = std::max(result.high, price);
+        result.low = std::min(result.low, price);
+        result.close = price;
+        result.trades++;
+        result.volume += quantity;
+        result.notional += price * static_cast<double>(quantity);
+    }
+
+    // Everything one worker owns; nothing in it is touched by another
+    struct Worker {
+        explicit Worker(size_t arena_bytes)
+            : buffer(new std::byte[arena_bytes]), arena(buffer.get(), arena_bytes) {}
+
+        std::unique_ptr<std::byte[]> buffer;
+        std::pmr::monotonic_buffer_resource arena;
+        std::vector<Command> commands;
+        std::vector<Trade> trades;
+        std::vector<CommandResult> results;
+        uint64_t steals = 0;
+        std::exception_ptr failure;
+    };
+
+    void replay(const BacktestConfig& config, const BacktestTask& task, Worker& worker, BacktestResult& result) {
+        result.symbol_id = task.symbol_id;
+        result.day = task.day;
+        worker.commands.clear();
+        result.loaded = read_journal_commands(task.journal, worker.commands);
+        if (!result.loaded) return;
+
+        BookConfig book_config = config.book;
+        book_config.memory = &worker.arena;
+        {
+            OrderBook book(book_config);
+            const std::span<const Command> commands(worker.commands);
+            for (size_t first = 0; first < commands.size(); first += config.batch) {
+                const auto batch = commands.subspan(first, std::min(config.batch, commands.size() - first));
+                worker.trades.clear();
+                worker.results.clear();
+                result.accepted += book.process_batch(batch, worker.trades, worker.results);
+                for (const Trade& trade : worker.trades) add_trade(result, trade.price, trade.quantity);
+                if (config.on_batch) config.on_batch(task, book, worker.trades);
+            }
+            result.commands = commands.size();
+            result.closing_bid = book.get_best_bid();
+            result.closing_ask = book.get_best_ask();
+        }
+        worker.arena.release();  // the book is gone: rewind for the next task
+    }
+}
+
+BacktestRunner::BacktestRunner(const BacktestConfig& config) : config(config) {
+    if (this->config.batch == 0) this->config.batch = 1;
+}
+
+BacktestReport BacktestRunner::run(std::span<const BacktestTask> tasks) {
+    const auto start = std::chrono::steady_clock::now();
+    BacktestReport report;
+    report.results.resize(tasks.size());
+    if (tasks.size() > UINT32_MAX) {
+        throw std::invalid_argument("BacktestRunner: too many tasks");
+    }
+
+    size_t worker_count = config.workers != 0 ? config.workers : std::max(1u, std::thread::hardware_concurrency());
+    worker_count = std::max<size_t>(1, std::min(worker_count, tasks.size()));
+
+    // Contiguous ranges, the first tasks.size() % worker_count one longer
+    std::vector<TaskRange> ranges(worker_count);
+    for (size_t w = 0, first = 0; w < worker_count; ++w) {
+        const size_t length = tasks.size() / worker_count + (w < tasks.size() % worker_count);
+        ranges[w].bounds.store(pack(static_cast<uint32_t>(first), static_cast<uint32_t>(first + length)));
+        first += length;
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (size_t w = 0; w < worker_count; ++w) {
+        workers.push_back(std::make_unique<Worker>(config.arena_bytes));
+    }
+
+    // Tasks no worker has taken yet: while some are left, a worker finding
+    // every range empty has raced a thief between its steal and publishing
+    // the stolen range, and looks again
+    std::atomic<size_t> unclaimed{tasks.size()};
+    std::atomic<bool> failed{false};
+
+    auto body = [&](size_t self) {
+        Worker& worker = *workers[self];
+        ThreadPlacement placement;
+        if (self < config.worker_cores.size()) placement.core = config.worker_cores[self];
+        std::string error;
+        if (!apply_thread_placement(placement, error)) {
+            std::cerr << "BacktestRunner: worker " << self << ": " << error << "\n";
+        }
+
+        try {
+            uint32_t task;
+            while (!failed.load(std::memory_order_relaxed)) {
+                if (take(ranges[self], task)) {
+                    unclaimed.fetch_sub(1, std::memory_order_relaxed);
+                    replay(config, tasks[task], worker, report.results[task]);
+                    continue;
+                }
+                // Out of work: take over half of the first range still holding some
+                bool stole = false;
+                for (size_t i = 1; i < worker_count && !stole; ++i) {
+                    uint32_t first, last;
+                    if (steal(ranges[(self + i) % worker_count], first, last)) {
+                        ranges[self].bounds.store(pack(first, last), std::memory_order_relaxed);
+                        worker.steals++;
+                        stole = true;
+                    }
+                }
+                if (!stole) {
+                    if (unclaimed.load(std::memory_order_relaxed) == 0) return;  // every task is taken
+                    std::this_thread::yield();
+                }
+            }
+        } catch (...) {
+            worker.failure = std::current_exception();
+            // Stop everyone: thieves holding a stolen range see the flag
+            // before replaying from it
+            failed.store(true, std::memory_order_relaxed);
+            for (TaskRange& range : ranges) range.bounds.store(0);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t w = 1; w < worker_count; ++w) threads.emplace_back(body, w);
+    body(0);
+    for (std::thread& thread : threads) thread.join();
+
+    for (const auto& worker : workers) {
+        if (worker->failure) std::rethrow_exception(worker->failure);
+        report.steals += worker->steals;
+    }
+
+    BacktestResult& total = report.total;
+    total.loaded = true;
+    for (const BacktestResult& result : report.results) {
+        total.loaded &= result.loaded;
+        total.commands += result.commands;
+        total.accepted += result.accepted;
+        if (result.trades > 0) {
+            total.high = total.trades == 0 ? result.high : std::max(total.high, result.high);
+            total.low = total.trades == 0 ? result.low : std::min(total.low, result.low);
+            if (total.trades == 0) total.open = result.open;
+            total.close = result.close;
+        }
+        total.trades += result.trades;
+        total.volume += result.volume;
+        total.notional += result.notional;
+    }
+    report.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+std::vector<BacktestTask> find_backtest_tasks(const std::string& directory) {
+    std::vector<BacktestTask> tasks;
+    std::error_code error;
+    std::filesystem::directory_iterator entries(directory, error);
+    if (error) throw std::runtime_error("BacktestRunner: cannot read " + directory + ": " + error.message());
+
+    for (const auto& entry : entries) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".journal") continue;
+        // <symbol_id>_<day>
+        const std::string stem = entry.path().stem().string();
+        char* end = nullptr;
+        const unsigned long symbol = std::strtoul(stem.c_str(), &end, 10);
+        if (end == stem.c_str() || *end != '_') continue;
+        const char* day_text = end + 1;
+        const unsigned long day = std::strtoul(day_text, &end, 10);
+        if (end == day_text || *end != '\0' || symbol > UINT32_MAX || day > UINT32_MAX) continue;
+        tasks.push_back({static_cast<uint32_t>(symbol), static_cast<uint32_t>(day), entry.path().string()});
+    }
+    std::sort(tasks.begin(), tasks.end(), [](const BacktestTask& a, const BacktestTask& b) {
+        return a.symbol_id != b.symbol_id ? a.symbol_id < b.symbol_id : a.day < b.day;
+    });
+    return tasks;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "order_book.h"
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+// One unit of a backtest: the recorded flow of one symbol on one day, a
+// journal (see journal.h) replayed into a fresh book.
+struct BacktestTask {
+    uint32_t symbol_id;
+    uint32_t day;  // e.g. 20260114
+    std::string journal;
+};
+
+// What replaying one task produced. Every field depends only on the
+// task's journal and the book configuration, never on the worker that ran
+// it or on timing, so a rerun reproduces it exactly.
+struct BacktestResult {
+    uint32_t symbol_id = 0;
+    uint32_t day = 0;
+    bool loaded = false;  // false if the journal could not be read
+    uint64_t commands = 0;
+    uint64_t accepted = 0;
+    uint64_t trades = 0;
+    uint64_t volume = 0;
+    double notional = 0;  // sum of price * quantity over the trades
+    // Trade prices; 0 without trades
+    double open = 0;
+    double high = 0;
+    double low = 0;
+    double close = 0;
+    // Best prices once the last command is applied; 0 for an empty side
+    double closing_bid = 0;
+    double closing_ask = 0;
+};
+
+struct BacktestConfig {
+    // Worker threads (0 = one per hardware thread, never more than tasks)
+    size_t workers = 0;
+    // Optional core per worker, as BookManagerConfig::shard_cores; workers
+    // past the end, and entries of -1, are left unpinned
+    std::vector<int> worker_cores;
+    // Price grid of every task's book. memory is ignored: each worker backs
+    // its books with an arena of its own.
+    BookConfig book;
+    // Bytes each worker's arena starts with; a book that outgrows it takes
+    // more from the heap until its task ends
+    size_t arena_bytes = size_t{64} << 20;
+    // Commands per process_batch
+    size_t batch = 4096;
+    // Called on the worker after every batch with the book and the batch's
+    // trades, e.g. to drive a strategy; must only touch state of its task
+    std::function<void(const BacktestTask&, const OrderBook&, std::span<const Trade>)> on_batch;
+};
+
+struct BacktestReport {
+    // One per task, in the order the tasks were given, however they ran
+    std::vector<BacktestResult> results;
+    // Sum of the results in that order; symbol_id and day are 0, and the
+    // prices span every task
+    BacktestResult total;
+    uint64_t steals = 0;
+    double elapsed_seconds = 0;
+};
+
+// Runs the tasks of a backtest on a work-stealing pool of worker threads.
+//
+// Each worker owns its books, scratch buffers and arena outright: a task's
+// book is built on the worker's arena, replayed, summarised and dropped,
+// and the arena is rewound for the next task, so workers share nothing but
+// the task ranges and never allocate from a common heap while replaying.
+//
+// The tasks are split into one contiguous range per worker, so a worker
+// replays neighbouring symbol-days. A worker takes tasks from the front of
+// its own range; once it is empty it steals the back half of another's.
+// Each range is two 32-bit bounds in one atomic word, so taking and
+// stealing are each a single compare-and-swap. Tasks are coarse (seconds
+// each), so this keeps every core busy until the last task without a
+// shared queue.
+//
+// Results are written to the task's own slot and totalled in task order
+// at the end, so the report is the same for any number of workers.
+class BacktestRunner {
+public:
+    explicit BacktestRunner(const BacktestConfig& config = BacktestConfig{});
+
+    // Blocks until every task is replayed. Throws std::invalid_argument if
+    // the book configuration is invalid, as OrderBook does.
+    BacktestReport run(std::span<const BacktestTask> tasks);
+
+private:
+    BacktestConfig config;
+};
+
+// The tasks of a dataset directory holding one journal per symbol-day,
+// named <symbol_id>_<day>.journal, sorted by symbol and then day. Other
+// files are skipped. Throws std::runtime_error if directory cannot be read.
+std::vector<BacktestTask> find_backtest_tasks(const std::string& directory);
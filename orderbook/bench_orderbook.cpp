@@ -0,0 +1,275 @@
+// Throughput and per-operation latency of OrderBook under synthetic or
+// recorded order flow.
+//
+//   g++ -std=c++20 -O3 -march=native -pthread bench_orderbook.cpp order_book.cpp
+//       market_data.cpp journal.cpp -o bench_orderbook
+//   ./bench_orderbook [key=value ...]
+//
+// Keys (defaults in brackets):
+//   ops=N        operations to time [2000000]
+//   add=R cancel=R amend=R market=R
+//                relative mix of limit adds, cancels, amends and market orders
+//                [0.55 0.35 0.05 0.05]
+//   depth=N      resting orders placed before timing starts [5000]
+//   width=N      half-width in ticks of the price distribution around the mid [50]
+//   seed=N       generator seed [1]
+//   core=N       pin the benchmark thread (-1 = unpinned) [-1]
+//   journal=PATH time the commands of a journal written by JournalWriter
+//                instead of generating flow
+//
+// Flow is generated up front, so the timed loop only calls into the book.
+// Each operation is timed with a fenced rdtsc and converted to ns with the
+// TSC rate measured by latency::TscClock. Build with
+// -DORDERBOOK_LATENCY_STATS to also print the book's per-phase profile.
+
+#include "order_book.h"
+#include "journal.h"
+#include "latency.h"
+#include "bitmap_scan.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <pthread.h>
+#include <random>
+#include <sched.h>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+inline uint64_t read_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_lfence();
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+#endif
+}
+
+using latency::CycleHistogram;
+
+struct Options {
+    uint64_t ops = 2'000'000;
+    double add = 0.55;
+    double cancel = 0.35;
+    double amend = 0.05;
+    double market = 0.05;
+    size_t depth = 5000;
+    int width = 50;
+    uint64_t seed = 1;
+    int core = -1;
+    std::string journal;
+};
+
+bool parse(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        const char* eq = std::strchr(argv[i], '=');
+        if (!eq) return false;
+        std::string key(argv[i], static_cast<size_t>(eq - argv[i]));
+        const char* value = eq + 1;
+        if (key == "ops") opt.ops = std::strtoull(value, nullptr, 10);
+        else if (key == "add") opt.add = std::atof(value);
+        else if (key == "cancel") opt.cancel = std::atof(value);
+        else if (key == "amend") opt.amend = std::atof(value);
+        else if (key == "market") opt.market = std::atof(value);
+        else if (key == "depth") opt.depth = std::strtoull(value, nullptr, 10);
+        else if (key == "width") opt.width = std::atoi(value);
+        else if (key == "seed") opt.seed = std::strtoull(value, nullptr, 10);
+        else if (key == "core") opt.core = std::atoi(value);
+        else if (key == "journal") opt.journal = value;
+        else return false;
+    }
+    return opt.width > 0;
+}
+
+void pin(int core) {
+    if (core < 0) return;
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+        std::cerr << "warning: could not pin to core " << core << "\n";
+    }
+}
+
+/// Synthetic flow around a slowly drifting mid. Limit prices are the mid
+/// plus or minus a geometric offset in ticks, so most orders rest near the
+/// touch and a few cross it. Cancels and amends target orders this generator
+/// placed earlier; some of those have filled by then, as in real flow.
+class FlowGenerator {
+public:
+    FlowGenerator(const Options& opt, const BookConfig& book)
+        : opt(opt), tick(book.tick_size), rng(opt.seed), offset(0.15) {
+        mid_tick = static_cast<int64_t>(std::llround((book.max_price + book.min_price) / 2 / tick));
+        max_tick = static_cast<int64_t>(std::llround(book.max_price / tick));
+    }
+
+    Command next_add() {
+        const bool is_buy = rng() & 1;
+        int64_t distance = std::min<int64_t>(offset(rng), opt.width);
+        // A small share of adds price through the mid and take liquidity
+        if (rng() % 16 == 0) distance = -distance;
+        const int64_t price_tick = std::clamp<int64_t>(is_buy ? mid_tick - distance : mid_tick + distance, 0, max_tick);
+        if (rng() % 64 == 0) mid_tick += (rng() & 1) ? 1 : -1;
+
+        const uint64_t id = next_id++;
+        live.push_back(id);
+        return {CommandType::ADD, {id, is_buy, OrderType::LIMIT, price_tick * tick, 1 + rng() % 100, id}};
+    }
+
+    Command next() {
+        const double total = opt.add + opt.cancel + opt.amend + opt.market;
+        const double roll = std::uniform_real_distribution<double>(0, total)(rng);
+        if (roll < opt.add || live.empty()) return next_add();
+
+        if (roll < opt.add + opt.cancel) {
+            return {CommandType::CANCEL, {take_live(), true, OrderType::LIMIT, 0, 0, 0}};
+        }
+        if (roll < opt.add + opt.cancel + opt.amend) {
+            // Amend either shrinks in place or moves a few ticks
+            const uint64_t id = live[rng() % live.size()];
+            const int64_t distance = std::min<int64_t>(offset(rng), opt.width);
+            const int64_t price_tick = std::clamp<int64_t>(mid_tick + ((rng() & 1) ? distance : -distance), 0, max_tick);
+            return {CommandType::AMEND, {id, true, OrderType::LIMIT, price_tick * tick, 1 + rng() % 100, 0}};
+        }
+        const uint64_t id = next_id++;
+        return {CommandType::ADD, {id, static_cast<bool>(rng() & 1), OrderType::MARKET, 0, 1 + rng() % 200, id}};
+    }
+
+private:
+    uint64_t take_live() {
+        const size_t i = rng() % live.size();
+        const uint64_t id = live[i];
+        live[i] = live.back();
+        live.pop_back();
+        return id;
+    }
+
+    const Options& opt;
+    double tick;
+    std::mt19937_64 rng;
+    std::geometric_distribution<int64_t> offset;
+    int64_t mid_tick;
+    int64_t max_tick;
+    uint64_t next_id = 1;
+    std::vector<uint64_t> live;
+};
+
+enum Operation { LIMIT_ADD, MARKET_ADD, CANCEL, AMEND, OPERATION_COUNT };
+
+const char* const OPERATION_NAMES[OPERATION_COUNT] = {"limit add", "market", "cancel", "amend"};
+
+Operation operation_of(const Command& command) {
+    switch (command.type) {
+        case CommandType::ADD: return command.order.order_type == OrderType::MARKET ? MARKET_ADD : LIMIT_ADD;
+        case CommandType::CANCEL: return CANCEL;
+        case CommandType::AMEND: return AMEND;
+    }
+    return LIMIT_ADD;
+}
+
+void report(const CycleHistogram& histogram, const char* name, double tsc_per_ns) {
+    auto ns = [&](uint64_t cycles) { return static_cast<uint64_t>(cycles / tsc_per_ns); };
+    std::cout << std::left << std::setw(11) << name << std::right << std::setw(11) << histogram.count();
+    if (histogram.count() == 0) {
+        std::cout << "\n";
+        return;
+    }
+    for (double p : {0.50, 0.90, 0.99, 0.999, 0.9999}) {
+        std::cout << std::setw(9) << ns(histogram.percentile(p));
+    }
+    std::cout << std::setw(10) << ns(histogram.maximum()) << "\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse(argc, argv, opt)) {
+        std::cerr << "usage: " << argv[0] << " [ops=N] [add=R cancel=R amend=R market=R] [depth=N] [width=N]"
+                     " [seed=N] [core=N] [journal=PATH]\n";
+        return 1;
+    }
+    pin(opt.core);
+
+    BookConfig config;
+    config.reserve_orders = 1 << 20;
+    OrderBook book(config);
+
+    std::vector<Command> flow;
+    if (!opt.journal.empty()) {
+        if (!read_journal_commands(opt.journal, flow)) {
+            std::cerr << "cannot read journal " << opt.journal << "\n";
+            return 1;
+        }
+        std::cout << "journal " << opt.journal << ": " << flow.size() << " commands\n";
+    } else {
+        FlowGenerator generator(opt, config);
+        std::vector<Trade> trades;
+        for (size_t i = 0; i < opt.depth; ++i) {
+            book.add_order(generator.next_add().order, trades);
+            trades.clear();
+        }
+        flow.reserve(opt.ops);
+        for (uint64_t i = 0; i < opt.ops; ++i) flow.push_back(generator.next());
+        std::cout << "generated " << flow.size() << " commands (add " << opt.add << ", cancel " << opt.cancel
+                  << ", amend " << opt.amend << ", market " << opt.market << "), depth " << opt.depth
+                  << ", width " << opt.width << " ticks\n";
+    }
+
+    const double tsc_per_ns = latency::TscClock::instance().ticks_per_ns();
+    CycleHistogram histograms[OPERATION_COUNT];
+    std::vector<Trade> trades;
+    trades.reserve(1 << 16);
+    uint64_t trade_count = 0;
+    // Cancels and amends whose target had already filled
+    uint64_t missed = 0;
+
+    auto start = Clock::now();
+    for (const Command& command : flow) {
+        const uint64_t t0 = read_tsc();
+        switch (command.type) {
+            case CommandType::ADD:
+                book.add_order(command.order, trades);
+                break;
+            case CommandType::CANCEL:
+                missed += !book.cancel_order(command.order.order_id);
+                break;
+            case CommandType::AMEND:
+                missed += !book.amend_order(command.order.order_id, command.order.price, command.order.quantity, trades);
+                break;
+        }
+        const uint64_t t1 = read_tsc();
+        histograms[operation_of(command)].record(t1 - t0);
+        trade_count += trades.size();
+        trades.clear();
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    std::cout << std::fixed << std::setprecision(2)
+              << flow.size() / elapsed.count() / 1e6 << " M msgs/s over " << elapsed.count() << " s, "
+              << missed << " cancels/amends missed, " << trade_count << " trades, TSC " << tsc_per_ns << " GHz, "
+              << bitmap_scan::kernel_name() << " level scan\n\n";
+    std::cout << std::left << std::setw(11) << "op (ns)" << std::right << std::setw(11) << "count"
+              << std::setw(9) << "p50" << std::setw(9) << "p90" << std::setw(9) << "p99"
+              << std::setw(9) << "p99.9" << std::setw(9) << "p99.99" << std::setw(10) << "max" << "\n";
+    for (int op = 0; op < OPERATION_COUNT; ++op) {
+        report(histograms[op], OPERATION_NAMES[op], tsc_per_ns);
+    }
+#ifdef ORDERBOOK_LATENCY_STATS
+    std::cout << "\n";
+    latency::dump(std::cout);
+#endif
+    return 0;
+}
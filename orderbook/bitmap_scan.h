@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Word scans over the ladder's occupancy bitmaps: the search for the next
+// populated level once a level empties. Far from the touch, or when a market
+// order sweeps a thin book, the gap between levels can run to thousands of
+// ticks; the AVX2 and AVX-512 kernels test 256 or 512 bits per load instead
+// of 64. The kernel is picked once from CPUID, so one binary runs on any
+// x86-64 host and uses the widest unit it has; other targets get the scalar
+// loop.
+namespace bitmap_scan {
+
+constexpr size_t NOT_FOUND = ~size_t{0};
+
+// Index of the first non-zero word in words[begin, end), or NOT_FOUND
+using FirstFn = size_t (*)(const uint64_t* words, size_t begin, size_t end);
+// Index of the last non-zero word in words[begin, end), or NOT_FOUND
+using LastFn = size_t (*)(const uint64_t* words, size_t begin, size_t end);
+
+inline size_t first_nonzero_scalar(const uint64_t* words, size_t begin, size_t end) {
+    for (size_t w = begin; w < end; ++w) {
+        if (words[w]) return w;
+    }
+    return NOT_FOUND;
+}
+
+inline size_t last_nonzero_scalar(const uint64_t* words, size_t begin, size_t end) {
+    for (size_t w = end; w > begin; --w) {
+        if (words[w - 1]) return w - 1;
+    }
+    return NOT_FOUND;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2")))
+inline size_t first_nonzero_avx2(const uint64_t* words, size_t begin, size_t end) {
+    size_t w = begin;
+    for (; w + 4 <= end; w += 4) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + w));
+        if (!_mm256_testz_si256(block, block)) return first_nonzero_scalar(words, w, w + 4);
+    }
+    return first_nonzero_scalar(words, w, end);
+}
+
+__attribute__((target("avx2")))
+inline size_t last_nonzero_avx2(const uint64_t* words, size_t begin, size_t end) {
+    size_t w = end;
+    for (; w >= begin + 4; w -= 4) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + w - 4));
+        if (!_mm256_testz_si256(block, block)) return last_nonzero_scalar(words, w - 4, w);
+    }
+    return last_nonzero_scalar(words, begin, w);
+}
+
+__attribute__((target("avx512f")))
+inline size_t first_nonzero_avx512(const uint64_t* words, size_t begin, size_t end) {
+    size_t w = begin;
+    for (; w + 8 <= end; w += 8) {
+        const __m512i block = _mm512_loadu_si512(words + w);
+        const unsigned mask = _mm512_test_epi64_mask(block, block);
+        if (mask) return w + __builtin_ctz(mask);
+    }
+    return first_nonzero_scalar(words, w, end);
+}
+
+__attribute__((target("avx512f")))
+inline size_t last_nonzero_avx512(const uint64_t* words, size_t begin, size_t end) {
+    size_t w = end;
+    for (; w >= begin + 8; w -= 8) {
+        const __m512i block = _mm512_loadu_si512(words + w - 8);
+        const unsigned mask = _mm512_test_epi64_mask(block, block);
+        if (mask) return w - 8 + (31 - __builtin_clz(mask));
+    }
+    return last_nonzero_scalar(words, begin, w);
+}
+
+#endif
+
+struct Kernels {
+    FirstFn first_nonzero;
+    LastFn last_nonzero;
+    const char* name;
+};
+
+inline Kernels select_kernels() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return {first_nonzero_avx512, last_nonzero_avx512, "avx512"};
+    if (__builtin_cpu_supports("avx2")) return {first_nonzero_avx2, last_nonzero_avx2, "avx2"};
+#endif
+    return {first_nonzero_scalar, last_nonzero_scalar, "scalar"};
+}
+
+inline const Kernels& kernels() {
+    static const Kernels selected = select_kernels();
+    return selected;
+}
+
+inline size_t first_nonzero(const uint64_t* words, size_t begin, size_t end) {
+    return kernels().first_nonzero(words, begin, end);
+}
+
+inline size_t last_nonzero(const uint64_t* words, size_t begin, size_t end) {
+    return kernels().last_nonzero(words, begin, end);
+}
+
+// Name of the kernel in use: "avx512", "avx2" or "scalar"
+inline const char* kernel_name() { return kernels().name; }
+
+}
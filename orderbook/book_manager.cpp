@@ -0,0 +1,195 @@
+#include "book_manager.h"
+#include "runtime.h"
+#include <iostream>
+
+namespace {
+    constexpr size_t SHARD_BATCH = 64;
+
+    inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+}
+
+BookManager::BookManager(const BookManagerConfig& config) {
+    for (int core : config.shard_cores) {
+        shards.push_back(std::make_unique<Shard>(ThreadPlacement{core, config.shard_priority}, config.queue_capacity));
+    }
+}
+
+BookManager::~BookManager() { stop(); }
+
+bool BookManager::add_symbol(uint32_t symbol_id, const BookConfig& book_config) {
+    if (running.load(std::memory_order_relaxed) || shards.empty() || routes.count(symbol_id)) {
+        return false;
+    }
+    Shard& shard = *shards[symbol_id % shards.size()];
+    shard.books.emplace(symbol_id, std::make_unique<OrderBook>(book_config));
+    routes.emplace(symbol_id, &shard);
+    return true;
+}
+
+void BookManager::start() {
+    if (running.exchange(true)) return;
+    for (auto& shard : shards) {
+        Shard* s = shard.get();
+        s->finished.store(false, std::memory_order_relaxed);
+        s->thread = std::thread([this, s] { run_shard(*s); });
+    }
+}
+
+void BookManager::stop() {
+    if (!running.exchange(false)) return;
+
+    // Shards finish their inbound rings first and may block on a full
+    // outbound ring, so keep draining fills until every shard has exited.
+    for (auto& shard : shards) {
+        Execution execution;
+        CommandReply reply;
+        auto drain = [&] {
+            while (shard->outbound.pop(execution)) stopped_executions.push_back(execution);
+            while (shard->replies.pop(reply)) stopped_replies.push_back(reply);
+        };
+        while (!shard->finished.load(std::memory_order_acquire)) {
+            drain();
+            cpu_relax();
+        }
+        drain();
+        shard->thread.join();
+    }
+}
+
+bool BookManager::submit(const SymbolCommand& command) {
+    auto it = routes.find(command.symbol_id);
+    if (it == routes.end()) return false;
+    return it->second->inbound.push(command);
+}
+
+size_t BookManager::poll_executions(std::vector<Execution>& out) {
+    size_t count = stopped_executions.size();
+    out.insert(out.end(), stopped_executions.begin(), stopped_executions.end());
+    stopped_executions.clear();
+
+    Execution execution;
+    for (auto& shard : shards) {
+        while (shard->outbound.pop(execution)) {
+            out.push_back(execution);
+            ++count;
+        }
+    }
+    return count;
+}
+
+size_t BookManager::poll_replies(std::vector<CommandReply>& out) {
+    size_t count = stopped_replies.size();
+    out.insert(out.end(), stopped_replies.begin(), stopped_replies.end());
+    stopped_replies.clear();
+
+    CommandReply reply;
+    for (auto& shard : shards) {
+        while (shard->replies.pop(reply)) {
+            out.push_back(reply);
+            ++count;
+        }
+    }
+    return count;
+}
+
+uint64_t BookManager::processed_count() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) total += shard->processed.load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t BookManager::rejected_count() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) total += shard->rejected.load(std::memory_order_relaxed);
+    return total;
+}
+
+OrderBook* BookManager::find_book(uint32_t symbol_id) {
+    auto it = routes.find(symbol_id);
+    if (it == routes.end()) return nullptr;
+    return it->second->books.at(symbol_id).get();
+}
+
+void BookManager::run_shard(Shard& shard) {
+    std::string error;
+    if (!apply_thread_placement(shard.placement, error)) {
+        std::cerr << "BookManager: shard: " << error << "\n";
+    }
+
+    std::vector<Command> run;
+    std::vector<uint64_t> tags;
+    std::vector<Trade> trades;
+    std::vector<CommandResult> results;
+    run.reserve(SHARD_BATCH);
+    tags.reserve(SHARD_BATCH);
+    trades.reserve(1024);
+    results.reserve(SHARD_BATCH);
+    uint32_t run_symbol = 0;
+
+    // Consecutive commands for the same symbol go to its book as one batch
+    auto flush = [&] {
+        if (run.empty()) return;
+        OrderBook& book = *shard.books.find(run_symbol)->second;
+        size_t accepted = book.process_batch(run, trades, results);
+
+        shard.processed.fetch_add(run.size(), std::memory_order_relaxed);
+        shard.rejected.fetch_add(run.size() - accepted, std::memory_order_relaxed);
+
+        // Back-pressure: wait for the consumer rather than drop a fill
+        size_t next_trade = 0;
+        for (size_t i = 0; i < run.size(); ++i) {
+            const uint32_t trade_count = results[i].trade_count;
+            if (tags[i] == 0) {
+                for (uint32_t t = 0; t < trade_count; ++t) {
+                    while (!shard.outbound.push(Execution{run_symbol, trades[next_trade + t]})) cpu_relax();
+                }
+            } else {
+                CommandReply reply{};
+                reply.tag = tags[i];
+                reply.symbol_id = run_symbol;
+                reply.kind = CommandReply::ACK;
+                reply.accepted = results[i].accepted;
+                reply.trade_count = trade_count;
+                reply.order_id = run[i].order.order_id;
+                while (!shard.replies.push(reply)) cpu_relax();
+                reply.kind = CommandReply::TRADE;
+                for (uint32_t t = 0; t < trade_count; ++t) {
+                    reply.trade = trades[next_trade + t];
+                    while (!shard.replies.push(reply)) cpu_relax();
+                }
+            }
+            next_trade += trade_count;
+        }
+        run.clear();
+        tags.clear();
+        trades.clear();
+        results.clear();
+    };
+
+    // Keep draining after stop() is requested so that nothing already
+    // accepted by submit() is lost.
+    SymbolCommand command;
+    while (running.load(std::memory_order_relaxed) || !shard.inbound.empty()) {
+        size_t handled = 0;
+        while (handled < SHARD_BATCH && shard.inbound.pop(command)) {
+            ++handled;
+            if (!run.empty() && command.symbol_id != run_symbol) {
+                flush();
+            }
+            run_symbol = command.symbol_id;
+            run.push_back(command.command);
+            tags.push_back(command.tag);
+        }
+        flush();
+
+        if (handled == 0) {
+            cpu_relax();
+        }
+    }
+
+    shard.finished.store(true, std::memory_order_release);
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include "order_book.h"
+#include "runtime.h"
+#include "../SPSC_QUEUES/spsc_q3.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// A command addressed to one instrument's book.
+struct SymbolCommand {
+    uint32_t symbol_id;
+    Command command;
+    // Non-zero: the command is answered through poll_replies, with this tag,
+    // instead of its fills going to poll_executions
+    uint64_t tag = 0;
+};
+
+// A fill reported back by the shard that owns the symbol.
+struct Execution {
+    uint32_t symbol_id;
+    Trade trade;
+};
+
+// The answer to a tagged command: one ACK, then one TRADE per fill it
+// caused, in the order the book produced them. The replies of one symbol
+// arrive in the order its commands were submitted.
+struct CommandReply {
+    enum Kind : uint8_t { ACK, TRADE };
+
+    uint64_t tag;
+    uint32_t symbol_id;
+    Kind kind;
+    bool accepted;         // ACK
+    uint32_t trade_count;  // ACK: TRADE replies that follow
+    uint64_t order_id;     // ACK
+    Trade trade;           // TRADE
+};
+
+struct BookManagerConfig {
+    // One shard thread per entry, pinned to that core (-1 leaves it unpinned)
+    std::vector<int> shard_cores = {0};
+    // SCHED_FIFO priority of every shard thread (0 keeps SCHED_OTHER)
+    int shard_priority = 0;
+    // Capacity of each shard's inbound command ring and of its outbound
+    // fill and reply rings
+    size_t queue_capacity = 1 << 16;
+};
+
+// Owns many OrderBooks keyed by symbol id and splits them across shards.
+// Each shard is one pinned thread that owns its books outright, so a book is
+// only ever touched by one thread and needs no locking. Commands reach a
+// shard through its own Fifo3; fills come back through another.
+//
+// Threading contract: add_symbol before start(); submit() from a single
+// producer thread; poll_executions(), poll_replies() and stop() from a
+// single consumer thread.
+class BookManager {
+public:
+    explicit BookManager(const BookManagerConfig& config = BookManagerConfig{});
+    ~BookManager();
+
+    BookManager(const BookManager&) = delete;
+    BookManager& operator=(const BookManager&) = delete;
+
+    // Creates the book for symbol_id on shard symbol_id % shard_count().
+    // Returns false if the symbol exists or the manager is already running.
+    bool add_symbol(uint32_t symbol_id, const BookConfig& book_config = BookConfig{});
+
+    void start();
+    void stop();
+
+    // Routes a command to the owning shard. Returns false if the symbol is
+    // unknown or the shard's ring is full (the caller decides whether to retry).
+    bool submit(const SymbolCommand& command);
+
+    // Moves every fill currently queued on all shards into out (appending).
+    size_t poll_executions(std::vector<Execution>& out);
+
+    // Moves every reply to a tagged command currently queued on all shards
+    // into out (appending).
+    size_t poll_replies(std::vector<CommandReply>& out);
+
+    bool has_symbol(uint32_t symbol_id) const { return routes.count(symbol_id) != 0; }
+
+    size_t shard_count() const { return shards.size(); }
+
+    // Commands applied and commands rejected by the books, summed over shards
+    uint64_t processed_count() const;
+    uint64_t rejected_count() const;
+
+    // Direct access to a book; only safe while the manager is stopped.
+    OrderBook* find_book(uint32_t symbol_id);
+
+private:
+    struct Shard {
+        Shard(ThreadPlacement placement, size_t capacity)
+            : placement(placement), inbound(capacity), outbound(capacity), replies(capacity) {}
+
+        ThreadPlacement placement;
+        Fifo3<SymbolCommand> inbound;
+        Fifo3<Execution> outbound;
+        Fifo3<CommandReply> replies;
+        std::unordered_map<uint32_t, std::unique_ptr<OrderBook>> books;
+        std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> rejected{0};
+        std::atomic<bool> finished{false};
+        std::thread thread;
+    };
+
+    void run_shard(Shard& shard);
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::unordered_map<uint32_t, Shard*> routes;
+    // Drained by stop(), handed out by the next poll
+    std::vector<Execution> stopped_executions;
+    std::vector<CommandReply> stopped_replies;
+    std::atomic<bool> running{false};
+};
@@ -0,0 +1,164 @@
+#include "book_viewer.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+    constexpr const char* CYAN = "\033[36m";
+    constexpr const char* MAGENTA = "\033[35m";
+    constexpr const char* GRAY = "\033[90m";
+    constexpr const char* WHITE = "\033[97m";
+    constexpr const char* BOLD = "\033[1m";
+    constexpr const char* RESET = "\033[0m";
+    constexpr size_t BAR_WIDTH = 20;
+
+    // Right-aligns a number in width columns; prices with two decimals,
+    // as print_book shows them
+    template<typename T>
+    void append_number(std::string& out, T value, size_t width) {
+        char text[32];
+        std::to_chars_result result;
+        if constexpr (std::is_floating_point_v<T>) {
+            result = std::to_chars(text, text + sizeof(text), value, std::chars_format::fixed, 2);
+        } else {
+            result = std::to_chars(text, text + sizeof(text), value);
+        }
+        const size_t length = static_cast<size_t>(result.ptr - text);
+        if (length < width) out.append(width - length, ' ');
+        out.append(text, length);
+    }
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+BasicBookViewer<PriceT, QtyT, Policy>::BasicBookViewer(const Book& book, const BookViewerConfig& config)
+    : book(book), config(config) {
+    DepthSnapshot probe;
+    if (!book.read_depth_snapshot(probe)) {
+        throw std::invalid_argument("BookViewer: the book publishes no depth (BookConfig::published_depth)");
+    }
+    if (this->config.refresh_hz <= 0) this->config.refresh_hz = 1.0;
+    // Room for the largest frame, so rendering never reallocates
+    buffer.reserve(1024 + 2 * DepthSnapshot::MAX_DEPTH * (128 + BAR_WIDTH * 3));
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+BasicBookViewer<PriceT, QtyT, Policy>::~BasicBookViewer() { stop(); }
+
+template<typename PriceT, typename QtyT, typename Policy>
+void BasicBookViewer<PriceT, QtyT, Policy>::start() {
+    if (running.exchange(true)) return;
+    thread = std::thread([this] { run(); });
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+void BasicBookViewer<PriceT, QtyT, Policy>::stop() {
+    if (!running.exchange(false)) return;
+    thread.join();
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+void BasicBookViewer<PriceT, QtyT, Policy>::run() {
+    std::string error;
+    if (!apply_thread_placement(config.placement, error)) {
+        std::cerr << "BookViewer: " << error << "\n";
+    }
+
+    using Clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / config.refresh_hz));
+    auto next = Clock::now();
+    bool drawn = false;
+    uint64_t drawn_sequence = 0;
+    DepthSnapshot snapshot;
+
+    while (running.load(std::memory_order_relaxed)) {
+        book.read_depth_snapshot(snapshot);
+        if (!drawn || snapshot.sequence != drawn_sequence) {
+            render(snapshot);
+            write_frame();
+            drawn = true;
+            drawn_sequence = snapshot.sequence;
+        }
+        next += period;
+        const auto now = Clock::now();
+        if (next < now) next = now;  // fell behind: skip frames, do not catch up
+        std::this_thread::sleep_until(next);
+    }
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+void BasicBookViewer<PriceT, QtyT, Policy>::render(const DepthSnapshot& snapshot) {
+    auto color = [&](const char* code) {
+        if (config.color) buffer += code;
+    };
+    const size_t asks = std::min<size_t>(snapshot.ask_count, config.depth);
+    const size_t bids = std::min<size_t>(snapshot.bid_count, config.depth);
+    QtyT largest = 0;
+    for (size_t i = 0; i < asks; ++i) largest = std::max(largest, snapshot.asks[i].total_quantity);
+    for (size_t i = 0; i < bids; ++i) largest = std::max(largest, snapshot.bids[i].total_quantity);
+
+    auto level = [&](const auto& entry, const char* side) {
+        color(side);
+        append_number(buffer, entry.price, 10);
+        buffer += "  ";
+        color(WHITE);
+        append_number(buffer, entry.total_quantity, 10);
+        buffer += "  ";
+        color(GRAY);
+        append_number(buffer, entry.order_count, 6);
+        buffer += "  ";
+        color(side);
+        const size_t bars = largest > 0 ? static_cast<size_t>(entry.total_quantity) * BAR_WIDTH / largest : 0;
+        for (size_t i = 0; i < bars; ++i) buffer += "•";
+        color(RESET);
+        buffer += '\n';
+    };
+
+    buffer.clear();
+    if (config.redraw_in_place) buffer += "\033[H\033[2J";
+    color(BOLD);
+    color(WHITE);
+    buffer += "ORDER BOOK";
+    color(RESET);
+    color(GRAY);
+    buffer += "  event ";
+    append_number(buffer, snapshot.sequence, 0);
+    if (asks > 0 && bids > 0) {
+        buffer += "  spread ";
+        append_number(buffer, snapshot.asks[0].price - snapshot.bids[0].price, 0);
+    }
+    color(RESET);
+    buffer += "\n\n";
+
+    color(GRAY);
+    buffer += "     Price         Qty  Orders\n";
+    color(RESET);
+    if (asks == 0) buffer += "  no asks\n";
+    for (size_t i = asks; i-- > 0;) level(snapshot.asks[i], MAGENTA);  // best ask nearest the bids
+    buffer += "  ----\n";
+    for (size_t i = 0; i < bids; ++i) level(snapshot.bids[i], CYAN);
+    if (bids == 0) buffer += "  no bids\n";
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+void BasicBookViewer<PriceT, QtyT, Policy>::write_frame() {
+    const char* data = buffer.data();
+    size_t left = buffer.size();
+    while (left > 0) {
+        ssize_t written = ::write(config.fd, data, left);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;  // the terminal went away: drop the frame
+        }
+        data += written;
+        left -= static_cast<size_t>(written);
+    }
+    frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+// One per BasicOrderBook instantiation in order_book.cpp
+template class BasicBookViewer<double, uint64_t, PriceTimePolicy>;
+template class BasicBookViewer<int64_t, uint32_t, PriceTimePolicy>;
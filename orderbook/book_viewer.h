@@ -0,0 +1,76 @@
+#pragma once
+#include "order_book.h"
+#include "runtime.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+struct BookViewerConfig {
+    // Redraws per second at most; a book that has not changed since the
+    // last frame is not redrawn at all
+    double refresh_hz = 10.0;
+    // Levels shown per side; never more than the book publishes
+    size_t depth = DepthSnapshot::MAX_DEPTH;
+    int fd = STDOUT_FILENO;
+    // Home the cursor and clear before each frame, so the terminal shows
+    // one book redrawn in place instead of a scrolling log
+    bool redraw_in_place = true;
+    bool color = true;
+    // The viewer's own thread; keep it off the matching core
+    ThreadPlacement placement;
+};
+
+// Renders a book from a thread of its own, so drawing it costs the book's
+// owner nothing.
+//
+// The viewer never calls into the book's command path: it reads the top
+// levels the owner publishes after every event (read_depth_snapshot, a
+// SeqLock the owner never waits on), so the book must be built with
+// BookConfig::published_depth. At most refresh_hz times a second, and only
+// if the book's sequence moved, a frame is formatted into one reused
+// buffer with std::to_chars and goes out in a single write(). The owner's
+// thread neither formats nor blocks on the terminal.
+//
+// Construction throws std::invalid_argument if the book publishes no depth.
+template<typename PriceT, typename QtyT, typename Policy = PriceTimePolicy>
+class BasicBookViewer {
+public:
+    using Book = BasicOrderBook<PriceT, QtyT, Policy>;
+    using DepthSnapshot = typename Book::DepthSnapshot;
+
+    explicit BasicBookViewer(const Book& book, const BookViewerConfig& config = BookViewerConfig{});
+    ~BasicBookViewer();
+
+    BasicBookViewer(const BasicBookViewer&) = delete;
+    BasicBookViewer& operator=(const BasicBookViewer&) = delete;
+
+    void start();
+    // Draws nothing more; returns once the thread has exited
+    void stop();
+
+    // Formats one frame of snapshot into frame() without writing it; the
+    // viewer thread's own step, exposed for callers that send frames
+    // elsewhere
+    void render(const DepthSnapshot& snapshot);
+    const std::string& frame() const { return buffer; }
+
+    uint64_t frame_count() const { return frames.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void write_frame();
+
+    const Book& book;
+    BookViewerConfig config;
+    std::string buffer;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> frames{0};
+};
+
+using BookViewer = BasicBookViewer<double, uint64_t>;
+
+extern template class BasicBookViewer<double, uint64_t, PriceTimePolicy>;
+extern template class BasicBookViewer<int64_t, uint32_t, PriceTimePolicy>;
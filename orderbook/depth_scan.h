@@ -0,0 +1,211 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Kernels for the depth queries, over one side's per-tick quantity array:
+// find where the running total from the best tick reaches a target, and
+// inclusive prefix sums. Empty ticks hold zero, so both run over the dense
+// array without consulting the order queues. Quantities are uint32_t or
+// uint64_t, totals always uint64_t. As in bitmap_scan.h, AVX-512 or AVX2 is
+// picked once from CPUID, with a scalar fallback.
+namespace depth_scan {
+
+constexpr size_t NOT_FOUND = ~size_t{0};
+
+// Steps q[from], then towards higher indices if Ascending, else lower ones,
+// adding each element to sum until one brings it to at least target.
+// Returns that element's index with sum holding the total before it, or
+// NOT_FOUND with sum holding the total of everything scanned.
+template<typename Q, bool Ascending>
+inline size_t find_fill_scalar(const Q* q, size_t count, size_t from, uint64_t target, uint64_t& sum) {
+    if constexpr (Ascending) {
+        for (size_t i = from; i < count; ++i) {
+            if (sum + q[i] >= target) return i;
+            sum += q[i];
+        }
+    } else {
+        for (size_t left = from + 1; left > 0; --left) {
+            if (sum + q[left - 1] >= target) return left - 1;
+            sum += q[left - 1];
+        }
+    }
+    return NOT_FOUND;
+}
+
+// Replaces v[i] with v[0] + ... + v[i]
+inline void inclusive_scan_scalar(uint64_t* v, size_t count) {
+    for (size_t i = 1; i < count; ++i) v[i] += v[i - 1];
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Both vector searches skip whole blocks of eight ticks while the block
+// total keeps the running sum short of the target, then settle the block
+// that reaches it one tick at a time.
+
+__attribute__((target("avx2")))
+inline uint64_t horizontal_sum(__m256i sum) {
+    const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(half)) + static_cast<uint64_t>(_mm_extract_epi64(half, 1));
+}
+
+template<typename Q>
+__attribute__((target("avx2")))
+inline uint64_t block_sum_avx2(const Q* q) {
+    __m256i sum;
+    if constexpr (sizeof(Q) == 8) {
+        sum = _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(q)),
+                               _mm256_loadu_si256(reinterpret_cast<const __m256i*>(q + 4)));
+    } else {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(q));
+        sum = _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(x)),
+                               _mm256_cvtepu32_epi64(_mm256_extracti128_si256(x, 1)));
+    }
+    return horizontal_sum(sum);
+}
+
+template<typename Q, bool Ascending>
+__attribute__((target("avx2")))
+inline size_t find_fill_avx2(const Q* q, size_t count, size_t from, uint64_t target, uint64_t& sum) {
+    if constexpr (Ascending) {
+        size_t i = from;
+        for (; i + 8 <= count; i += 8) {
+            const uint64_t block = block_sum_avx2(q + i);
+            if (sum + block >= target) break;
+            sum += block;
+        }
+        return find_fill_scalar<Q, true>(q, count, i, target, sum);
+    } else {
+        size_t left = from + 1;
+        for (; left >= 8; left -= 8) {
+            const uint64_t block = block_sum_avx2(q + left - 8);
+            if (sum + block >= target) break;
+            sum += block;
+        }
+        return find_fill_scalar<Q, false>(q, count, left - 1, target, sum);
+    }
+}
+
+__attribute__((target("avx2")))
+inline void inclusive_scan_avx2(uint64_t* v, size_t count) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i carry = zero;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i));
+        // Pairs within each 128-bit lane, then the low pair's total into the high lane
+        x = _mm256_add_epi64(x, _mm256_slli_si256(x, 8));
+        x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 1, 1, 1)), zero, 0x0F));
+        x = _mm256_add_epi64(x, carry);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(v + i), x);
+        carry = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    for (; i < count; ++i) v[i] += i ? v[i - 1] : 0;
+}
+
+// Zero-masked forms throughout: GCC 12 warns about the undefined vector
+// the unmasked extract, cast, widen and permute start from
+template<typename Q>
+__attribute__((target("avx512f")))
+inline uint64_t block_sum_avx512(const Q* q) {
+    __m512i x;
+    if constexpr (sizeof(Q) == 8) {
+        x = _mm512_loadu_si512(q);
+    } else {
+        x = _mm512_maskz_cvtepu32_epi64(0xFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(q)));
+    }
+    const __m256i low = _mm512_maskz_extracti64x4_epi64(0xFF, x, 0);
+    const __m256i high = _mm512_maskz_extracti64x4_epi64(0xFF, x, 1);
+    return horizontal_sum(_mm256_add_epi64(low, high));
+}
+
+template<typename Q, bool Ascending>
+__attribute__((target("avx512f")))
+inline size_t find_fill_avx512(const Q* q, size_t count, size_t from, uint64_t target, uint64_t& sum) {
+    if constexpr (Ascending) {
+        size_t i = from;
+        for (; i + 8 <= count; i += 8) {
+            const uint64_t block = block_sum_avx512(q + i);
+            if (sum + block >= target) break;
+            sum += block;
+        }
+        return find_fill_scalar<Q, true>(q, count, i, target, sum);
+    } else {
+        size_t left = from + 1;
+        for (; left >= 8; left -= 8) {
+            const uint64_t block = block_sum_avx512(q + left - 8);
+            if (sum + block >= target) break;
+            sum += block;
+        }
+        return find_fill_scalar<Q, false>(q, count, left - 1, target, sum);
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void inclusive_scan_avx512(uint64_t* v, size_t count) {
+    // Lane i takes lane i - k for shifts of 1, 2 and 4 lanes; masked-off lanes add zero
+    const __m512i by1 = _mm512_set_epi64(6, 5, 4, 3, 2, 1, 0, 0);
+    const __m512i by2 = _mm512_set_epi64(5, 4, 3, 2, 1, 0, 0, 0);
+    const __m512i by4 = _mm512_set_epi64(3, 2, 1, 0, 0, 0, 0, 0);
+    const __m512i last = _mm512_set1_epi64(7);
+    __m512i carry = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512i x = _mm512_loadu_si512(v + i);
+        x = _mm512_add_epi64(x, _mm512_maskz_permutexvar_epi64(0xFE, by1, x));
+        x = _mm512_add_epi64(x, _mm512_maskz_permutexvar_epi64(0xFC, by2, x));
+        x = _mm512_add_epi64(x, _mm512_maskz_permutexvar_epi64(0xF0, by4, x));
+        x = _mm512_add_epi64(x, carry);
+        _mm512_storeu_si512(v + i, x);
+        carry = _mm512_maskz_permutexvar_epi64(0xFF, last, x);
+    }
+    for (; i < count; ++i) v[i] += i ? v[i - 1] : 0;
+}
+
+#endif
+
+template<typename Q>
+struct Kernels {
+    size_t (*find_fill_up)(const Q*, size_t, size_t, uint64_t, uint64_t&);
+    size_t (*find_fill_down)(const Q*, size_t, size_t, uint64_t, uint64_t&);
+    void (*inclusive_scan)(uint64_t*, size_t);
+};
+
+template<typename Q>
+inline Kernels<Q> select_kernels() {
+    static_assert(sizeof(Q) == 4 || sizeof(Q) == 8, "depth_scan: quantities must be 32 or 64 bits");
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return {find_fill_avx512<Q, true>, find_fill_avx512<Q, false>, inclusive_scan_avx512};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return {find_fill_avx2<Q, true>, find_fill_avx2<Q, false>, inclusive_scan_avx2};
+    }
+#endif
+    return {find_fill_scalar<Q, true>, find_fill_scalar<Q, false>, inclusive_scan_scalar};
+}
+
+template<typename Q>
+inline const Kernels<Q>& kernels() {
+    static const Kernels<Q> selected = select_kernels<Q>();
+    return selected;
+}
+
+// find_fill_scalar's contract, on q[0, count), with sum starting at zero
+template<typename Q>
+inline size_t find_fill(const Q* q, size_t count, size_t from, bool ascending, uint64_t target, uint64_t& sum) {
+    sum = 0;
+    return ascending ? kernels<Q>().find_fill_up(q, count, from, target, sum)
+                     : kernels<Q>().find_fill_down(q, count, from, target, sum);
+}
+
+inline void inclusive_scan(uint64_t* v, size_t count) {
+    kernels<uint64_t>().inclusive_scan(v, count);
+}
+
+}
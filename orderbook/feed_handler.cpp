@@ -0,0 +1,88 @@
+#include "feed_handler.h"
+#include <stdexcept>
+
+namespace {
+    inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+}
+
+template<typename Receiver>
+BasicFeedHandler<Receiver>::BasicFeedHandler(Receiver& receiver, Fifo3<MarketTick>& out,
+                                             const FeedHandlerConfig& config)
+    : lines{&receiver, nullptr}, line_count(1), out(out), arbiter(1, config.sequence_window) {
+    if (config.packet_batch == 0) {
+        throw std::invalid_argument("FeedHandler: invalid packet batch");
+    }
+    packets.resize(config.packet_batch);
+}
+
+template<typename Receiver>
+BasicFeedHandler<Receiver>::BasicFeedHandler(Receiver& line_a, Receiver& line_b, Fifo3<MarketTick>& out,
+                                             const FeedHandlerConfig& config)
+    : lines{&line_a, &line_b}, line_count(2), out(out), arbiter(2, config.sequence_window) {
+    if (config.packet_batch == 0) {
+        throw std::invalid_argument("FeedHandler: invalid packet batch");
+    }
+    packets.resize(config.packet_batch);
+}
+
+template<typename Receiver>
+ssize_t BasicFeedHandler<Receiver>::poll() {
+    size_t count = 0;
+    size_t open = 0;
+    for (size_t line = 0; line < line_count; ++line) {
+        if (closed[line]) continue;
+        ssize_t received = lines[line]->receive(packets.data(), packets.size());
+        if (received < 0) {
+            closed[line] = true;
+            arbiter.close_line(line);
+            continue;
+        }
+        ++open;
+        for (ssize_t i = 0; i < received; ++i) {
+            count += publish(line, packets[i]);
+        }
+    }
+    return open == 0 ? -1 : static_cast<ssize_t>(count);
+}
+
+template<typename Receiver>
+void BasicFeedHandler<Receiver>::run(const std::atomic<bool>& stop) {
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (poll() < 0) return;
+    }
+}
+
+// Decodes each of the length / WIRE_SIZE messages of a packet and pushes
+// the ones no other line delivered first
+template<typename Receiver>
+size_t BasicFeedHandler<Receiver>::publish(size_t line, const FeedPacket& packet) {
+    const size_t count = packet.length / MarketTick::WIRE_SIZE;
+    bytes += packet.length;
+    malformed += packet.length % MarketTick::WIRE_SIZE;
+
+    size_t pushed = 0;
+    const char* end = packet.data + count * MarketTick::WIRE_SIZE;
+    for (const char* message = packet.data; message != end; message += MarketTick::WIRE_SIZE) {
+        MarketTick tick = MarketTick::decode(message, packet.receive_ns);
+        if (!arbiter.accept(line, tick.sequence)) continue;
+        push(tick);
+        ++pushed;
+    }
+    messages += pushed;
+    return pushed;
+}
+
+template<typename Receiver>
+void BasicFeedHandler<Receiver>::push(const MarketTick& tick) {
+    if (out.push(tick)) return;
+    ++full_waits;
+    while (!out.push(tick)) cpu_relax();
+}
+
+// One per receiver; a new transport adds its line here
+template class BasicFeedHandler<SocketReceiver>;
+template class BasicFeedHandler<UdpMulticastReceiver>;
@@ -0,0 +1,100 @@
+#pragma once
+#include "../SPSC_QUEUES/spsc_q3.h"
+#include "feed_receiver.h"
+#include "market_tick.h"
+#include "sequence_arbiter.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+struct FeedHandlerConfig {
+    // Packets asked of each receiver per poll()
+    size_t packet_batch = 64;
+    // Sequences the arbiter tracks behind the newest; a hole older than
+    // this is lost even if a line has not caught up (see SequenceArbiter)
+    size_t sequence_window = 1 << 16;
+};
+
+// Turns the packets of a receiver (see feed_receiver.h) into a Fifo3 of
+// decoded ticks for the thread that drives the book. The receiver is the
+// transport; the handler is the same for all of them, so what reaches the
+// book does not depend on how it arrived.
+//
+// There is one receive() per batch, not per message, and decoding reads
+// the receiver's memory directly. Each tick carries its packet's receive
+// stamp.
+//
+// Given two receivers, for the A and B lines of a redundant feed, the
+// handler polls both and a SequenceArbiter passes on whichever copy of a
+// message arrives first, so a message one line lost reaches the Fifo3
+// when the other line delivers it, possibly after later sequences. With
+// one receiver the arbiter still finds gaps.
+// Either way a sequence no line delivered shows up in next_gap(); that
+// is the point to recover from a snapshot, and reset_sequence() resumes
+// the feed after it.
+//
+// A full Fifo3 is back-pressure, not loss: the handler waits for the consumer
+// and, on a stream socket, stops reading so TCP slows the sender down.
+//
+// Threading contract: poll()/run() from one producer thread; the Fifo3 is
+// popped by one consumer thread.
+template<typename Receiver>
+class BasicFeedHandler {
+public:
+    BasicFeedHandler(Receiver& receiver, Fifo3<MarketTick>& out, const FeedHandlerConfig& config = FeedHandlerConfig{});
+    BasicFeedHandler(Receiver& line_a, Receiver& line_b, Fifo3<MarketTick>& out,
+                     const FeedHandlerConfig& config = FeedHandlerConfig{});
+
+    BasicFeedHandler(const BasicFeedHandler&) = delete;
+    BasicFeedHandler& operator=(const BasicFeedHandler&) = delete;
+
+    // One batch read from each line: returns ticks pushed (0 if no line
+    // had anything new), or -1 once every line closed or failed.
+    ssize_t poll();
+
+    // Polls until stop is set or every line is closed
+    void run(const std::atomic<bool>& stop);
+
+    // Takes the oldest sequence gap not yet taken; false if there is none
+    bool next_gap(SequenceGap& gap) { return arbiter.next_gap(gap); }
+    // After recovery: the snapshot covered every sequence before next
+    void reset_sequence(uint64_t next) { arbiter.reset(next); }
+    // Next sequence the book is waiting for
+    uint64_t expected_sequence() const { return arbiter.expected(); }
+
+    // Messages pushed: one per sequence, whichever line it came from
+    uint64_t message_count() const { return messages; }
+    // Bytes of every packet, malformed ones included
+    uint64_t byte_count() const { return bytes; }
+    // Packet bytes that did not form a whole message
+    uint64_t malformed_count() const { return malformed; }
+    // Pushes that found the Fifo3 full and had to wait
+    uint64_t full_wait_count() const { return full_waits; }
+    // Copies dropped because another line delivered them first
+    uint64_t duplicate_count() const { return arbiter.duplicate_count(); }
+    // Copies dropped because the window had already passed their sequence
+    uint64_t late_count() const { return arbiter.late_count(); }
+    uint64_t gap_count() const { return arbiter.gap_count(); }
+    // Sequences in all the gaps
+    uint64_t lost_count() const { return arbiter.lost_count(); }
+
+private:
+    size_t publish(size_t line, const FeedPacket& packet);
+    void push(const MarketTick& tick);
+
+    Receiver* lines[2];
+    size_t line_count;
+    bool closed[2] = {false, false};
+    Fifo3<MarketTick>& out;
+    std::vector<FeedPacket> packets;
+    SequenceArbiter arbiter;
+
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    uint64_t malformed = 0;
+    uint64_t full_waits = 0;
+};
+
+// A socket through the kernel: TCP, UDP, or a pipe
+using FeedHandler = BasicFeedHandler<SocketReceiver>;
+using MulticastFeedHandler = BasicFeedHandler<UdpMulticastReceiver>;
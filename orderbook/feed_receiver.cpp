@@ -0,0 +1,214 @@
+#include "feed_receiver.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace {
+    bool is_stream_socket(int fd) {
+        int type = 0;
+        socklen_t length = sizeof(type);
+        if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &length) != 0) {
+            return true;  // not a socket (pipe, file): read it as a byte stream
+        }
+        return type == SOCK_STREAM;
+    }
+
+    bool would_block() {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+
+    uint64_t to_ns(const timespec& time) {
+        return static_cast<uint64_t>(time.tv_sec) * 1'000'000'000ull + static_cast<uint64_t>(time.tv_nsec);
+    }
+
+    // The receive stamp in a datagram's ancillary data: the raw hardware
+    // stamp if the NIC gave one, else the software one, else 0
+    uint64_t receive_stamp(msghdr& header) {
+        for (cmsghdr* message = CMSG_FIRSTHDR(&header); message; message = CMSG_NXTHDR(&header, message)) {
+            if (message->cmsg_level != SOL_SOCKET) continue;
+            if (message->cmsg_type == SCM_TIMESTAMPING) {
+                scm_timestamping stamps;
+                std::memcpy(&stamps, CMSG_DATA(message), sizeof(stamps));
+                uint64_t hardware = to_ns(stamps.ts[2]);
+                return hardware != 0 ? hardware : to_ns(stamps.ts[0]);
+            }
+            if (message->cmsg_type == SCM_TIMESTAMPNS) {
+                timespec stamp;
+                std::memcpy(&stamp, CMSG_DATA(message), sizeof(stamp));
+                return to_ns(stamp);
+            }
+        }
+        return 0;
+    }
+
+    [[noreturn]] void fail(int fd, const std::string& what) {
+        std::string message = "UdpMulticastReceiver: " + what + ": " + std::strerror(errno);
+        if (fd >= 0) close(fd);
+        throw std::runtime_error(message);
+    }
+}
+
+SocketReceiver::SocketReceiver(int fd, const SocketReceiverConfig& config, bool dont_wait)
+    : fd(fd), stream(is_stream_socket(fd)) {
+    if (stream) {
+        if (config.buffer_bytes < MarketTick::WIRE_SIZE) {
+            throw std::invalid_argument("SocketReceiver: buffer smaller than one message");
+        }
+        flags = dont_wait ? MSG_DONTWAIT : 0;
+        buffer.resize(config.buffer_bytes);
+        return;
+    }
+
+    if (config.datagram_batch == 0 || config.max_datagram_bytes < MarketTick::WIRE_SIZE) {
+        throw std::invalid_argument("SocketReceiver: invalid datagram batch");
+    }
+    flags = dont_wait ? MSG_DONTWAIT : MSG_WAITFORONE;
+    control_bytes = CMSG_SPACE(sizeof(scm_timestamping)) + CMSG_SPACE(sizeof(timespec));
+    buffer.resize(config.datagram_batch * config.max_datagram_bytes);
+    control.resize(config.datagram_batch * control_bytes);
+    headers.resize(config.datagram_batch);
+    slices.resize(config.datagram_batch);
+    for (size_t i = 0; i < config.datagram_batch; ++i) {
+        slices[i] = {buffer.data() + i * config.max_datagram_bytes, config.max_datagram_bytes};
+        headers[i] = {};
+        headers[i].msg_hdr.msg_iov = &slices[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+ssize_t SocketReceiver::receive(FeedPacket* packets, size_t capacity) {
+    if (capacity == 0) return 0;
+    return stream ? receive_stream(packets) : receive_datagrams(packets, capacity);
+}
+
+ssize_t SocketReceiver::receive_stream(FeedPacket* packets) {
+    // The last packet has been consumed: keep only its trailing fragment
+    if (framed > 0) {
+        if (pending > 0) std::memmove(buffer.data(), buffer.data() + framed, pending);
+        framed = 0;
+    }
+
+    ssize_t received = recv(fd, buffer.data() + pending, buffer.size() - pending, flags);
+    if (received == 0) return -1;
+    if (received < 0) return would_block() ? 0 : -1;
+
+    // Frame every complete message where it landed; a short read simply
+    // leaves a partial message behind for the next recv to complete.
+    const size_t available = pending + static_cast<size_t>(received);
+    framed = available - available % MarketTick::WIRE_SIZE;
+    pending = available - framed;
+    if (framed == 0) return 0;
+    packets[0] = {buffer.data(), framed, 0};
+    return 1;
+}
+
+ssize_t SocketReceiver::receive_datagrams(FeedPacket* packets, size_t capacity) {
+    const size_t batch = capacity < headers.size() ? capacity : headers.size();
+    for (size_t i = 0; i < batch; ++i) {
+        // The kernel shrinks msg_controllen to what it wrote; give it all back
+        headers[i].msg_hdr.msg_control = control.data() + i * control_bytes;
+        headers[i].msg_hdr.msg_controllen = control_bytes;
+    }
+    int received = recvmmsg(fd, headers.data(), static_cast<unsigned>(batch), flags, nullptr);
+    if (received < 0) return would_block() ? 0 : -1;
+
+    for (int i = 0; i < received; ++i) {
+        packets[i] = {static_cast<const char*>(slices[i].iov_base), headers[i].msg_len,
+                      receive_stamp(headers[i].msg_hdr)};
+    }
+    return received;
+}
+
+UdpMulticastReceiver::UdpMulticastReceiver(const UdpMulticastConfig& config)
+    : fd(open_socket(config, busy_poll, hardware_stamps, bound_port))
+    , socket_receiver(fd, SocketReceiverConfig{0, config.datagram_batch, config.max_datagram_bytes},
+                      config.busy_poll_us > 0) {}
+
+UdpMulticastReceiver::~UdpMulticastReceiver() {
+    close(fd);
+}
+
+int UdpMulticastReceiver::open_socket(const UdpMulticastConfig& config, bool& busy_poll, bool& hardware_stamps,
+                                      uint16_t& bound_port) {
+    // Checked here as well, so nothing is left open when it would throw
+    if (config.datagram_batch == 0 || config.max_datagram_bytes < MarketTick::WIRE_SIZE) {
+        throw std::invalid_argument("UdpMulticastReceiver: invalid datagram batch");
+    }
+    in_addr group{};
+    in_addr local{};
+    local.s_addr = htonl(INADDR_ANY);
+    if (inet_pton(AF_INET, config.group.c_str(), &group) != 1 || !IN_MULTICAST(ntohl(group.s_addr))) {
+        throw std::invalid_argument("UdpMulticastReceiver: not an IPv4 multicast group: " + config.group);
+    }
+    if (!config.interface_address.empty() && inet_pton(AF_INET, config.interface_address.c_str(), &local) != 1) {
+        throw std::invalid_argument("UdpMulticastReceiver: not an IPv4 address: " + config.interface_address);
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) fail(fd, "socket");
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (config.receive_buffer_bytes > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &config.receive_buffer_bytes, sizeof(config.receive_buffer_bytes));
+    }
+
+    // Bound to the group, not INADDR_ANY, so other groups on the port stay out
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr = group;
+    address.sin_port = htons(config.port);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) fail(fd, "bind");
+    socklen_t length = sizeof(address);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+    bound_port = ntohs(address.sin_port);
+
+    ip_mreq membership{};
+    membership.imr_multiaddr = group;
+    membership.imr_interface = local;
+    if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0) {
+        fail(fd, "join " + config.group);
+    }
+
+    if (config.busy_poll_us > 0) {
+        // The budget is how long one receive may spin in the driver; the
+        // socket goes non-blocking so an empty poll returns to the handler
+        busy_poll = setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &config.busy_poll_us, sizeof(config.busy_poll_us)) == 0;
+#ifdef SO_PREFER_BUSY_POLL
+        if (busy_poll) setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &one, sizeof(one));
+#endif
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    bool stamping = false;  // SO_TIMESTAMPING on, software stamps at least
+    if (config.hardware_timestamps) {
+        bool device_ready = true;
+        if (!config.interface_name.empty()) {
+            hwtstamp_config device{};
+            device.tx_type = HWTSTAMP_TX_OFF;
+            device.rx_filter = HWTSTAMP_FILTER_ALL;
+            ifreq request{};
+            std::strncpy(request.ifr_name, config.interface_name.c_str(), IFNAMSIZ - 1);
+            request.ifr_data = reinterpret_cast<char*>(&device);
+            device_ready = ioctl(fd, SIOCSHWTSTAMP, &request) == 0;
+        }
+        int flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+                    SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        stamping = setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0;
+        hardware_stamps = stamping && device_ready;
+    }
+    if (!stamping) {
+        setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+    }
+    return fd;
+}
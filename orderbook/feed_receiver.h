@@ -0,0 +1,138 @@
+#pragma once
+#include "market_tick.h"
+#include <cstdint>
+#include <string>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <vector>
+
+// One unit of input as a receiver hands it to the feed handler: whole
+// packed MarketTick messages, possibly followed by a fragment too short to
+// be one (counted as malformed), and when the packet arrived.
+struct FeedPacket {
+    const char* data;
+    size_t length;
+    // Receive time in ns: the NIC's when hardware timestamping is on, else
+    // the kernel's when software timestamping is on, else 0. Hardware
+    // stamps run on the NIC's clock (sync it with phc2sys to compare).
+    uint64_t receive_ns;
+};
+
+// The transports a BasicFeedHandler can read, chosen per site without
+// touching the handler or the book. A receiver is any class with
+//
+//     // Fills up to capacity packets; returns how many, 0 if nothing was
+//     // ready, or -1 once the source closed or failed. The packet memory
+//     // stays valid until the next receive().
+//     ssize_t receive(FeedPacket* packets, size_t capacity);
+//
+// called from the handler's thread only. SocketReceiver reads any socket
+// through the kernel; UdpMulticastReceiver joins a multicast group and
+// busy-polls it. A kernel-bypass receiver (AF_XDP, DPDK) plugs into the
+// same slot: it returns packets pointing into its own umem or mbufs and
+// recycles them on the next receive(). Add it to the instantiations at the
+// end of feed_handler.cpp.
+
+struct SocketReceiverConfig {
+    // Receive buffer for a stream socket; one recv() fills as much as fits
+    size_t buffer_bytes = 1 << 20;
+    // Datagrams fetched per recvmmsg() on a datagram socket, and the most
+    // bytes kept of each
+    size_t datagram_batch = 64;
+    size_t max_datagram_bytes = 2048;
+};
+
+// Reads a file descriptor the caller owns, with one syscall per batch.
+//
+// A stream socket (or pipe, or file) is read with one large recv(); the
+// messages are framed in place in the buffer and one packet covers them
+// all, and only a trailing partial message is moved to the front before
+// the next read. A datagram socket is read with recvmmsg(), one packet per
+// datagram, each carrying whole messages; if timestamping is enabled on
+// the socket (SO_TIMESTAMPING or SO_TIMESTAMPNS) the stamps are picked up.
+class SocketReceiver {
+public:
+    explicit SocketReceiver(int fd, const SocketReceiverConfig& config = SocketReceiverConfig{},
+                            bool dont_wait = false);
+
+    SocketReceiver(const SocketReceiver&) = delete;
+    SocketReceiver& operator=(const SocketReceiver&) = delete;
+
+    ssize_t receive(FeedPacket* packets, size_t capacity);
+
+    int descriptor() const { return fd; }
+    bool is_stream() const { return stream; }
+
+private:
+    ssize_t receive_stream(FeedPacket* packets);
+    ssize_t receive_datagrams(FeedPacket* packets, size_t capacity);
+
+    int fd;
+    bool stream;
+    int flags;  // recv/recvmmsg flags
+
+    std::vector<char> buffer;
+    size_t framed = 0;   // stream: bytes handed out by the last receive()
+    size_t pending = 0;  // stream: bytes of a partial message after them
+    std::vector<mmsghdr> headers;  // datagram: one per buffer slice
+    std::vector<iovec> slices;
+    std::vector<char> control;  // datagram: ancillary data for timestamps
+    size_t control_bytes = 0;   // per datagram
+};
+
+struct UdpMulticastConfig {
+    std::string group = "239.255.0.1";
+    uint16_t port = 30001;
+    // Local IPv4 address of the interface to join on; empty lets the
+    // kernel choose by route
+    std::string interface_address;
+    // Device name (eth0) for SIOCSHWTSTAMP; empty leaves the NIC's
+    // timestamping configuration to the operator (hwstamp_ctl)
+    std::string interface_name;
+    // SO_BUSY_POLL budget in microseconds; the socket is then non-blocking
+    // and the handler spins on it. 0 blocks in the kernel instead.
+    int busy_poll_us = 50;
+    bool hardware_timestamps = true;
+    int receive_buffer_bytes = 8 << 20;  // SO_RCVBUF
+    size_t datagram_batch = 64;
+    size_t max_datagram_bytes = 2048;
+};
+
+// Joins an IPv4 multicast group and reads it with recvmmsg(). The socket
+// uses SO_BUSY_POLL, so the driver is polled from the receiving thread
+// instead of waiting for an interrupt and a wakeup. It also uses
+// SO_TIMESTAMPING and requests hardware receive stamps, falling back to
+// the kernel's software stamp when the NIC gives none.
+//
+// Construction throws std::runtime_error if the socket cannot be opened,
+// bound or joined to the group. Busy polling and hardware stamping
+// depend on privileges (CAP_NET_ADMIN) and the NIC, so failing to get
+// them is not an error: check busy_polling() and hardware_timestamping().
+class UdpMulticastReceiver {
+public:
+    explicit UdpMulticastReceiver(const UdpMulticastConfig& config = UdpMulticastConfig{});
+    ~UdpMulticastReceiver();
+
+    UdpMulticastReceiver(const UdpMulticastReceiver&) = delete;
+    UdpMulticastReceiver& operator=(const UdpMulticastReceiver&) = delete;
+
+    ssize_t receive(FeedPacket* packets, size_t capacity) { return socket_receiver.receive(packets, capacity); }
+
+    bool busy_polling() const { return busy_poll; }
+    // Hardware stamps were requested and accepted; a NIC that still gives
+    // none leaves the software stamp in their place
+    bool hardware_timestamping() const { return hardware_stamps; }
+    // Port actually bound (config.port 0 picks an ephemeral one)
+    uint16_t port() const { return bound_port; }
+
+private:
+    static int open_socket(const UdpMulticastConfig& config, bool& busy_poll, bool& hardware_stamps,
+                           uint16_t& bound_port);
+
+    bool busy_poll = false;
+    bool hardware_stamps = false;
+    uint16_t bound_port = 0;
+    int fd;
+    SocketReceiver socket_receiver;
+};
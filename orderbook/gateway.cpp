@@ -0,0 +1,353 @@
+#include "gateway.h"
+#include "order_entry.h"
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    // How long an idle loop waits in epoll_wait before looking at stop
+    constexpr int STOP_POLL_MS = 100;
+    constexpr int MAX_EVENTS = 256;
+    constexpr uint32_t SLOT_BITS = 16;
+    constexpr uint32_t SLOT_MASK = (uint32_t{1} << SLOT_BITS) - 1;
+    constexpr uint64_t LISTENER = 0;  // epoll data of the listening socket; sessions are slot + 1
+
+    constexpr uint32_t READ_EVENTS = EPOLLIN | EPOLLRDHUP | EPOLLET;
+}
+
+struct Gateway::Session {
+    int fd = -1;
+    uint32_t id = 0;  // 0 while the slot is free
+    uint32_t generation = 0;
+    std::vector<char> in;
+    std::vector<char> out;
+    size_t sent = 0;  // bytes of out already sent
+    uint64_t awaiting = 0;  // replies still due: an ACK per command, then its trades
+    SessionTask task;
+    // Set while suspended on Readable / on Yield
+    std::coroutine_handle<> waiting;
+    std::coroutine_handle<> yielded;
+    bool queued = false;    // in Gateway::unsent
+    bool writing = false;   // EPOLLOUT armed: the socket took only part of out
+    bool closing = false;   // close at the next flush, unsent output dropped
+};
+
+Gateway::SessionTask& Gateway::SessionTask::operator=(SessionTask&& other) noexcept {
+    if (this != &other) {
+        if (handle) handle.destroy();
+        handle = std::exchange(other.handle, {});
+    }
+    return *this;
+}
+
+Gateway::SessionTask::~SessionTask() {
+    if (handle) handle.destroy();
+}
+
+void Gateway::Readable::await_suspend(std::coroutine_handle<> handle) noexcept { session.waiting = handle; }
+
+void Gateway::Yield::await_suspend(std::coroutine_handle<> handle) {
+    session.yielded = handle;
+    gateway.yielded.push_back(&session);
+}
+
+Gateway::Gateway(BookManager& books, const GatewayConfig& config) : books(books), config(config) {
+    if (config.max_sessions == 0 || config.max_sessions > SLOT_MASK + 1) {
+        throw std::invalid_argument("Gateway: max_sessions must be between 1 and 65536");
+    }
+    if (this->config.buffer_bytes < order_entry::MAX_MESSAGE_SIZE) {
+        this->config.buffer_bytes = order_entry::MAX_MESSAGE_SIZE;
+    }
+    sessions.resize(config.max_sessions);
+    for (uint32_t slot = static_cast<uint32_t>(config.max_sessions); slot-- > 0;) {
+        sessions[slot] = std::make_unique<Session>();
+        free_slots.push_back(slot);
+    }
+}
+
+Gateway::~Gateway() {
+    for (auto& session : sessions) {
+        if (session->fd >= 0) close_session(*session);
+    }
+    if (epoll_fd >= 0) close(epoll_fd);
+    if (listen_fd >= 0) close(listen_fd);
+}
+
+bool Gateway::listen() {
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (listen_fd < 0) return false;
+
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(config.port);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = LISTENER;
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listen_fd, SOMAXCONN) != 0 || (epoll_fd = epoll_create1(0)) < 0 ||
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) != 0) {
+        int saved = errno;
+        close(listen_fd);
+        listen_fd = -1;
+        if (epoll_fd >= 0) close(epoll_fd);
+        epoll_fd = -1;
+        errno = saved;
+        return false;
+    }
+
+    socklen_t length = sizeof(address);
+    getsockname(listen_fd, reinterpret_cast<sockaddr*>(&address), &length);
+    bound_port = ntohs(address.sin_port);
+    return true;
+}
+
+void Gateway::run(const std::atomic<bool>& stop) {
+    epoll_event events[MAX_EVENTS];
+    while (!stop.load(std::memory_order_relaxed)) {
+        // Replies are polled, not signalled: spin while any are due
+        const int timeout = in_flight > 0 || !yielded.empty() ? 0 : STOP_POLL_MS;
+        const int count = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout);
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.u64 == LISTENER) {
+                accept_sessions();
+                continue;
+            }
+            Session& session = *sessions[events[i].data.u64 - 1];
+            if (session.fd < 0) continue;
+            if (events[i].events & EPOLLOUT) flush(session);
+            if (session.waiting && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+                resume(session, std::exchange(session.waiting, {}));
+            }
+        }
+
+        replies.clear();
+        books.poll_replies(replies);
+        for (const CommandReply& reply : replies) {
+            // An ACK is due for each command and announces the trades due after it
+            const uint64_t announced = reply.kind == CommandReply::ACK ? reply.trade_count : 0;
+            in_flight = in_flight - 1 + announced;
+            const uint32_t id = static_cast<uint32_t>(reply.tag >> 32);
+            Session& session = *sessions[id & SLOT_MASK];
+            if (session.id != id) continue;  // the session closed; its slot may serve another
+            session.awaiting = session.awaiting - 1 + announced;
+            this->reply(session, reply);
+        }
+
+        // The rings have room again: let sessions that found one full retry
+        resuming.swap(yielded);
+        for (Session* session : resuming) {
+            if (session->yielded) resume(*session, std::exchange(session->yielded, {}));
+        }
+        resuming.clear();
+
+        for (Session* session : unsent) {
+            if (session->queued) flush(*session);
+        }
+        unsent.clear();
+    }
+
+    for (auto& session : sessions) {
+        if (session->fd >= 0) close_session(*session);
+    }
+}
+
+void Gateway::accept_sessions() {
+    while (true) {
+        const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0) return;  // EAGAIN: no more pending, or an aborted connection
+        if (free_slots.empty()) {
+            close(fd);
+            refused++;
+            continue;
+        }
+
+        const uint32_t slot = free_slots.back();
+        Session& session = *sessions[slot];
+        epoll_event event{};
+        event.events = READ_EVENTS;
+        event.data.u64 = uint64_t{slot} + 1;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            continue;
+        }
+        free_slots.pop_back();
+        live_sessions++;
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        session.fd = fd;
+        session.generation = (session.generation + 1) & 0xFFFF;
+        if (session.generation == 0) session.generation = 1;  // keeps every tag non-zero
+        session.id = (session.generation << SLOT_BITS) | slot;
+        session.in.resize(config.buffer_bytes);
+        session.task = session_loop(session);
+        session.task.resume();
+        close_if_finished(session);
+    }
+}
+
+Gateway::SessionTask Gateway::session_loop(Session& session) {
+    using namespace order_entry;
+    size_t pending = 0;
+
+    while (true) {
+        const ssize_t received = recv(session.fd, session.in.data() + pending, session.in.size() - pending, 0);
+        if (received == 0) co_return;
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) co_return;
+            co_await Readable{session};  // edge-triggered: the socket was read dry first
+            continue;
+        }
+
+        // Frame and submit every complete message where it landed
+        const size_t available = pending + static_cast<size_t>(received);
+        size_t offset = 0;
+        while (available - offset >= HEADER_SIZE) {
+            const char* message = session.in.data() + offset;
+            const size_t length = message_length(message);
+            if (length != inbound_size(message_type(message))) {
+                protocol_errors++;
+                co_return;  // what was framed is still answered
+            }
+            if (available - offset < length) break;
+            while (!submit(session, message)) {
+                co_await Yield{*this, session};
+            }
+            messages++;
+            offset += length;
+        }
+
+        pending = available - offset;
+        if (pending > 0) {
+            std::memmove(session.in.data(), session.in.data() + offset, pending);
+        }
+    }
+}
+
+bool Gateway::submit(Session& session, const char* message) {
+    using namespace order_entry;
+    SymbolCommand command{};
+    command.command = decode_command(message);
+    if (command.command.order.owner_id == 0) command.command.order.owner_id = config.owner_id;
+    command.symbol_id = symbol_of(command.command.order.order_id);
+    command.tag = (uint64_t{session.id} << 32) | client_seq(message);
+
+    if (books.submit(command)) {
+        session.awaiting++;
+        in_flight++;
+        return true;
+    }
+    if (books.has_symbol(command.symbol_id)) return false;  // ring full: retry
+
+    CommandReply rejected{};
+    rejected.tag = command.tag;
+    rejected.symbol_id = command.symbol_id;
+    rejected.kind = CommandReply::ACK;
+    rejected.order_id = command.command.order.order_id;
+    reply(session, rejected);
+    return true;
+}
+
+void Gateway::reply(Session& session, const CommandReply& reply) {
+    using namespace order_entry;
+    const uint32_t seq = static_cast<uint32_t>(reply.tag);
+    const size_t at = session.out.size();
+    if (reply.kind == CommandReply::ACK) {
+        session.out.resize(at + ACK_SIZE);
+        encode_ack(session.out.data() + at, seq, reply.order_id, reply.accepted, reply.trade_count);
+    } else {
+        session.out.resize(at + TRADE_SIZE);
+        encode_trade(session.out.data() + at, seq, reply.trade);
+    }
+    if (session.out.size() - session.sent > config.max_output_bytes && !session.closing) {
+        session.closing = true;
+        slow_sessions++;
+    }
+    if (!session.queued) {
+        session.queued = true;
+        unsent.push_back(&session);
+    }
+}
+
+void Gateway::flush(Session& session) {
+    session.queued = false;
+    while (!session.closing && session.sent < session.out.size()) {
+        const ssize_t sent = send(session.fd, session.out.data() + session.sent, session.out.size() - session.sent,
+                                  MSG_NOSIGNAL);
+        if (sent >= 0) {
+            session.sent += static_cast<size_t>(sent);
+            continue;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            session.closing = true;
+            break;
+        }
+        // The peer is behind: wait for room instead of spinning on send()
+        if (!session.writing) {
+            epoll_event event{};
+            event.events = READ_EVENTS | EPOLLOUT;
+            event.data.u64 = uint64_t{session.id & SLOT_MASK} + 1;
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, session.fd, &event);
+            session.writing = true;
+        }
+        break;
+    }
+
+    if (session.sent == session.out.size()) {
+        session.out.clear();
+        session.sent = 0;
+        if (session.writing) {
+            epoll_event event{};
+            event.events = READ_EVENTS;
+            event.data.u64 = uint64_t{session.id & SLOT_MASK} + 1;
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, session.fd, &event);
+            session.writing = false;
+        }
+    } else if (session.sent > session.out.size() / 2) {
+        session.out.erase(session.out.begin(), session.out.begin() + static_cast<std::ptrdiff_t>(session.sent));
+        session.sent = 0;
+    }
+    if (session.closing) close_session(session);
+    else close_if_finished(session);
+}
+
+void Gateway::resume(Session& session, std::coroutine_handle<> handle) {
+    handle.resume();
+    close_if_finished(session);
+}
+
+// A session whose coroutine has ended stays open until the replies to what
+// it submitted are sent, so a client that half-closes still gets them
+void Gateway::close_if_finished(Session& session) {
+    if (session.fd < 0 || !session.task.done()) return;
+    if (session.task.failed() || (session.awaiting == 0 && session.out.empty())) close_session(session);
+}
+
+void Gateway::close_session(Session& session) {
+    const uint32_t slot = session.id & SLOT_MASK;
+    close(session.fd);  // also leaves the epoll set
+    session.fd = -1;
+    session.id = 0;
+    session.task = SessionTask{};
+    session.waiting = {};
+    session.yielded = {};
+    session.out.clear();
+    session.sent = 0;
+    session.awaiting = 0;
+    session.queued = false;
+    session.writing = false;
+    session.closing = false;
+    free_slots.push_back(slot);
+    live_sessions--;
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include "book_manager.h"
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+struct GatewayConfig {
+    uint16_t port = 9000;  // 0 picks an ephemeral port, see port()
+    // Sessions served at once; connections beyond it are closed on accept
+    size_t max_sessions = 1024;
+    // Receive buffer per session; one recv() fills as much as fits
+    size_t buffer_bytes = 1 << 16;
+    // Replies a session may leave unread before it is dropped as too slow
+    size_t max_output_bytes = 1 << 22;
+    // Stamped on every order without one, as OrderEntryServerConfig::owner_id
+    uint32_t owner_id = 0;
+};
+
+// Order-entry front end for a BookManager: many concurrent client sessions
+// speaking the protocol in order_entry.h, all on one thread.
+//
+// Each session is a C++20 coroutine that reads, frames and decodes its
+// socket and submits every command to the shard owning its symbol (see
+// order_entry::symbol_of). A session suspends instead of blocking: on an
+// empty socket until epoll reports it readable again, and on a full shard
+// ring until the loop has taken the shards' replies. One epoll_wait
+// therefore serves every session, with no thread and no context switch per
+// client, so the gateway's CPU grows with messages, not sessions.
+//
+// Commands carry a tag naming their session, and the shards answer each
+// with its ACK and TRADE messages through BookManager::poll_replies; the
+// loop appends them to the session's output and sends them without
+// blocking. Replies keep the order of the session's commands per symbol;
+// across symbols they may interleave, and clients match them by
+// client_seq. A command for a symbol the manager does not hold is ACKed
+// as rejected by the gateway itself.
+//
+// Threading contract: run() is the BookManager's submit() producer and
+// poll_replies() consumer, so nothing else may submit or poll replies and
+// the manager is stopped only after run() returns. Fills of untagged
+// commands submitted before still go to poll_executions.
+class Gateway {
+public:
+    explicit Gateway(BookManager& books, const GatewayConfig& config = GatewayConfig{});
+    ~Gateway();
+
+    Gateway(const Gateway&) = delete;
+    Gateway& operator=(const Gateway&) = delete;
+
+    // Binds and listens on the configured port; false (errno set) on failure
+    bool listen();
+
+    // Port actually bound, once listen() succeeded
+    uint16_t port() const { return bound_port; }
+
+    // Serves sessions until stop is set, then closes them. The manager must
+    // be started.
+    void run(const std::atomic<bool>& stop);
+
+    size_t session_count() const { return live_sessions; }
+    uint64_t message_count() const { return messages; }
+    uint64_t protocol_error_count() const { return protocol_errors; }
+    // Sessions closed for leaving max_output_bytes of replies unread
+    uint64_t slow_session_count() const { return slow_sessions; }
+    // Connections closed on accept because max_sessions were open
+    uint64_t refused_count() const { return refused; }
+
+private:
+    struct Session;
+
+    // The coroutine of one session. The loop starts it and resumes it; it
+    // finishes when its peer closes or breaks the protocol.
+    class SessionTask {
+    public:
+        struct promise_type {
+            SessionTask get_return_object() {
+                return SessionTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { failed = true; }
+
+            bool failed = false;
+        };
+
+        SessionTask() = default;
+        explicit SessionTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+        SessionTask(SessionTask&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+        SessionTask& operator=(SessionTask&& other) noexcept;
+        ~SessionTask();
+
+        bool done() const { return !handle || handle.done(); }
+        bool failed() const { return handle && handle.promise().failed; }
+        void resume() { handle.resume(); }
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    // Suspends the session until its socket is readable
+    struct Readable {
+        Session& session;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) noexcept;
+        void await_resume() const noexcept {}
+    };
+
+    // Suspends the session until the loop has drained the shards' replies
+    struct Yield {
+        Gateway& gateway;
+        Session& session;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const noexcept {}
+    };
+
+    SessionTask session_loop(Session& session);
+    void accept_sessions();
+    bool submit(Session& session, const char* message);
+    void reply(Session& session, const CommandReply& reply);
+    void flush(Session& session);
+    void resume(Session& session, std::coroutine_handle<> handle);
+    void close_if_finished(Session& session);
+    void close_session(Session& session);
+
+    BookManager& books;
+    GatewayConfig config;
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    uint16_t bound_port = 0;
+
+    // Sessions by slot; a session id is its slot in the low 16 bits and the
+    // slot's generation above, so a reply for a closed session finds a
+    // newer id in its slot and is dropped
+    std::vector<std::unique_ptr<Session>> sessions;
+    std::vector<uint32_t> free_slots;
+    size_t live_sessions = 0;
+    // Sessions waiting on a full shard ring, resumed after every poll.
+    // These lists may name a session that closed since; the flags in
+    // Session say whether the entry still applies.
+    std::vector<Session*> yielded;
+    std::vector<Session*> resuming;
+    std::vector<Session*> unsent;  // output appended since the last flush
+    std::vector<CommandReply> replies;
+
+    uint64_t messages = 0;
+    uint64_t in_flight = 0;  // replies the shards still owe, as Session::awaiting
+    uint64_t protocol_errors = 0;
+    uint64_t slow_sessions = 0;
+    uint64_t refused = 0;
+};
@@ -0,0 +1,354 @@
+#include "journal.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+namespace {
+    constexpr char MAGIC[8] = {'O', 'B', 'J', 'R', 'N', 'L', 0, 0};
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t HEADER_SIZE = 64;
+    constexpr size_t RECORD_SIZE = sizeof(JournalRecord);
+    constexpr size_t POPULATE_AHEAD = size_t{4} << 20;
+    constexpr size_t REPLAY_BATCH = 4096;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t record_size;
+        uint32_t generation;  // bumped by every writer that opens the file
+        char reserved[HEADER_SIZE - 20];
+    };
+    static_assert(sizeof(FileHeader) == HEADER_SIZE);
+
+    bool valid_header(const char* base) {
+        FileHeader header;
+        std::memcpy(&header, base, sizeof(header));
+        return std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION &&
+               header.record_size == RECORD_SIZE;
+    }
+
+    uint32_t checksum_of(JournalRecord record) {
+        record.checksum = 0;
+        uint64_t words[RECORD_SIZE / 8];
+        std::memcpy(words, &record, RECORD_SIZE);
+        uint64_t hash = 0x9E3779B97F4A7C15ull;
+        for (uint64_t word : words) {
+            hash = (hash ^ word) * 0x100000001B3ull;
+            hash ^= hash >> 29;
+        }
+        return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+
+    // Reads the record at index i and checks it is the intact i + 1st record,
+    // written no earlier than the record before it (whose generation is passed
+    // in and updated)
+    bool read_record(const char* base, size_t i, JournalRecord& record, uint32_t& generation) {
+        std::memcpy(&record, base + HEADER_SIZE + i * RECORD_SIZE, RECORD_SIZE);
+        if (record.sequence != i + 1 || record.generation < generation || record.checksum != checksum_of(record)) {
+            return false;
+        }
+        generation = record.generation;
+        return true;
+    }
+
+    size_t intact_records(const char* base, size_t file_size) {
+        const size_t slots = (file_size - HEADER_SIZE) / RECORD_SIZE;
+        JournalRecord record;
+        uint32_t generation = 0;
+        size_t count = 0;
+        while (count < slots && read_record(base, count, record, generation)) ++count;
+        return count;
+    }
+
+    // Stop orders are never icebergs, so their stop price takes the slot of
+    // the display quantity
+    bool is_stop(OrderType type) {
+        return type == OrderType::STOP || type == OrderType::STOP_LIMIT;
+    }
+
+    JournalRecord command_record(const Command& command) {
+        JournalRecord record{};
+        record.kind = JournalRecord::COMMAND;
+        record.command_type = static_cast<uint8_t>(command.type);
+        record.is_buy = command.order.is_buy;
+        record.order_type = static_cast<uint8_t>(command.order.order_type);
+        record.order_id = command.order.order_id;
+        record.sell_order_id = is_stop(command.order.order_type) ? std::bit_cast<uint64_t>(command.order.stop_price)
+                                                                 : command.order.display_quantity;
+        record.price = command.order.price;
+        record.quantity = command.order.quantity;
+        record.timestamp_ns = command.order.timestamp_ns;
+        record.owner_id = command.order.owner_id;
+        return record;
+    }
+
+    JournalRecord trade_record(const Trade& trade) {
+        JournalRecord record{};
+        record.kind = JournalRecord::TRADE;
+        record.order_id = trade.buy_order_id;
+        record.sell_order_id = trade.sell_order_id;
+        record.price = trade.price;
+        record.quantity = trade.quantity;
+        record.timestamp_ns = trade.timestamp_ns;
+        return record;
+    }
+
+    Command to_command(const JournalRecord& record) {
+        Command command{};
+        command.type = static_cast<CommandType>(record.command_type);
+        command.order = {record.order_id, record.is_buy != 0, static_cast<OrderType>(record.order_type),
+                         record.price, record.quantity, record.timestamp_ns, record.sell_order_id, record.owner_id};
+        if (is_stop(command.order.order_type)) {
+            command.order.stop_price = std::bit_cast<double>(record.sell_order_id);
+            command.order.display_quantity = 0;
+        }
+        return command;
+    }
+
+    bool same_fill(const Trade& a, const Trade& b) {
+        return a.buy_order_id == b.buy_order_id && a.sell_order_id == b.sell_order_id &&
+               a.price == b.price && a.quantity == b.quantity;
+    }
+
+    size_t page_size() {
+        static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return size;
+    }
+}
+
+JournalWriter::JournalWriter(const JournalConfig& config) : config(config) {
+    fd = open(config.path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) throw std::runtime_error("JournalWriter: cannot open " + config.path);
+
+    struct stat st;
+    fstat(fd, &st);
+    const size_t existing = static_cast<size_t>(st.st_size);
+    capacity = std::max(existing, config.capacity_bytes);
+    capacity = HEADER_SIZE + (capacity - std::min(capacity, HEADER_SIZE)) / RECORD_SIZE * RECORD_SIZE;
+    if (capacity < HEADER_SIZE + RECORD_SIZE || posix_fallocate(fd, 0, static_cast<off_t>(capacity)) != 0) {
+        close(fd);
+        throw std::runtime_error("JournalWriter: cannot preallocate " + config.path);
+    }
+
+    void* mapping = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("JournalWriter: cannot map " + config.path);
+    }
+    base = static_cast<char*>(mapping);
+
+    if (existing == 0) {
+        FileHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.record_size = RECORD_SIZE;
+        std::memcpy(base, &header, sizeof(header));
+    } else if (existing < HEADER_SIZE || !valid_header(base)) {
+        munmap(base, capacity);
+        close(fd);
+        throw std::runtime_error("JournalWriter: " + config.path + " is not a journal");
+    }
+
+    // Records this writer appends outrank anything an earlier one left
+    // beyond the intact prefix; the first commit makes the header durable
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    generation = ++header.generation;
+    std::memcpy(base, &header, sizeof(header));
+
+    const size_t records = intact_records(base, capacity);
+    next_sequence = records + 1;
+    tail = HEADER_SIZE + records * RECORD_SIZE;
+    written.store(tail, std::memory_order_relaxed);
+    durable.store(records, std::memory_order_relaxed);
+
+    populate_ahead(tail);
+    committer = std::thread([this] { commit_loop(); });
+}
+
+JournalWriter::~JournalWriter() {
+    stopping.store(true, std::memory_order_release);
+    committer.join();
+    munmap(base, capacity);
+    close(fd);
+}
+
+// Writes one record at the tail; callers check room and publish written
+void JournalWriter::append(JournalRecord record) {
+    record.sequence = next_sequence++;
+    record.generation = generation;
+    record.checksum = checksum_of(record);
+    std::memcpy(base + tail, &record, RECORD_SIZE);
+    tail += RECORD_SIZE;
+}
+
+bool JournalWriter::append_command(const Command& command) {
+    if (capacity - tail < RECORD_SIZE) return false;
+    append(command_record(command));
+    written.store(tail, std::memory_order_release);
+    return true;
+}
+
+bool JournalWriter::append_trades(std::span<const Trade> trades) {
+    if (capacity - tail < trades.size() * RECORD_SIZE) return false;
+    for (const Trade& trade : trades) append(trade_record(trade));
+    written.store(tail, std::memory_order_release);
+    return true;
+}
+
+bool JournalWriter::append_batch(std::span<const Command> commands, std::span<const CommandResult> results,
+                                 std::span<const Trade> trades) {
+    if (capacity - tail < (commands.size() + trades.size()) * RECORD_SIZE) return false;
+    size_t next_trade = 0;
+    for (size_t i = 0; i < commands.size(); ++i) {
+        append(command_record(commands[i]));
+        for (uint32_t t = 0; t < results[i].trade_count; ++t) {
+            append(trade_record(trades[next_trade++]));
+        }
+    }
+    written.store(tail, std::memory_order_release);
+    return true;
+}
+
+void JournalWriter::commit_loop() {
+    while (!stopping.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(config.commit_interval);
+        const size_t end = written.load(std::memory_order_acquire);
+        commit(end);
+        populate_ahead(end);
+    }
+    commit(written.load(std::memory_order_acquire));
+}
+
+// One msync for everything appended since the previous pass
+void JournalWriter::commit(size_t end) {
+    if (end == synced) return;
+    const size_t start = synced & ~(page_size() - 1);
+    if (msync(base + start, end - start, MS_SYNC) != 0) return;  // retried next pass
+    synced = end;
+    durable.store((end - HEADER_SIZE) / RECORD_SIZE, std::memory_order_release);
+}
+
+// Faults in writable pages ahead of the tail, so the appending thread finds
+// them mapped. MADV_POPULATE_WRITE leaves their contents alone; kernels
+// without it simply fall back to faulting on first touch.
+void JournalWriter::populate_ahead(size_t end) {
+    const size_t target = std::min(capacity, end + POPULATE_AHEAD);
+    if (populated >= target) return;
+    const size_t start = std::max(populated, end) & ~(page_size() - 1);
+    madvise(base + start, target - start, MADV_POPULATE_WRITE);
+    populated = target;
+}
+
+namespace {
+    // Read-only sequential mapping of a whole journal file
+    class JournalMapping {
+    public:
+        explicit JournalMapping(const std::string& path) {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) return;
+            struct stat st;
+            fstat(fd, &st);
+            size = static_cast<size_t>(st.st_size);
+            void* mapping = size >= HEADER_SIZE ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+            close(fd);
+            if (mapping == MAP_FAILED) return;
+            base = static_cast<const char*>(mapping);
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            madvise(mapping, size, MADV_WILLNEED);
+        }
+
+        ~JournalMapping() {
+            if (base) munmap(const_cast<char*>(base), size);
+        }
+
+        JournalMapping(const JournalMapping&) = delete;
+        JournalMapping& operator=(const JournalMapping&) = delete;
+
+        bool valid() const { return base && valid_header(base); }
+        size_t slots() const { return (size - HEADER_SIZE) / RECORD_SIZE; }
+
+        const char* base = nullptr;
+        size_t size = 0;
+    };
+}
+
+bool read_journal_commands(const std::string& path, std::vector<Command>& out) {
+    JournalMapping journal(path);
+    if (!journal.valid()) return false;
+
+    JournalRecord record;
+    uint32_t generation = 0;
+    for (size_t i = 0; i < journal.slots() && read_record(journal.base, i, record, generation); ++i) {
+        if (record.kind == JournalRecord::COMMAND) out.push_back(to_command(record));
+    }
+    return true;
+}
+
+bool replay_journal(const std::string& path, OrderBook& book, ReplayStats* stats, uint64_t after_sequence) {
+    JournalMapping journal(path);
+    if (!journal.valid()) return false;
+    const char* base = journal.base;
+
+    ReplayStats local;
+    std::vector<Command> commands;
+    std::vector<uint32_t> expected_counts;
+    std::vector<Trade> expected_trades;
+    std::vector<Trade> trades;
+    std::vector<CommandResult> results;
+    commands.reserve(REPLAY_BATCH);
+    expected_counts.reserve(REPLAY_BATCH);
+
+    auto flush = [&] {
+        book.process_batch(commands, trades, results);
+        size_t replayed = 0;
+        size_t journaled = 0;
+        for (size_t i = 0; i < commands.size(); ++i) {
+            bool match = results[i].trade_count == expected_counts[i];
+            for (uint32_t t = 0; match && t < expected_counts[i]; ++t) {
+                match = same_fill(trades[replayed + t], expected_trades[journaled + t]);
+            }
+            local.trade_mismatches += !match;
+            replayed += results[i].trade_count;
+            journaled += expected_counts[i];
+        }
+        commands.clear();
+        expected_counts.clear();
+        expected_trades.clear();
+        trades.clear();
+        results.clear();
+    };
+
+    JournalRecord record;
+    uint32_t generation = 0;
+    for (size_t i = 0; i < journal.slots() && read_record(base, i, record, generation); ++i) {
+        if (record.sequence <= after_sequence) continue;
+        local.records++;
+        if (record.kind == JournalRecord::COMMAND) {
+            // A command's trades follow it, so batches only break before a command
+            if (commands.size() == REPLAY_BATCH) flush();
+            commands.push_back(to_command(record));
+            expected_counts.push_back(0);
+            local.commands++;
+        } else if (!commands.empty()) {
+            expected_trades.push_back({record.order_id, record.sell_order_id, record.price, record.quantity,
+                                       record.timestamp_ns});
+            expected_counts.back()++;
+            local.trades++;
+        }
+    }
+    flush();
+
+    if (stats) *stats = local;
+    return true;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include "order_book.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Append-only journal of the commands a book applied and the trades they
+// produced, in application order: each command is followed by its trades.
+//
+// The file is a 64-byte header followed by fixed 64-byte records in host
+// byte order, so a record never straddles a page or a disk sector. Each
+// record carries its sequence number, a checksum and the generation (count
+// of writer opens) that wrote it. A reader stops at the first record that is
+// torn, out of sequence, or from an older generation than the one before it
+// (a leftover beyond the point where an earlier crash cut the log).
+struct JournalRecord {
+    enum Kind : uint8_t { COMMAND = 1, TRADE = 2 };
+
+    uint64_t sequence;      // 1, 2, 3... with no gaps
+    uint8_t kind;
+    uint8_t command_type;   // COMMAND: CommandType
+    uint8_t is_buy;         // COMMAND
+    uint8_t order_type;     // COMMAND: OrderType
+    uint32_t checksum;      // over the whole record with this field zero
+    uint64_t order_id;      // COMMAND: order_id; TRADE: buy_order_id
+    uint64_t sell_order_id; // TRADE; COMMAND: display_quantity, or a stop order's stop_price bits
+    double price;
+    uint64_t quantity;
+    uint64_t timestamp_ns;
+    uint32_t generation;
+    uint32_t owner_id;      // COMMAND
+};
+static_assert(sizeof(JournalRecord) == 64, "journal records are one cache line");
+
+struct JournalConfig {
+    std::string path;
+    // Preallocated and mapped at open; appends fail once it is full
+    size_t capacity_bytes = size_t{1} << 30;
+    // How long the commit thread lets appends accumulate before one msync
+    std::chrono::microseconds commit_interval{1000};
+};
+
+// Writes the journal through a shared mapping of the preallocated file.
+// Appending is a memcpy into the mapping plus one release store, with no
+// syscall on the caller's thread. A background commit thread msyncs
+// everything appended since its last pass in one call (group commit) and
+// advances durable_sequence(). It also populates the pages just ahead of
+// the tail, so appends do not take page faults.
+//
+// Opening an existing journal continues after its last intact record.
+// Construction throws std::runtime_error if the file cannot be opened,
+// sized or mapped, or is not a journal.
+//
+// Threading contract: append_* from one thread; the sequence getters from any.
+class JournalWriter {
+public:
+    explicit JournalWriter(const JournalConfig& config);
+    ~JournalWriter();
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    // Returns false, appending nothing, if the journal is full
+    bool append_command(const Command& command);
+    bool append_trades(std::span<const Trade> trades);
+
+    // Journals one process_batch: each command followed by its trades
+    bool append_batch(std::span<const Command> commands, std::span<const CommandResult> results,
+                      std::span<const Trade> trades);
+
+    // Last record appended / last record known to be on disk
+    uint64_t written_sequence() const { return next_sequence - 1; }
+    uint64_t durable_sequence() const { return durable.load(std::memory_order_acquire); }
+
+private:
+    void append(JournalRecord record);
+    void commit_loop();
+    void commit(size_t end);
+    void populate_ahead(size_t end);
+
+    JournalConfig config;
+    int fd = -1;
+    char* base = nullptr;
+    size_t capacity = 0;
+
+    // Owned by the appending thread
+    uint32_t generation = 0;
+    uint64_t next_sequence = 1;
+    size_t tail = 0;
+
+    // Published by the appending thread, consumed by the commit thread
+    alignas(64) std::atomic<size_t> written{0};
+
+    alignas(64) std::atomic<uint64_t> durable{0};
+    size_t synced = 0;
+    size_t populated = 0;
+    std::atomic<bool> stopping{false};
+    std::thread committer;
+};
+
+struct ReplayStats {
+    uint64_t records = 0;
+    uint64_t commands = 0;
+    uint64_t trades = 0;
+    // Replayed commands whose trades differ from the journaled ones
+    uint64_t trade_mismatches = 0;
+};
+
+// Rebuilds book by re-applying every command in the journal at path through
+// process_batch, reading the file with one sequential read-only mapping.
+// The journaled trades are only compared against the replayed ones.
+// Records up to after_sequence are skipped: pass the sequence stored with a
+// save_state image to replay only the tail on top of it.
+// Returns false if the file cannot be read or is not a journal.
+bool replay_journal(const std::string& path, OrderBook& book, ReplayStats* stats = nullptr,
+                    uint64_t after_sequence = 0);
+
+// Appends every journaled command to out without applying it, e.g. to feed
+// recorded flow to a benchmark. Returns false like replay_journal.
+bool read_journal_commands(const std::string& path, std::vector<Command>& out);
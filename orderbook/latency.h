@@ -0,0 +1,220 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Cheap time sources for the matching path, and an optional per-phase cycle
+// profile of it.
+//
+// Building with -DORDERBOOK_LATENCY_STATS makes every OB_TIME_PHASE(phase)
+// scope record its cycle count into the calling thread's histograms; without
+// it the macro expands to nothing. Histograms are written only by their own
+// thread and read with relaxed loads, so dump() can run from any thread while
+// the books keep matching.
+namespace latency {
+
+inline uint64_t read_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Converts TSC readings to wall-clock nanoseconds since the epoch, the
+// timebase Trade::timestamp_ns has always used. The rate is measured once
+// against steady_clock when the clock is first used; an invariant TSC keeps
+// that rate, so one multiply-add replaces a clock call per timestamp.
+class TscClock {
+public:
+    static const TscClock& instance() {
+        static const TscClock clock;
+        return clock;
+    }
+
+    uint64_t to_ns(uint64_t tsc) const {
+#if defined(__x86_64__) || defined(__i386__)
+        return anchor_ns + static_cast<uint64_t>(static_cast<double>(tsc - anchor_tsc) * ns_per_tick);
+#else
+        return anchor_ns + (tsc - anchor_tsc);
+#endif
+    }
+
+    uint64_t now_ns() const { return to_ns(read_tsc()); }
+
+    double ticks_per_ns() const { return 1.0 / ns_per_tick; }
+
+private:
+    TscClock() {
+        using namespace std::chrono;
+#if defined(__x86_64__) || defined(__i386__)
+        const auto start = steady_clock::now();
+        const uint64_t tsc_start = read_tsc();
+        std::this_thread::sleep_for(milliseconds(20));
+        const uint64_t tsc_end = read_tsc();
+        const duration<double, std::nano> elapsed = steady_clock::now() - start;
+        ns_per_tick = elapsed.count() / static_cast<double>(tsc_end - tsc_start);
+#endif
+        anchor_tsc = read_tsc();
+        anchor_ns = duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
+    uint64_t anchor_tsc = 0;
+    uint64_t anchor_ns = 0;
+    double ns_per_tick = 1.0;
+};
+
+// Log-linear histogram of cycle counts: exact below 16, then 16 buckets per
+// power of two, so every value is within 1/16 of its bucket's lower bound.
+// One thread records; any thread may read.
+class CycleHistogram {
+public:
+    void record(uint64_t cycles) {
+        bump(counts[bucket_of(cycles)]);
+        bump(total);
+        if (cycles > max.load(std::memory_order_relaxed)) max.store(cycles, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t maximum() const { return max.load(std::memory_order_relaxed); }
+
+    // Lower bound of the bucket holding the p-th fraction of samples
+    uint64_t percentile(double p) const {
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * count())));
+        uint64_t seen = 0;
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            seen += counts[b].load(std::memory_order_relaxed);
+            if (seen >= rank) return lower_bound_of(b);
+        }
+        return maximum();
+    }
+
+private:
+    static constexpr int SUB_BITS = 4;
+    static constexpr size_t SUB = size_t{1} << SUB_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+    // Single writer, so a plain load and store rather than a locked add
+    static void bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static size_t bucket_of(uint64_t v) {
+        if (v < SUB) return static_cast<size_t>(v);
+        const int msb = 63 - __builtin_clzll(v);
+        return static_cast<size_t>(msb - SUB_BITS + 1) * SUB + ((v >> (msb - SUB_BITS)) & (SUB - 1));
+    }
+
+    static uint64_t lower_bound_of(size_t b) {
+        if (b < SUB) return b;
+        const int msb = static_cast<int>(b / SUB) + SUB_BITS - 1;
+        return (SUB + b % SUB) << (msb - SUB_BITS);
+    }
+
+    std::atomic<uint64_t> counts[BUCKETS] = {};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> max{0};
+};
+
+enum Phase {
+    LOOKUP,        // id index and price validation
+    MATCH,         // crossing the opposite side, fills included
+    LEVEL_UPDATE,  // resting, unlinking and resizing orders on their level
+    PUBLISH,       // end of event: depth snapshot and market-data deltas
+    PHASE_COUNT
+};
+
+inline const char* phase_name(Phase phase) {
+    static const char* const NAMES[PHASE_COUNT] = {"lookup", "match", "level update", "publish"};
+    return NAMES[phase];
+}
+
+struct ThreadHistograms {
+    std::thread::id thread;
+    CycleHistogram phases[PHASE_COUNT];
+};
+
+// Every thread's histograms, kept after the thread exits so a final dump
+// still sees them
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadHistograms>> threads;
+};
+
+inline Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+inline ThreadHistograms& thread_histograms() {
+    thread_local ThreadHistograms* mine = [] {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.threads.push_back(std::make_unique<ThreadHistograms>());
+        r.threads.back()->thread = std::this_thread::get_id();
+        return r.threads.back().get();
+    }();
+    return *mine;
+}
+
+// Records the cycles from construction to destruction under phase
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase phase) : phase(phase), start(read_tsc()) {}
+    ~PhaseTimer() { thread_histograms().phases[phase].record(read_tsc() - start); }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    Phase phase;
+    uint64_t start;
+};
+
+// Writes one percentile row per thread and phase, in nanoseconds
+inline void dump(std::ostream& out) {
+    const double ticks_per_ns = TscClock::instance().ticks_per_ns();
+    auto ns = [&](uint64_t cycles) { return static_cast<uint64_t>(static_cast<double>(cycles) / ticks_per_ns); };
+
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    out << std::left << std::setw(14) << "phase (ns)" << std::right << std::setw(12) << "count"
+        << std::setw(9) << "p50" << std::setw(9) << "p90" << std::setw(9) << "p99"
+        << std::setw(9) << "p99.9" << std::setw(10) << "max" << "\n";
+    for (const auto& thread : r.threads) {
+        out << "thread " << thread->thread << "\n";
+        for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+            const CycleHistogram& h = thread->phases[phase];
+            out << std::left << std::setw(14) << phase_name(static_cast<Phase>(phase)) << std::right
+                << std::setw(12) << h.count();
+            for (double p : {0.50, 0.90, 0.99, 0.999}) {
+                out << std::setw(9) << (h.count() ? ns(h.percentile(p)) : 0);
+            }
+            out << std::setw(10) << ns(h.maximum()) << "\n";
+        }
+    }
+}
+
+}
+
+#define OB_PHASE_CONCAT_(a, b) a##b
+#define OB_PHASE_NAME_(line) OB_PHASE_CONCAT_(ob_phase_timer_, line)
+
+#ifdef ORDERBOOK_LATENCY_STATS
+#define OB_TIME_PHASE(phase) latency::PhaseTimer OB_PHASE_NAME_(__LINE__)(latency::phase)
+#else
+#define OB_TIME_PHASE(phase) ((void)0)
+#endif
@@ -1,7 +1,21 @@
 #include "order_book.h"
+#include "backtest.h"
+#include "book_manager.h"
+#include "book_viewer.h"
+#include "gateway.h"
+#include "journal.h"
+#include "order_entry_server.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 #include <iomanip>
 
@@ -43,6 +57,9 @@ public:
                 case 't':
                     test_matching_scenario();
                     break;
+                case 's':
+                    print_stats();
+                    break;
                 default:
                     std::cout << "Invalid choice. Please try again.\n";
             }
@@ -103,6 +120,7 @@ private:
         std::cout << "M - Amend order\n";
         std::cout << "V - View order book\n";
         std::cout << "T - Test matching scenario\n";
+        std::cout << "S - Show book statistics\n";
         std::cout << "Choice: ";
     }
 
@@ -314,6 +332,21 @@ private:
 }
 
 
+    void print_stats() {
+        const BookStats stats = book.stats();
+        std::cout << "\n=== BOOK STATISTICS ===\n";
+        std::cout << "Orders:  " << stats.resting_orders << " resting, " << stats.stop_orders << " stops\n";
+        std::cout << "Levels:  " << stats.bid_levels << " bid, " << stats.ask_levels << " ask\n";
+        std::cout << "Pool:    " << stats.pool_live << " of " << stats.pool_capacity << " slots (peak "
+                  << stats.pool_high_water << ")\n";
+        std::cout << "Index:   " << stats.index_capacity << " slots, load " << std::setprecision(3)
+                  << stats.index_load << ", mean probe " << stats.index_mean_probe << ", max probe "
+                  << stats.index_max_probe << "\n";
+        std::cout << "Memory:  " << stats.bytes_allocated << " bytes (peak " << stats.bytes_high_water << ")\n";
+        std::cout << "Events:  " << stats.adds << " adds, " << stats.cancels << " cancels, " << stats.fills
+                  << " fills\n";
+    }
+
     void print_trades(const std::vector<Trade>& trades) {
         if (trades.empty()) return;
 
@@ -328,7 +361,135 @@ private:
     }
 };
 
-int main() {
+namespace {
+    std::atomic<bool> stop_requested{false};
+
+    void request_stop(int) { stop_requested.store(true); }
+
+    // Binary order entry over TCP (see order_entry.h); runs until SIGINT/SIGTERM.
+    // With a journal path, the book is first rebuilt from that journal and
+    // every batch served is appended to it. With watch, a BookViewer redraws
+    // the book on stdout from its own thread while the server runs.
+    int serve(uint16_t port, const char* journal_path, bool watch) {
+        BookConfig book_config;
+        book_config.published_depth = watch ? DepthSnapshot::MAX_DEPTH : 0;
+        OrderBook book(book_config);
+        OrderEntryServerConfig config;
+        config.port = port;
+        OrderEntryServer server(book, config);
+
+        std::unique_ptr<JournalWriter> journal;
+        if (journal_path) {
+            ReplayStats stats;
+            auto start = std::chrono::steady_clock::now();
+            if (replay_journal(journal_path, book, &stats)) {
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                std::cout << "Replayed " << stats.commands << " commands and " << stats.trades << " trades in "
+                          << elapsed.count() << " s (" << stats.trade_mismatches << " mismatches)\n";
+            }
+            JournalConfig journal_config;
+            journal_config.path = journal_path;
+            journal = std::make_unique<JournalWriter>(journal_config);
+            server.set_journal(journal.get());
+        }
+
+        if (!server.listen()) {
+            std::cerr << "listen on port " << port << " failed: " << std::strerror(errno) << "\n";
+            return 1;
+        }
+
+        std::signal(SIGINT, request_stop);
+        std::signal(SIGTERM, request_stop);
+        std::cout << "Order entry server listening on port " << server.port() << std::endl;
+        std::unique_ptr<BookViewer> viewer;
+        if (watch) {
+            viewer = std::make_unique<BookViewer>(book);
+            viewer->start();
+        }
+        server.run(stop_requested);
+        if (viewer) viewer->stop();
+        std::cout << "Served " << server.message_count() << " messages, "
+                  << server.protocol_error_count() << " protocol errors\n";
+        return 0;
+    }
+
+    // Many-session order entry over TCP in front of a BookManager holding
+    // symbols 0 .. symbols-1, with an unpinned shard for every hardware
+    // thread but the gateway's own; runs until SIGINT/SIGTERM. Order ids
+    // carry their symbol, see order_entry::symbol_of.
+    int gateway(uint16_t port, uint32_t symbols) {
+        BookManagerConfig manager_config;
+        manager_config.shard_cores.assign(std::max(2u, std::thread::hardware_concurrency()) - 1, -1);
+        BookManager books(manager_config);
+        for (uint32_t symbol = 0; symbol < symbols; ++symbol) books.add_symbol(symbol);
+
+        GatewayConfig config;
+        config.port = port;
+        Gateway gateway(books, config);
+        if (!gateway.listen()) {
+            std::cerr << "listen on port " << port << " failed: " << std::strerror(errno) << "\n";
+            return 1;
+        }
+
+        std::signal(SIGINT, request_stop);
+        std::signal(SIGTERM, request_stop);
+        books.start();
+        std::cout << "Gateway listening on port " << gateway.port() << " for " << symbols << " symbols on "
+                  << books.shard_count() << " shards" << std::endl;
+        gateway.run(stop_requested);
+        books.stop();
+        std::cout << "Served " << gateway.message_count() << " messages, " << gateway.protocol_error_count()
+                  << " protocol errors, " << gateway.slow_session_count() << " slow sessions dropped, "
+                  << gateway.refused_count() << " connections refused\n";
+        return 0;
+    }
+
+    // Replays every <symbol_id>_<day>.journal in directory and prints one
+    // line per symbol-day and a total.
+    int backtest(const char* directory, size_t workers) {
+        BacktestConfig config;
+        config.workers = workers;
+        const std::vector<BacktestTask> tasks = find_backtest_tasks(directory);
+        const BacktestReport report = BacktestRunner(config).run(tasks);
+
+        std::cout << std::fixed << std::setprecision(2);
+        for (const BacktestResult& result : report.results) {
+            std::cout << result.symbol_id << " " << result.day << ": ";
+            if (!result.loaded) {
+                std::cout << "unreadable journal\n";
+                continue;
+            }
+            std::cout << result.commands << " commands, " << result.trades << " trades, volume " << result.volume
+                      << ", open " << result.open << " high " << result.high << " low " << result.low
+                      << " close " << result.close << "\n";
+        }
+        std::cout << "Total: " << tasks.size() << " symbol-days, " << report.total.commands << " commands, "
+                  << report.total.trades << " trades, volume " << report.total.volume << " in "
+                  << report.elapsed_seconds << " s (" << report.steals << " steals)\n";
+        return report.total.loaded ? 0 : 1;
+    }
+}
+
+// Usage: orderbook                           interactive debug client
+//        orderbook --serve [port] [journal]  binary order-entry server (default port 9000),
+//                                            recovering from and appending to journal
+//        orderbook --watch [port] [journal]  the same, with the book redrawn live on stdout
+//        orderbook --gateway [port] [symbols]
+//                                            many-session order entry for symbols 0..n-1 (default 1)
+//        orderbook --backtest dir [workers]  replays every <symbol_id>_<day>.journal in dir
+int main(int argc, char** argv) {
+    if (argc > 1 && (std::strcmp(argv[1], "--serve") == 0 || std::strcmp(argv[1], "--watch") == 0)) {
+        return serve(argc > 2 ? static_cast<uint16_t>(std::atoi(argv[2])) : 9000, argc > 3 ? argv[3] : nullptr,
+                     std::strcmp(argv[1], "--watch") == 0);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--gateway") == 0) {
+        return gateway(argc > 2 ? static_cast<uint16_t>(std::atoi(argv[2])) : 9000,
+                       argc > 3 ? static_cast<uint32_t>(std::max(1, std::atoi(argv[3]))) : 1);
+    }
+    if (argc > 2 && std::strcmp(argv[1], "--backtest") == 0) {
+        return backtest(argv[2], argc > 3 ? static_cast<size_t>(std::atoi(argv[3])) : 0);
+    }
+
     InteractiveOrderBook interactive_book;
     interactive_book.run();
     return 0;
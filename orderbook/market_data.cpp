@@ -0,0 +1,75 @@
+#include "market_data.h"
+#include <cmath>
+#include <stdexcept>
+
+MarketDataPublisher::MarketDataPublisher(const MarketDataConfig& config)
+    : messages(config.channel_capacity), config(config) {}
+
+void MarketDataPublisher::level_changed(bool is_bid, double price, uint64_t total_quantity, uint64_t order_count) {
+    MarketDataMessage message{next_sequence++, price, total_quantity, order_count, MarketDataType::LEVEL, is_bid};
+    if (!messages.push(message)) {
+        dropped++;
+        snapshot_pending = true;
+    }
+}
+
+bool MarketDataPublisher::end_event() {
+    events_since_snapshot++;
+    if (config.snapshot_interval != 0 && events_since_snapshot >= config.snapshot_interval) {
+        snapshot_pending = true;
+    }
+    return snapshot_pending;
+}
+
+bool MarketDataPublisher::publish_snapshot(std::span<const PriceLevel> bids, std::span<const PriceLevel> asks) {
+    const size_t needed = bids.size() + asks.size() + 2;
+    if (messages.capacity() - messages.size() < needed) {
+        snapshot_pending = true;
+        return false;
+    }
+
+    // Only this thread pushes, so the room checked above cannot shrink
+    const uint64_t as_of = next_sequence - 1;
+    messages.push({as_of, 0.0, 0, 0, MarketDataType::SNAPSHOT_BEGIN, false});
+    for (const PriceLevel& level : bids) {
+        messages.push({as_of, level.price, level.total_quantity, level.order_count, MarketDataType::SNAPSHOT_LEVEL, true});
+    }
+    for (const PriceLevel& level : asks) {
+        messages.push({as_of, level.price, level.total_quantity, level.order_count, MarketDataType::SNAPSHOT_LEVEL, false});
+    }
+    messages.push({as_of, 0.0, 0, 0, MarketDataType::SNAPSHOT_END, false});
+
+    events_since_snapshot = 0;
+    snapshot_pending = false;
+    return true;
+}
+
+ConflatingPublisher::ConflatingPublisher(const BookConfig& config, size_t reader_count) {
+    if (!(config.tick_size > 0) || !(config.max_price >= config.min_price) || reader_count == 0) {
+        throw std::invalid_argument("ConflatingPublisher: invalid price band or reader count");
+    }
+    // The book's own ladder size (see OrderBook's tick_count_of)
+    ticks = static_cast<size_t>(std::floor((config.max_price - config.min_price) * (1.0 / config.tick_size) + 1e-6) + 1);
+    words = (2 * ticks + 63) / 64;
+    slots = std::make_unique<SeqLock<ConflatedLevel>[]>(2 * ticks);
+    for (size_t i = 0; i < reader_count; ++i) {
+        readers.push_back(std::make_unique<std::atomic<uint64_t>[]>(words));
+    }
+}
+
+void ConflatingPublisher::level_changed(bool is_bid, uint32_t tick, double price, uint64_t total_quantity,
+                                        uint64_t order_count) {
+    const size_t slot = slot_of(is_bid, tick);
+    slots[slot].store({events.load(std::memory_order_relaxed) + 1, price, total_quantity, order_count, is_bid});
+    const uint64_t bit = uint64_t{1} << (slot & 63);
+    // Always the RMW, even if the bit looks set: a reader may be clearing
+    // it right now, and only the release on the word orders the slot's new
+    // contents before its next read of it
+    for (auto& dirty : readers) dirty[slot >> 6].fetch_or(bit, std::memory_order_release);
+}
+
+uint64_t ConflatingPublisher::published_quantity(bool is_bid, uint32_t tick) const {
+    ConflatedLevel level;
+    slots[slot_of(is_bid, tick)].load(level);
+    return level.total_quantity;
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include "order_book.h"
+#include "seqlock.h"
+#include "../SPSC_QUEUES/spsc_q3.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+enum class MarketDataType : uint8_t {
+    LEVEL,           // one level's new totals after an event
+    SNAPSHOT_BEGIN,  // a full book follows; drop all levels held so far
+    SNAPSHOT_LEVEL,  // one level of that book
+    SNAPSHOT_END     // the book is complete as of this sequence
+};
+
+// One message on the market-data channel. Every LEVEL message takes the next
+// sequence number; snapshot messages carry the sequence of the last LEVEL
+// message they include, so a consumer applies deltas with larger numbers on
+// top. A skipped number means messages were dropped: wait for the next
+// snapshot.
+struct MarketDataMessage {
+    uint64_t sequence;
+    double price;
+    uint64_t total_quantity;  // 0 in a LEVEL message: the level is gone
+    uint64_t order_count;
+    MarketDataType type;
+    bool is_bid;
+};
+
+struct MarketDataConfig {
+    size_t channel_capacity = 1 << 16;
+    // Book events between full snapshots (0 = only after drops)
+    uint64_t snapshot_interval = 10000;
+};
+
+// Level deltas of one OrderBook, pushed into a Fifo3 for one consumer
+// thread. The book calls the publishing side from its own thread after
+// every event, once per level that event changed, so a consumer does work
+// proportional to the changes rather than to the depth.
+//
+// The book never waits on the channel: a message that finds it full is
+// dropped and counted, and a snapshot is sent as soon as one fits.
+class MarketDataPublisher {
+public:
+    explicit MarketDataPublisher(const MarketDataConfig& config = MarketDataConfig{});
+
+    MarketDataPublisher(const MarketDataPublisher&) = delete;
+    MarketDataPublisher& operator=(const MarketDataPublisher&) = delete;
+
+    // Consumer side
+    Fifo3<MarketDataMessage>& channel() { return messages; }
+
+    uint64_t sequence() const { return next_sequence - 1; }
+    uint64_t dropped_count() const { return dropped; }
+
+    // Whether count messages fit in the channel right now; a snapshot that
+    // would not is not worth building
+    bool has_room(size_t count) const { return messages.capacity() - messages.size() >= count; }
+
+    // Publishing side, called by the book
+    void level_changed(bool is_bid, double price, uint64_t total_quantity, uint64_t order_count);
+
+    // Counts one event; returns whether the book should send a snapshot now
+    bool end_event();
+
+    // Sends the whole book, best levels first. Returns false, and stays due,
+    // if the channel cannot take all of it right now.
+    bool publish_snapshot(std::span<const PriceLevel> bids, std::span<const PriceLevel> asks);
+
+private:
+    Fifo3<MarketDataMessage> messages;
+    MarketDataConfig config;
+
+    uint64_t next_sequence = 1;
+    uint64_t events_since_snapshot = 0;
+    uint64_t dropped = 0;
+    bool snapshot_pending = true;
+};
+
+// The latest state of one price level, as a ConflatingPublisher holds it
+struct ConflatedLevel {
+    uint64_t sequence;        // event that last changed the level
+    double price;
+    uint64_t total_quantity;  // 0: the level is gone
+    uint64_t order_count;
+    bool is_bid;
+};
+
+// Level state of one OrderBook for consumers that may fall behind, kept in
+// a table instead of a queue.
+//
+// The table has one slot per tick and side, each a SeqLock holding the
+// level's latest state, and each reader has a dirty bit per slot. The book
+// overwrites the slot and sets the bit in every reader's bitmap; it never
+// waits and nothing is ever dropped. A reader's poll() clears its dirty
+// bits and reads those slots, so it sees every level that changed since
+// its last poll once, in its state as of now. However far behind a reader
+// falls, and however bursty the book's traffic, memory stays at the table
+// and a poll costs at most one read per level.
+//
+// A reader sees levels, not events: two changes to one level between polls
+// arrive as the second, and levels changed by one event may arrive in
+// different polls. Consumers that need every delta in order use a
+// MarketDataPublisher.
+//
+// The book attaches with set_conflating_publisher and publishes from its own
+// thread; each reader index is polled from one consumer thread. A
+// publisher serves one book, whose price grid it is built for.
+class ConflatingPublisher {
+public:
+    // Sized for the ladder of a book built with config, for readers
+    // consumers
+    explicit ConflatingPublisher(const BookConfig& config, size_t readers = 1);
+
+    ConflatingPublisher(const ConflatingPublisher&) = delete;
+    ConflatingPublisher& operator=(const ConflatingPublisher&) = delete;
+
+    size_t tick_count() const { return ticks; }
+    size_t reader_count() const { return readers.size(); }
+
+    // Events the book has published so far
+    uint64_t sequence() const { return events.load(std::memory_order_acquire); }
+
+    // Consumer side: calls on_level(const ConflatedLevel&) for every level
+    // that changed since reader's last poll, bids then asks, each by
+    // ascending tick. Returns the number of levels delivered.
+    template<typename OnLevel>
+    size_t poll(size_t reader, OnLevel&& on_level) {
+        std::atomic<uint64_t>* dirty = readers[reader].get();
+        size_t delivered = 0;
+        for (size_t w = 0; w < words; ++w) {
+            if (dirty[w].load(std::memory_order_relaxed) == 0) continue;
+            uint64_t bits = dirty[w].exchange(0, std::memory_order_acquire);
+            while (bits != 0) {
+                ConflatedLevel level;
+                slots[(w << 6) + __builtin_ctzll(bits)].load(level);
+                on_level(level);
+                bits &= bits - 1;
+                ++delivered;
+            }
+        }
+        return delivered;
+    }
+
+    // Publishing side, called by the book
+    void level_changed(bool is_bid, uint32_t tick, double price, uint64_t total_quantity, uint64_t order_count);
+    void end_event() { events.fetch_add(1, std::memory_order_release); }
+
+    // Last quantity published for a level; the book's own thread only
+    uint64_t published_quantity(bool is_bid, uint32_t tick) const;
+
+private:
+    size_t slot_of(bool is_bid, uint32_t tick) const { return is_bid ? tick : ticks + tick; }
+
+    size_t ticks;
+    size_t words;
+    std::unique_ptr<SeqLock<ConflatedLevel>[]> slots;
+    std::vector<std::unique_ptr<std::atomic<uint64_t>[]>> readers;
+    std::atomic<uint64_t> events{0};
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// One market-data update. The in-memory layout is the compiler's; the wire
+// layout is WIRE_SIZE packed bytes, as sent by L1/mocks/dummy_market_server.py
+// with struct.pack('QQdI', ...): sequence at 0, timestamp at 8, price at 16,
+// volume at 24. Sequence numbers count up by one per message, the same
+// on every line of the feed.
+struct MarketTick {
+    static constexpr size_t WIRE_SIZE = 28;
+
+    uint64_t sequence;
+    uint64_t timestamp_ns;
+    double price;
+    uint32_t volume;
+    // When the packet carrying it arrived (FeedPacket::receive_ns); not on
+    // the wire
+    uint64_t receive_ns;
+
+    // Decodes one message in place from the receive buffer; no alignment needed
+    static MarketTick decode(const char* wire, uint64_t receive_ns = 0) {
+        MarketTick tick;
+        std::memcpy(&tick.sequence, wire, sizeof(tick.sequence));
+        std::memcpy(&tick.timestamp_ns, wire + 8, sizeof(tick.timestamp_ns));
+        std::memcpy(&tick.price, wire + 16, sizeof(tick.price));
+        std::memcpy(&tick.volume, wire + 24, sizeof(tick.volume));
+        tick.receive_ns = receive_ns;
+        return tick;
+    }
+};
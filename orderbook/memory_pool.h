@@ -0,0 +1,346 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../SPSC_QUEUES/huge_page_allocator.h"
+
+
+/// Bump-pointer arena in the spirit of the MemoryPool in L5/memory_allocator.cpp,
+/// but grown in fixed-size blocks rather than one static buffer.
+/// Individual allocations are never freed; everything goes at destruction.
+/// Blocks come from `upstream`, the global heap by default.
+class MemoryPool
+{
+public:
+    explicit MemoryPool(size_t block_size = size_t{1} << 20,
+                        std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : blocks_{upstream}
+        , block_size_{block_size}
+    {}
+
+    ~MemoryPool() {
+        for (Block const& block : blocks_) {
+            blocks_.get_allocator().resource()->deallocate(block.memory, block.size, alignof(std::max_align_t));
+        }
+    }
+
+    MemoryPool(MemoryPool const&) = delete;
+    MemoryPool& operator=(MemoryPool const&) = delete;
+
+    /// Returns `bytes_needed` bytes aligned to `alignment` (a power of two).
+    void* get_memory(size_t bytes_needed, size_t alignment = alignof(std::max_align_t)) {
+        size_t start = aligned_offset(alignment);
+        if (current_ == nullptr || start + bytes_needed > current_size_) {
+            add_block(bytes_needed + alignment);
+            start = aligned_offset(alignment);
+        }
+        offset_ = start + bytes_needed;
+        return current_ + start;
+    }
+
+    /// Total bytes obtained from the system so far
+    size_t bytes_reserved() const noexcept { return bytes_reserved_; }
+
+private:
+    size_t aligned_offset(size_t alignment) const noexcept {
+        auto base = reinterpret_cast<uintptr_t>(current_);
+        return ((base + offset_ + alignment - 1) & ~(alignment - 1)) - base;
+    }
+
+    struct Block {
+        unsigned char* memory;
+        size_t size;
+    };
+
+    void add_block(size_t min_size) {
+        size_t size = min_size > block_size_ ? min_size : block_size_;
+        auto* memory = static_cast<unsigned char*>(
+            blocks_.get_allocator().resource()->allocate(size, alignof(std::max_align_t)));
+        blocks_.push_back({memory, size});
+        current_ = memory;
+        current_size_ = size;
+        offset_ = 0;
+        bytes_reserved_ += size;
+    }
+
+    std::pmr::vector<Block> blocks_;
+    size_t block_size_;
+    unsigned char* current_ = nullptr;
+    size_t current_size_ = 0;
+    size_t offset_ = 0;
+    size_t bytes_reserved_ = 0;
+};
+
+
+/// Fixed-size object pool. Slots are carved from a MemoryPool in batches and
+/// recycled through an intrusive free list, so create/destroy never reach the
+/// global allocator once the pool has grown to its working size.
+template<typename T>
+class ObjectPool
+{
+public:
+    explicit ObjectPool(size_t slots_per_batch = 4096)
+        : arena_{slots_per_batch * sizeof(Slot)}
+        , slots_per_batch_{slots_per_batch}
+    {}
+
+    ObjectPool(ObjectPool const&) = delete;
+    ObjectPool& operator=(ObjectPool const&) = delete;
+
+    /// Preallocates slots so that `count` objects can be live without growing.
+    void reserve(size_t count) {
+        while (capacity_ < count) {
+            grow(count - capacity_);
+        }
+    }
+
+    template<typename... Args>
+    T* create(Args&&... args) {
+        if (free_ == nullptr) {
+            grow(slots_per_batch_);
+        }
+        Slot* slot = free_;
+        free_ = slot->next;
+        ++live_;
+        return new (slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* object) noexcept {
+        object->~T();
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->next = free_;
+        free_ = slot;
+        --live_;
+    }
+
+    /// Number of live objects
+    size_t size() const noexcept { return live_; }
+
+    /// Number of slots carved so far, live or free
+    size_t capacity() const noexcept { return capacity_; }
+
+private:
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    void grow(size_t count) {
+        Slot* slots = static_cast<Slot*>(arena_.get_memory(count * sizeof(Slot), alignof(Slot)));
+        for (size_t i = count; i-- > 0;) {
+            slots[i].next = free_;
+            free_ = &slots[i];
+        }
+        capacity_ += count;
+    }
+
+    MemoryPool arena_;
+    size_t slots_per_batch_;
+    Slot* free_ = nullptr;
+    size_t live_ = 0;
+    size_t capacity_ = 0;
+};
+
+
+/// Pool of numbered slots whose hot and cold halves live in separate arrays.
+/// Walking hot records (e.g. a price level's FIFO) never pulls the cold fields
+/// into cache. Both halves are carved from a MemoryPool in chunks of
+/// CHUNK_SIZE slots and never move, so references stay valid until release.
+/// All of the pool's memory comes from `upstream`.
+template<typename Hot, typename Cold>
+class SplitPool
+{
+    static_assert(std::is_trivially_destructible_v<Hot> && std::is_trivially_destructible_v<Cold>);
+
+public:
+    static constexpr uint32_t CHUNK_BITS = 12;
+    static constexpr uint32_t CHUNK_SIZE = uint32_t{1} << CHUNK_BITS;
+
+    explicit SplitPool(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : arena_{BLOCK_SIZE, upstream}
+        , hot_chunks_{upstream}
+        , cold_chunks_{upstream}
+        , free_{upstream}
+    {}
+
+    SplitPool(SplitPool const&) = delete;
+    SplitPool& operator=(SplitPool const&) = delete;
+
+    /// Preallocates chunks so that `count` slots can be live without growing.
+    void reserve(size_t count) {
+        size_t chunks = chunks_for(count);
+        hot_chunks_.reserve(chunks);
+        cold_chunks_.reserve(chunks);
+        free_.reserve(chunks * CHUNK_SIZE);
+        while (capacity() < count) {
+            add_chunk();
+        }
+    }
+
+    /// Upper bound on the bytes a pool takes from its upstream for reserve(count),
+    /// bookkeeping included.
+    static size_t storage_bytes(size_t count) noexcept {
+        size_t chunks = chunks_for(count);
+        return chunks * (BLOCK_SIZE + 2 * sizeof(void*) + CHUNK_SIZE * sizeof(uint32_t)) + 4 * CACHE_LINE;
+    }
+
+    /// Returns a free slot with both halves value-initialised.
+    uint32_t allocate() {
+        if (free_.empty()) {
+            add_chunk();
+        }
+        uint32_t slot = free_.back();
+        free_.pop_back();
+        if (++live_ > peak_) peak_ = live_;
+        new (&hot(slot)) Hot{};
+        new (&cold(slot)) Cold{};
+        return slot;
+    }
+
+    void release(uint32_t slot) noexcept {
+        free_.push_back(slot);  // never reallocates: reserved in add_chunk
+        --live_;
+    }
+
+    Hot& hot(uint32_t slot) noexcept { return hot_chunks_[slot >> CHUNK_BITS][slot & (CHUNK_SIZE - 1)]; }
+    Hot const& hot(uint32_t slot) const noexcept { return hot_chunks_[slot >> CHUNK_BITS][slot & (CHUNK_SIZE - 1)]; }
+    Cold& cold(uint32_t slot) noexcept { return cold_chunks_[slot >> CHUNK_BITS][slot & (CHUNK_SIZE - 1)]; }
+    Cold const& cold(uint32_t slot) const noexcept { return cold_chunks_[slot >> CHUNK_BITS][slot & (CHUNK_SIZE - 1)]; }
+
+    /// Number of live slots
+    size_t size() const noexcept { return live_; }
+
+    /// Number of slots carved so far, live or free
+    size_t capacity() const noexcept { return hot_chunks_.size() * size_t{CHUNK_SIZE}; }
+
+    /// Most slots live at any one time
+    size_t high_water() const noexcept { return peak_; }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr size_t BLOCK_SIZE = CHUNK_SIZE * (sizeof(Hot) + sizeof(Cold)) + 2 * CACHE_LINE;
+
+    static size_t chunks_for(size_t count) noexcept { return (count + CHUNK_SIZE - 1) / CHUNK_SIZE; }
+
+    void add_chunk() {
+        uint32_t first = static_cast<uint32_t>(capacity());
+        hot_chunks_.push_back(static_cast<Hot*>(arena_.get_memory(CHUNK_SIZE * sizeof(Hot), CACHE_LINE)));
+        cold_chunks_.push_back(static_cast<Cold*>(arena_.get_memory(CHUNK_SIZE * sizeof(Cold), CACHE_LINE)));
+        // Geometric, so a pool on a monotonic resource does not leave a trail
+        // of outgrown free lists behind
+        if (free_.capacity() < capacity()) {
+            free_.reserve(capacity() > 2 * free_.capacity() ? capacity() : 2 * free_.capacity());
+        }
+        // Push in reverse so slots are handed out in ascending address order
+        for (uint32_t i = CHUNK_SIZE; i-- > 0;) {
+            free_.push_back(first + i);
+        }
+    }
+
+    MemoryPool arena_;
+    std::pmr::vector<Hot*> hot_chunks_;
+    std::pmr::vector<Cold*> cold_chunks_;
+    std::pmr::vector<uint32_t> free_;
+    size_t live_ = 0;
+    size_t peak_ = 0;
+};
+
+
+/// Passes every allocation through to `upstream`, counting the bytes it
+/// currently holds and the most it ever held, so an owner can report its
+/// footprint without walking its containers. Like the rest of this file it
+/// is for one thread.
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream_{upstream}
+    {}
+
+    CountingResource(CountingResource const&) = delete;
+    CountingResource& operator=(CountingResource const&) = delete;
+
+    size_t bytes() const noexcept { return bytes_; }
+    size_t high_water() const noexcept { return peak_; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* memory = upstream_->allocate(bytes, alignment);
+        bytes_ += bytes;
+        if (bytes_ > peak_) peak_ = bytes_;
+        return memory;
+    }
+
+    void do_deallocate(void* memory, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(memory, bytes, alignment);
+        bytes_ -= bytes;
+    }
+
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+
+    std::pmr::memory_resource* upstream_;
+    size_t bytes_ = 0;
+    size_t peak_ = 0;
+};
+
+
+/// One region mapped and populated up front, then carved by bumping an offset
+/// like the MemoryPool in L5/memory_allocator.cpp, for owners that know their
+/// worst case at construction. The region comes from huge_pages::map, so it
+/// can sit on huge pages, is bound to a NUMA node (by default the caller's)
+/// and is faulted in by the constructor: nothing carved later takes a page
+/// fault.
+///
+/// As a memory resource, deallocation is a no-op and running out throws
+/// std::bad_alloc: the owner sized the arena so that cannot happen. The
+/// constructor throws std::runtime_error if the region cannot be mapped.
+class FixedArena : public std::pmr::memory_resource
+{
+public:
+    FixedArena(size_t bytes, bool use_huge_pages, int node = huge_pages::LOCAL_NODE)
+        : requested_{bytes}
+        , huge_{use_huge_pages}
+    {
+        base_ = static_cast<unsigned char*>(huge_pages::map(bytes, node, use_huge_pages));
+        if (base_ == nullptr) {
+            throw std::runtime_error("FixedArena: cannot map the arena");
+        }
+        size_ = huge_pages::mapping_size(bytes, use_huge_pages);
+    }
+
+    ~FixedArena() override { huge_pages::unmap(base_, requested_, huge_); }
+
+    FixedArena(FixedArena const&) = delete;
+    FixedArena& operator=(FixedArena const&) = delete;
+
+    size_t capacity() const noexcept { return size_; }
+    size_t used() const noexcept { return offset_; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        size_t start = (offset_ + alignment - 1) & ~(alignment - 1);
+        if (start + bytes > size_) {
+            throw std::bad_alloc();
+        }
+        offset_ = start + bytes;
+        return base_ + start;
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+
+    unsigned char* base_ = nullptr;
+    size_t requested_;
+    size_t size_ = 0;
+    size_t offset_ = 0;
+    bool huge_;
+};
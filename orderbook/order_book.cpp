@@ -1,201 +1,946 @@
 #include "order_book.h"
+#include "memory_pool.h"
+#include "order_index.h"
+#include "market_data.h"
+#include "trade_feed.h"
+#include "seqlock.h"
+#include "latency.h"
+#include "bitmap_scan.h"
+#include "depth_scan.h"
 #include <iostream>
 #include <algorithm>
-#include <map>
-#include <unordered_map>
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <iomanip>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <type_traits>
 
 namespace {
-    struct OrderBookData {
-        std::unordered_map<uint64_t, Order> orders;  
-        std::map<double, uint64_t, std::greater<double>> bids; 
-        std::map<double, uint64_t> asks;  
-        std::map<double, uint64_t> bid_order_counts;  
-        std::map<double, uint64_t> ask_order_counts;  
+    constexpr int64_t NO_LEVEL = -1;
+    // The null order handle: no neighbour in a queue, or an empty queue
+    constexpr uint32_t NO_ORDER = UINT32_MAX;
+
+    // Matching-critical state of a resting order and its links in the FIFO
+    // of its price level. Orders are named by their SplitPool slot
+    // everywhere: the links, the id index and the queue ends are 32-bit
+    // slots rather than pointers, which halves the links and leaves nothing
+    // in the book that depends on where the pool was mapped. The type is
+    // always LIMIT and the price is implied by the tick, so neither is
+    // stored. A stop order waiting for its trigger uses the same node,
+    // linked into a StopSide bucket at its stop tick.
+    template<typename QtyT>
+    struct RestingOrder {
+        uint64_t order_id;
+        QtyT quantity;
+        uint32_t prev;
+        uint32_t next;
+        uint32_t tick;
+        uint32_t owner;
+        bool is_buy;
+        // Part of the order is hidden in OrderDetails::hidden_quantity
+        bool iceberg;
+        bool stop;
+    };
+    static_assert(sizeof(RestingOrder<uint64_t>) <= 40, "RestingOrder must stay compact: its level walk is the matching loop");
+    static_assert(sizeof(RestingOrder<uint32_t>) <= 32, "RestingOrder must stay compact: its level walk is the matching loop");
+
+    // Fields of a resting order that matching never reads, stored in the
+    // pool's cold array under the same slot. The iceberg fields are read
+    // only when an iceberg's displayed slice fills.
+    struct OrderDetails {
+        uint64_t timestamp_ns;
+        uint64_t display_quantity;  // slice size; 0 for a fully shown order
+        uint64_t hidden_quantity;   // not yet shown
+        // Waiting stop orders only: the limit tick it enters at, and its
+        // arrival number among stop orders
+        uint32_t stop_limit_tick;
+        uint32_t stop_sequence;
+        // Neighbours among the orders of the same account (see
+        // Account::orders); NO_ORDER at the ends and for orders without one
+        uint32_t owner_prev;
+        uint32_t owner_next;
+    };
+
+    // stop_limit_tick of a STOP order, which enters as a MARKET order
+    constexpr uint32_t MARKET_STOP = UINT32_MAX;
+
+    template<typename QtyT>
+    using OrderPool = SplitPool<RestingOrder<QtyT>, OrderDetails>;
+
+    // Intrusive time-priority queue of the resting orders at one price,
+    // linked through the pool slots of its orders.
+    template<typename QtyT>
+    struct OrderQueue {
+        uint32_t head = NO_ORDER;
+        uint32_t tail = NO_ORDER;
+
+        void push_back(OrderPool<QtyT>& pool, uint32_t slot) {
+            RestingOrder<QtyT>& node = pool.hot(slot);
+            node.prev = tail;
+            node.next = NO_ORDER;
+            if (tail != NO_ORDER) pool.hot(tail).next = slot;
+            else head = slot;
+            tail = slot;
+        }
 
+        void unlink(OrderPool<QtyT>& pool, uint32_t slot) {
+            RestingOrder<QtyT>& node = pool.hot(slot);
+            if (node.prev != NO_ORDER) pool.hot(node.prev).next = node.next;
+            else head = node.next;
+            if (node.next != NO_ORDER) pool.hot(node.next).prev = node.prev;
+            else tail = node.prev;
+            node.prev = node.next = NO_ORDER;
+        }
 
-        mutable uint64_t color_cycle = 0;
+        bool empty() const { return head == NO_ORDER; }
     };
 
-    uint64_t get_current_timestamp() {
-        auto now = std::chrono::high_resolution_clock::now();
-        auto duration = now.time_since_epoch();
-        return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
-    }
+    // Risk state of one owner id. Open quantities count every resting order
+    // of the account in full, hidden iceberg quantity included.
+    struct Account {
+        int64_t position = 0;  // net filled, buys positive
+        uint64_t open_buy = 0;
+        uint64_t open_sell = 0;
+        uint64_t max_position = 0;       // 0 = unlimited
+        double max_order_notional = 0;   // 0 = unlimited
+        // Head of the list of the account's resting and waiting stop
+        // orders, linked through OrderDetails, for mass_cancel
+        uint32_t orders = NO_ORDER;
+    };
 
-}
+    // The order FIFO at one price, its order count and the hidden quantity
+    // of its icebergs. The level's displayed total is kept apart, in
+    // LadderSide::quantity.
+    template<typename QtyT>
+    struct Level {
+        uint64_t order_count = 0;
+        QtyT hidden = 0;
+        OrderQueue<QtyT> queue;
+    };
 
-class OrderBook::OrderBookImpl {
-private:
-    OrderBookData data;
-    uint64_t next_order_id = 1000; 
-    uint64_t max_bid_quantity = 0;
-    uint64_t max_ask_quantity = 0;
+    // One bit per tick, set while that level has resting orders.
+    struct LevelBitmap {
+        std::pmr::vector<uint64_t> words;
 
-public:
-    std::vector<Trade> add_order(const Order& order) {
-        std::vector<Trade> trades;
+        explicit LevelBitmap(std::pmr::memory_resource* resource) : words(resource) {}
+
+        void resize(size_t ticks) { words.assign((ticks + 63) / 64, 0); }
+        void set(uint32_t tick) { words[tick >> 6] |= uint64_t{1} << (tick & 63); }
+        void clear(uint32_t tick) { words[tick >> 6] &= ~(uint64_t{1} << (tick & 63)); }
 
-        if (data.orders.find(order.order_id) != data.orders.end()) {
-            return trades; 
+        size_t count() const {
+            size_t set = 0;
+            for (uint64_t word : words) set += static_cast<size_t>(__builtin_popcountll(word));
+            return set;
         }
 
-        Order new_order = order;
+        // Lowest set tick >= from, or NO_LEVEL. The word holding from is
+        // tested inline, which settles the usual case of a level close
+        // behind; longer gaps go to the SIMD word scan.
+        int64_t find_next(int64_t from) const {
+            if (from < 0) from = 0;
+            size_t w = static_cast<size_t>(from) >> 6;
+            if (w >= words.size()) return NO_LEVEL;
+            uint64_t bits = words[w] & (~uint64_t{0} << (from & 63));
+            if (bits == 0) {
+                w = bitmap_scan::first_nonzero(words.data(), w + 1, words.size());
+                if (w == bitmap_scan::NOT_FOUND) return NO_LEVEL;
+                bits = words[w];
+            }
+            return static_cast<int64_t>((w << 6) + __builtin_ctzll(bits));
+        }
 
-        if (new_order.order_type == OrderType::MARKET) {
-            if (new_order.is_buy) {
-                while (new_order.quantity > 0 && !data.asks.empty()) {
-                    auto best_ask = data.asks.begin();
-                    match_orders(new_order, best_ask->first, trades);
-                }
-            } else {
-                while (new_order.quantity > 0 && !data.bids.empty()) {
-                    auto best_bid = data.bids.begin();
-                    match_orders(new_order, best_bid->first, trades);
-                }
+        // Highest set tick <= from, or NO_LEVEL
+        int64_t find_prev(int64_t from) const {
+            if (from < 0) return NO_LEVEL;
+            size_t w = static_cast<size_t>(from) >> 6;
+            if (w >= words.size()) {
+                w = words.size() - 1;
+                from = static_cast<int64_t>(w << 6) + 63;
             }
-        } else {
-            if (new_order.is_buy) {
-                while (new_order.quantity > 0 && !data.asks.empty()) {
-                    auto best_ask = data.asks.begin();
-                    if (best_ask->first <= new_order.price) {
-                        match_orders(new_order, best_ask->first, trades);
-                    } else {
-                        break;
-                    }
-                }
+            uint64_t bits = words[w] & (~uint64_t{0} >> (63 - (from & 63)));
+            if (bits == 0) {
+                w = bitmap_scan::last_nonzero(words.data(), 0, w);
+                if (w == bitmap_scan::NOT_FOUND) return NO_LEVEL;
+                bits = words[w];
+            }
+            return static_cast<int64_t>((w << 6) + 63 - __builtin_clzll(bits));
+        }
+    };
 
-                if (new_order.quantity > 0) {
-                    data.orders[new_order.order_id] = new_order;
-                    data.bids[new_order.price] += new_order.quantity;
-                    data.bid_order_counts[new_order.price]++;
-                    update_max_quantities();
-                }
-            } else {
-                while (new_order.quantity > 0 && !data.bids.empty()) {
-                    auto best_bid = data.bids.begin();
-                    if (best_bid->first >= new_order.price) {
-                        match_orders(new_order, best_bid->first, trades);
-                    } else {
-                        break;
-                    }
-                }
+    // One side of the price ladder, indexed by tick. Bids improve upwards,
+    // asks downwards; best is the cached index of the top level. The side is
+    // a template parameter, so every comparison below is fixed at compile
+    // time and bids and asks are distinct types.
+    //
+    // Level totals are a dense array of their own, zero on empty ticks, so
+    // the depth queries sum contiguous memory with SIMD instead of walking
+    // the Level records.
+    template<typename QtyT, bool Bid>
+    struct LadderSide {
+        static constexpr bool is_bid = Bid;
+
+        std::pmr::vector<Level<QtyT>> levels;
+        std::pmr::vector<QtyT> quantity;
+        LevelBitmap occupied;
+        int64_t best = NO_LEVEL;
+        // Resting icebergs with a hidden part; while zero, displayed
+        // quantity is all a FOK check has to count
+        size_t icebergs = 0;
+
+        explicit LadderSide(std::pmr::memory_resource* resource)
+            : levels(resource), quantity(resource), occupied(resource) {}
+
+        void init(size_t ticks) {
+            levels.assign(ticks, Level<QtyT>{});
+            quantity.assign(ticks, 0);
+            occupied.resize(ticks);
+            best = NO_LEVEL;
+            icebergs = 0;
+        }
 
-                if (new_order.quantity > 0) {
-                    data.orders[new_order.order_id] = new_order;
-                    data.asks[new_order.price] += new_order.quantity;
-                    data.ask_order_counts[new_order.price]++;
-                    update_max_quantities();
-                }
+        bool empty() const { return best == NO_LEVEL; }
+
+        // True if tick a is a better price than b on this side
+        static constexpr bool better(int64_t a, int64_t b) {
+            if constexpr (Bid) return a > b;
+            else return a < b;
+        }
+
+        // True if an order from the other side limited at limit_tick can
+        // trade with this side's best level
+        bool reaches(uint32_t limit_tick) const {
+            return !empty() && !better(limit_tick, best);
+        }
+
+        // The next populated level behind tick, moving away from the spread
+        int64_t next_level(int64_t tick) const {
+            if constexpr (Bid) return occupied.find_prev(tick - 1);
+            else return occupied.find_next(tick + 1);
+        }
+
+        void add_level(uint32_t tick) {
+            occupied.set(tick);
+            if (best == NO_LEVEL || better(tick, best)) {
+                best = tick;
+            }
+        }
+
+        void remove_level(uint32_t tick) {
+            occupied.clear(tick);
+            if (best == tick) {
+                best = next_level(tick);
+            }
+        }
+    };
+
+    // Stop orders of one direction waiting for a trade to reach them,
+    // bucketed by stop tick in arrival order. Buy stops fire on prints at or
+    // above their tick and sell stops at or below it, so next is the lowest
+    // armed tick for buys and the highest for sells: a print that falls short
+    // of it costs the matching loop one compare.
+    template<typename QtyT, bool Buy>
+    struct StopSide {
+        std::pmr::vector<OrderQueue<QtyT>> buckets;
+        LevelBitmap armed;
+        int64_t next = NO_LEVEL;
+        size_t count = 0;
+
+        explicit StopSide(std::pmr::memory_resource* resource) : buckets(resource), armed(resource) {}
+
+        void init(size_t ticks) {
+            buckets.assign(ticks, OrderQueue<QtyT>{});
+            armed.resize(ticks);
+            next = NO_LEVEL;
+            count = 0;
+        }
+
+        // True if a trade at tick fires the bucket at next
+        bool crossed_by(int64_t tick) const {
+            if constexpr (Buy) return next != NO_LEVEL && next <= tick;
+            else return next != NO_LEVEL && next >= tick;
+        }
+
+        // The armed tick after tick, in the direction a print has to move
+        int64_t after(int64_t tick) const {
+            if constexpr (Buy) return armed.find_next(tick + 1);
+            else return armed.find_prev(tick - 1);
+        }
+
+        void push(OrderPool<QtyT>& pool, uint32_t slot) {
+            const uint32_t tick = pool.hot(slot).tick;
+            if (buckets[tick].empty()) {
+                armed.set(tick);
+                if (next == NO_LEVEL || (Buy ? tick < next : tick > next)) next = tick;
             }
+            buckets[tick].push_back(pool, slot);
+            count++;
+        }
+
+        void remove(OrderPool<QtyT>& pool, uint32_t slot) {
+            const uint32_t tick = pool.hot(slot).tick;
+            buckets[tick].unlink(pool, slot);
+            count--;
+            if (buckets[tick].empty()) take(tick);
         }
 
-        return trades;
+        // Empties the bucket at tick, leaving its nodes to the caller
+        void take(uint32_t tick) {
+            buckets[tick] = OrderQueue<QtyT>{};
+            armed.clear(tick);
+            if (next == tick) next = after(tick);
+        }
+    };
+
+    template<typename QtyT>
+    struct OrderBookData {
+        BookConfig config;
+        double ticks_per_unit = 0;
+        size_t tick_count = 0;
+        // Integral prices only: the price of tick 0 and the price step
+        int64_t price_origin = 0;
+        int64_t price_step = 1;
+
+        OrderPool<QtyT> order_pool;
+        OrderIndex<uint32_t> orders;  // order id to pool slot
+        LadderSide<QtyT, true> bids;
+        LadderSide<QtyT, false> asks;
+        StopSide<QtyT, true> buy_stops;
+        StopSide<QtyT, false> sell_stops;
+
+        OrderBookData(std::pmr::memory_resource* resource, size_t index_capacity)
+            : order_pool(resource), orders(index_capacity, resource), bids(resource), asks(resource),
+              buy_stops(resource), sell_stops(resource) {}
+
+        mutable uint64_t color_cycle = 0;
+    };
+
+    // save_state image: a header, then for bids and then asks a level count
+    // followed by each level best first, every level's orders oldest first,
+    // then the waiting stop orders, bucket by bucket, each oldest first.
+    // Host byte order; the images are for warm starts on the same platform.
+    constexpr char STATE_MAGIC[8] = {'O', 'B', 'S', 'T', 'A', 'T', 'E', 0};
+    constexpr uint32_t STATE_VERSION = 4;
+
+    // StateHeader::flags: the book was accumulating an auction, and may cross
+    constexpr uint32_t STATE_AUCTION = 1;
+
+    struct StateHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t flags;
+        double tick_size;
+        double min_price;
+        double max_price;
+        uint64_t sequence;
+        uint64_t order_count;
+    };
+
+    struct StateLevel {
+        uint32_t tick;
+        uint32_t order_count;
+    };
+
+    // quantity is the displayed part; an iceberg also has its slice size
+    // and hidden part, both 0 otherwise
+    struct StateOrder {
+        uint64_t order_id;
+        uint64_t quantity;
+        uint64_t timestamp_ns;
+        uint64_t display_quantity;
+        uint64_t hidden_quantity;
+        uint32_t owner_id;
+        uint32_t reserved;
+    };
+
+    struct StateStops {
+        int64_t last_trade_tick;  // NO_LEVEL before the first trade
+        uint64_t count;
+        uint32_t next_sequence;
+        uint32_t reserved;
+    };
+
+    // limit_tick is MARKET_STOP for a STOP order
+    struct StateStop {
+        uint64_t order_id;
+        uint64_t quantity;
+        uint64_t timestamp_ns;
+        uint32_t owner_id;
+        uint32_t stop_tick;
+        uint32_t limit_tick;
+        uint32_t sequence;
+        uint8_t is_buy;
+        uint8_t reserved[7];
+    };
+
+    template<typename T>
+    void put(std::vector<char>& out, const T& value) {
+        const size_t at = out.size();
+        out.resize(at + sizeof(T));
+        std::memcpy(out.data() + at, &value, sizeof(T));
     }
 
-    bool cancel_order(uint64_t order_id) {
-        auto it = data.orders.find(order_id);
-        if (it == data.orders.end()) {
-            return false;
+    // Bounds-checked sequential reads over an image
+    struct StateReader {
+        std::span<const char> image;
+        size_t offset = 0;
+
+        template<typename T>
+        bool get(T& value) {
+            if (image.size() - offset < sizeof(T)) return false;
+            std::memcpy(&value, image.data() + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
         }
 
-        const Order& order = it->second;
+        bool skip(size_t bytes) {
+            if (image.size() - offset < bytes) return false;
+            offset += bytes;
+            return true;
+        }
 
-        if (order.order_type == OrderType::LIMIT) {
-            if (order.is_buy) {
-                auto bid_it = data.bids.find(order.price);
-                if (bid_it != data.bids.end()) {
-                    if (bid_it->second <= order.quantity) {
-                        data.bids.erase(bid_it);
-                        data.bid_order_counts.erase(order.price);
-                    } else {
-                        bid_it->second -= order.quantity;
-                        data.bid_order_counts[order.price]--;
-                    }
-                }
-            } else {
-                auto ask_it = data.asks.find(order.price);
-                if (ask_it != data.asks.end()) {
-                    if (ask_it->second <= order.quantity) {
-                        data.asks.erase(ask_it);
-                        data.ask_order_counts.erase(order.price);
-                    } else {
-                        ask_it->second -= order.quantity;
-                        data.ask_order_counts[order.price]--;
-                    }
+        bool at_end() const { return offset == image.size(); }
+    };
+
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+class BasicOrderBook<PriceT, QtyT, Policy>::OrderBookImpl {
+private:
+    using Node = RestingOrder<QtyT>;
+    using BookLevel = Level<QtyT>;
+    using Index = OrderIndex<uint32_t>;
+
+    static_assert(std::is_arithmetic_v<PriceT>, "BasicOrderBook: PriceT must be an arithmetic type");
+    static_assert(std::is_unsigned_v<QtyT>, "BasicOrderBook: QtyT must be an unsigned integer type");
+
+    // Only with BookConfig::fixed_capacity: backs every structure below;
+    // declared first so it outlives them
+    std::unique_ptr<FixedArena> arena;
+    // Every structure below allocates through it, for stats()
+    CountingResource counted;
+    std::pmr::memory_resource* memory;
+    OrderBookData<QtyT> data;
+    uint64_t next_order_id = 1000; 
+    // Lifetime counts for stats()
+    uint64_t adds = 0;
+    uint64_t cancels = 0;
+    uint64_t fills = 0;
+
+    // Indexed by owner id; empty unless BookConfig::max_owners is set
+    std::pmr::vector<Account> accounts;
+    // What the current market order may still fill before reaching its
+    // account's max_order_notional; infinite otherwise
+    double notional_left = std::numeric_limits<double>::infinity();
+
+    // Stop orders fired by the current event's trades, entered in this
+    // order once the command that fired them is done (see trigger_stops)
+    struct TriggeredStop {
+        uint32_t sequence;
+        Order order;
+    };
+    std::pmr::vector<TriggeredStop> triggered;
+    int64_t last_trade_tick = NO_LEVEL;
+    uint32_t next_stop_sequence = 0;
+
+    // Between begin_auction and uncross: orders rest without matching
+    bool auction = false;
+    // Cumulative supply and demand over the crossed range, for equilibrium
+    mutable std::pmr::vector<uint64_t> auction_supply;
+    mutable std::pmr::vector<uint64_t> auction_demand;
+
+    // Taken once per event, by its first fill, and shared by all its fills
+    const latency::TscClock& clock = latency::TscClock::instance();
+    uint64_t event_timestamp = 0;
+
+    // Written by the owning thread after each event, read by any thread
+    DepthSnapshot published{};
+    SeqLock<DepthSnapshot> published_depth;
+
+    // Levels the current event changed, flushed as deltas when it ends
+    struct TouchedLevel {
+        bool is_bid;
+        uint32_t tick;
+    };
+    MarketDataPublisher* market_data = nullptr;
+    ConflatingPublisher* conflating = nullptr;
+    TradeFeed* trade_feed = nullptr;
+    std::pmr::vector<TouchedLevel> touched;
+    // The publisher speaks double prices whatever PriceT is
+    std::pmr::vector<::PriceLevel> snapshot_bids;
+    std::pmr::vector<::PriceLevel> snapshot_asks;
+
+    // The trade buffer of FixedOrderBook's add_order and amend_order:
+    // carved from the region at max_event_trades and never grown. Events
+    // that could print more are refused up front (see event_fits).
+    struct EventTrades {
+        std::pmr::vector<Trade> trades;
+
+        void push_back(const Trade& trade) { trades.push_back(trade); }
+        size_t size() const { return trades.size(); }
+
+        // Adds trade to an earlier one between the same two orders, from
+        // index first on; false if there is none
+        bool merge(const Trade& trade, size_t first) {
+            for (size_t i = trades.size(); i-- > first;) {
+                if (trades[i].buy_order_id == trade.buy_order_id && trades[i].sell_order_id == trade.sell_order_id) {
+                    trades[i].quantity += trade.quantity;
+                    return true;
                 }
             }
-            update_max_quantities();
+            return false;
         }
+    };
+    EventTrades event_trades;
+
+    // Most trades one event of a fixed book with that many orders can print
+    // while event_fits holds: see there.
+    static size_t max_event_trades(size_t orders) { return 2 * orders + 2; }
+
+    // Whether the trades of an event fit max_event_trades. The event's
+    // aggressors are its order and the stops it fires, and a fixed book
+    // prints one trade per resting order an aggressor meets at a level, the
+    // slices of an iceberg added together (see match_orders). An aggressor
+    // leaves every level but its last emptied, so each trade retires an
+    // order, of which there are at most orders + 1, unless it is with the
+    // order the aggressor ends on or an iceberg left partly filled. That
+    // bounds an event at orders + 1 + (stops + 1) * (icebergs + 1), which
+    // with no stops waiting is within the buffer; iceberg is whether the
+    // event's order may rest as another one.
+    bool event_fits(bool iceberg) const {
+        const size_t stops = data.buy_stops.count + data.sell_stops.count;
+        const size_t icebergs = data.bids.icebergs + data.asks.icebergs + (iceberg ? 1 : 0);
+        return data.orders.size() + 1 + (stops + 1) * (icebergs + 1) <= event_trades.trades.capacity();
+    }
 
-        data.orders.erase(it);
-        return true;
+public:
+    explicit OrderBookImpl(const BookConfig& config)
+        : arena(make_arena(config)),
+          counted(arena ? arena.get() : config.memory ? config.memory : std::pmr::get_default_resource()),
+          memory(&counted),
+          data(memory, config.reserve_orders > 0 ? config.reserve_orders : 1024),
+          accounts(config.max_owners, memory),
+          triggered(memory),
+          auction_supply(memory),
+          auction_demand(memory),
+          touched(memory),
+          snapshot_bids(memory),
+          snapshot_asks(memory),
+          event_trades{std::pmr::vector<Trade>(memory)} {
+        if constexpr (std::is_integral_v<PriceT>) {
+            data.price_origin = static_cast<int64_t>(config.min_price);
+            data.price_step = static_cast<int64_t>(config.tick_size);
+        }
+        data.config = config;
+        data.ticks_per_unit = 1.0 / config.tick_size;
+        data.tick_count = tick_count_of(config);
+        data.bids.init(data.tick_count);
+        data.asks.init(data.tick_count);
+        data.buy_stops.init(data.tick_count);
+        data.sell_stops.init(data.tick_count);
+
+        if (config.reserve_orders > 0) {
+            data.order_pool.reserve(config.reserve_orders);
+        }
+        if (config.fixed_capacity) {
+            // Everything an event can append to, at its worst case
+            touched.reserve(2 * data.tick_count + 2);  // cancel_all touches every level of both sides
+            triggered.reserve(config.reserve_orders);
+            auction_supply.reserve(data.tick_count);
+            auction_demand.reserve(data.tick_count);
+            snapshot_bids.reserve(data.tick_count);
+            snapshot_asks.reserve(data.tick_count);
+            event_trades.trades.reserve(max_event_trades(config.reserve_orders));
+        }
     }
 
-    bool amend_order(uint64_t order_id, double new_price, uint64_t new_quantity) {
-        auto it = data.orders.find(order_id);
-        if (it == data.orders.end()) {
+    // Returns false if the order was rejected without touching the book.
+    // Stop orders the order's trades fire are entered before it returns.
+    // Trades is a std::vector<Trade> or, for FixedOrderBook, EventTrades.
+    template<typename Trades>
+    bool add_order(const Order& order, Trades& trades) {
+        event_timestamp = 0;
+        const bool accepted = enter_order(order, trades);
+        if (!triggered.empty()) activate_stops(trades);
+        adds += accepted;
+        return accepted;
+    }
+
+    bool cancel_order(uint64_t order_id) {
+        uint32_t* handle;
+        {
+            OB_TIME_PHASE(LOOKUP);
+            handle = data.orders.find(order_id);
+        }
+        if (handle == nullptr) {
             return false;
         }
 
-        Order& order = it->second;
+        OB_TIME_PHASE(LEVEL_UPDATE);
+        cancel_slot(*handle);
+        cancels++;
+        return true;
+    }
 
-        if (order.order_type == OrderType::LIMIT) {
-            if (order.is_buy) {
-                auto bid_it = data.bids.find(order.price);
-                if (bid_it != data.bids.end()) {
-                    if (bid_it->second <= order.quantity) {
-                        data.bids.erase(bid_it);
-                        data.bid_order_counts.erase(order.price);
-                    } else {
-                        bid_it->second -= order.quantity;
-                        data.bid_order_counts[order.price]--;
-                    }
-                }
-            } else {
-                auto ask_it = data.asks.find(order.price);
-                if (ask_it != data.asks.end()) {
-                    if (ask_it->second <= order.quantity) {
-                        data.asks.erase(ask_it);
-                        data.ask_order_counts.erase(order.price);
-                    } else {
-                        ask_it->second -= order.quantity;
-                        data.ask_order_counts[order.price]--;
-                    }
-                }
+    // Cancels every resting and waiting stop order of owner_id, walking
+    // only its own orders
+    size_t mass_cancel(uint32_t owner_id) {
+        if (owner_id == 0 || owner_id >= accounts.size()) return 0;
+        OB_TIME_PHASE(LEVEL_UPDATE);
+        size_t cancelled = 0;
+        for (uint32_t slot = accounts[owner_id].orders; slot != NO_ORDER; ++cancelled) {
+            const uint32_t next = data.order_pool.cold(slot).owner_next;
+            cancel_slot(slot);
+            slot = next;
+            // Each cancel touches its level; keep that to one entry per level
+            if (!touched.empty() && touched.size() == touched.capacity()) compact_touched();
+        }
+        cancels += cancelled;
+        return cancelled;
+    }
+
+    // Cancels every resting order of one side priced in [low, high], level
+    // by level: each level is emptied whole instead of order by order
+    size_t mass_cancel(bool bid_side, PriceT low, PriceT high) {
+        uint32_t first;
+        uint32_t last;
+        if (!tick_range(low, high, first, last)) return 0;
+        OB_TIME_PHASE(LEVEL_UPDATE);
+        const size_t cancelled = bid_side ? clear_levels(data.bids, first, last) : clear_levels(data.asks, first, last);
+        cancels += cancelled;
+        return cancelled;
+    }
+
+    // Cancels every resting and waiting stop order. The market's last trade
+    // still stands, so a stop entered afterwards triggers as it would have.
+    size_t cancel_all() {
+        const size_t cancelled = data.orders.size();
+        if (cancelled == 0) return 0;
+        OB_TIME_PHASE(LEVEL_UPDATE);
+        for_each_side([&](const auto& side) {
+            for (int64_t tick = side.best; tick != NO_LEVEL; tick = side.next_level(tick)) {
+                touch(side, static_cast<uint32_t>(tick));
             }
+        });
+        const int64_t last_trade = last_trade_tick;
+        clear_book();
+        last_trade_tick = last_trade;
+        cancels += cancelled;
+        return cancelled;
+    }
 
-            order.price = new_price;
-            order.quantity = new_quantity;
+    template<typename Trades>
+    bool amend_order(uint64_t order_id, PriceT new_price, QtyT new_quantity, Trades& trades) {
+        event_timestamp = 0;
+        const bool accepted = enter_amend(order_id, new_price, new_quantity, trades);
+        if (!triggered.empty()) activate_stops(trades);
+        return accepted;
+    }
 
-            if (order.is_buy) {
-                data.bids[new_price] += new_quantity;
-                data.bid_order_counts[new_price]++;
-            } else {
-                data.asks[new_price] += new_quantity;
-                data.ask_order_counts[new_price]++;
+    bool add_order_fixed(const Order& order) {
+        event_trades.trades.clear();
+        const bool iceberg = order.display_quantity > 0 && order.display_quantity < order.quantity;
+        if (!event_fits(iceberg)) return false;
+        return add_order(order, event_trades);
+    }
+
+    bool amend_order_fixed(uint64_t order_id, PriceT new_price, QtyT new_quantity) {
+        event_trades.trades.clear();
+        if (!event_fits(false)) return false;
+        return amend_order(order_id, new_price, new_quantity, event_trades);
+    }
+
+    std::span<const Trade> fixed_trades() const { return event_trades.trades; }
+
+    size_t process_batch(std::span<const Command> commands, std::vector<Trade>& trades,
+                         std::vector<CommandResult>& results) {
+        size_t accepted = 0;
+        results.reserve(results.size() + commands.size());
+
+        for (size_t i = 0; i < commands.size(); ++i) {
+            // Start pulling the next command's index slot while this one runs
+            if (i + 1 < commands.size()) {
+                data.orders.prefetch(commands[i + 1].order.order_id);
             }
 
-            update_max_quantities();
+            const Command& command = commands[i];
+            const size_t first_trade = trades.size();
+            bool ok = false;
+
+            switch (command.type) {
+                case CommandType::ADD:
+                    ok = add_order(command.order, trades);
+                    break;
+                case CommandType::CANCEL:
+                    ok = cancel_order(command.order.order_id);
+                    break;
+                case CommandType::AMEND:
+                    ok = amend_order(command.order.order_id, command.order.price, command.order.quantity, trades);
+                    break;
+            }
+
+            if (ok) end_event();
+            accepted += ok;
+            results.push_back({ok, static_cast<uint32_t>(trades.size() - first_trade)});
         }
 
+        return accepted;
+    }
+
+    void begin_auction() { auction = true; }
+    bool in_auction() const { return auction; }
+
+    bool auction_price(PriceT& price, uint64_t& volume) const {
+        uint32_t tick;
+        if (!equilibrium(tick, volume)) return false;
+        price = to_price(tick);
         return true;
     }
 
+    size_t uncross(std::vector<Trade>& trades) {
+        auction = false;
+        event_timestamp = 0;
+        const size_t first_trade = trades.size();
+        uint32_t tick;
+        uint64_t volume;
+        if (equilibrium(tick, volume)) {
+            OB_TIME_PHASE(MATCH);
+            execute_auction(tick, volume, trades);
+        }
+        if (!triggered.empty()) activate_stops(trades);
+        return trades.size() - first_trade;
+    }
+
     void get_snapshot(size_t depth, std::vector<PriceLevel>& bids_out, std::vector<PriceLevel>& asks_out) const {
         bids_out.clear();
         asks_out.clear();
+        copy_levels(data.bids, depth, bids_out);
+        copy_levels(data.asks, depth, asks_out);
+    }
 
-        size_t count = 0;
-        for (auto it = data.bids.begin(); it != data.bids.end() && count < depth; ++it, ++count) {
-            bids_out.push_back({it->first, it->second, data.bid_order_counts.at(it->first)});
+    // Publishes what one accepted event changed: the seqlock depth and the
+    // changed levels to the market-data publishers, if any are enabled
+    void end_event() {
+        OB_TIME_PHASE(PUBLISH);
+        if (data.config.published_depth != 0) {
+            published.sequence++;
+            published.bid_count = copy_levels(data.bids, data.config.published_depth, published.bids);
+            published.ask_count = copy_levels(data.asks, data.config.published_depth, published.asks);
+            published_depth.store(published);
+        }
+        if (market_data || conflating) {
+            flush_market_data();
+        }
+    }
+
+    void set_market_data(MarketDataPublisher* publisher) {
+        market_data = publisher;
+        touched.clear();
+        if (market_data) {
+            publish_market_data_snapshot();
+        }
+    }
+
+    void set_conflating_publisher(ConflatingPublisher* publisher) {
+        if (publisher && publisher->tick_count() != data.tick_count) {
+            throw std::invalid_argument("OrderBook: conflating publisher built for another price grid");
+        }
+        conflating = publisher;
+        touched.clear();
+        if (conflating) {
+            sync_conflating();
+        }
+    }
+
+    void set_trade_feed(TradeFeed* feed) { trade_feed = feed; }
+
+    bool read_depth_snapshot(DepthSnapshot& out) const {
+        if (data.config.published_depth == 0) return false;
+        published_depth.load(out);
+        return true;
+    }
+
+    void save_state(std::vector<char>& image, uint64_t sequence) const {
+        image.clear();
+        StateHeader header{};
+        std::memcpy(header.magic, STATE_MAGIC, sizeof(STATE_MAGIC));
+        header.version = STATE_VERSION;
+        header.flags = auction ? STATE_AUCTION : 0;
+        header.tick_size = data.config.tick_size;
+        header.min_price = data.config.min_price;
+        header.max_price = data.config.max_price;
+        header.sequence = sequence;
+        const size_t stops = data.buy_stops.count + data.sell_stops.count;
+        header.order_count = data.orders.size() - stops;
+        image.reserve(sizeof(header) + 2 * sizeof(uint64_t) + header.order_count * sizeof(StateOrder) +
+                      sizeof(StateStops) + stops * sizeof(StateStop));
+        put(image, header);
+
+        for_each_side([&](const auto& side) {
+            uint64_t level_count = 0;
+            for (int64_t tick = side.best; tick != NO_LEVEL; tick = side.next_level(tick)) ++level_count;
+            put(image, level_count);
+
+            for (int64_t tick = side.best; tick != NO_LEVEL; tick = side.next_level(tick)) {
+                const BookLevel& level = side.levels[tick];
+                put(image, StateLevel{static_cast<uint32_t>(tick), static_cast<uint32_t>(level.order_count)});
+                for (uint32_t slot = level.queue.head; slot != NO_ORDER;) {
+                    const Node& node = data.order_pool.hot(slot);
+                    const OrderDetails& details = data.order_pool.cold(slot);
+                    put(image, StateOrder{node.order_id, node.quantity, details.timestamp_ns,
+                                          details.display_quantity, details.hidden_quantity, node.owner, 0});
+                    slot = node.next;
+                }
+            }
+        });
+
+        put(image, StateStops{last_trade_tick, stops, next_stop_sequence, 0});
+        auto save_stops = [&](const auto& stops) {
+            for (int64_t tick = stops.next; tick != NO_LEVEL; tick = stops.after(tick)) {
+                for (uint32_t slot = stops.buckets[tick].head; slot != NO_ORDER;) {
+                    const Node& node = data.order_pool.hot(slot);
+                    const OrderDetails& details = data.order_pool.cold(slot);
+                    put(image, StateStop{node.order_id, node.quantity, details.timestamp_ns, node.owner,
+                                         node.tick, details.stop_limit_tick, details.stop_sequence, node.is_buy, {}});
+                    slot = node.next;
+                }
+            }
+        };
+        save_stops(data.buy_stops);
+        save_stops(data.sell_stops);
+    }
+
+    bool load_state(std::span<const char> image, uint64_t* sequence) {
+        StateHeader header;
+        uint64_t stop_count = 0;
+        if (!validate_state(image, header, stop_count)) {
+            return false;
         }
 
-        count = 0;
-        for (auto it = data.asks.begin(); it != data.asks.end() && count < depth; ++it, ++count) {
-            asks_out.push_back({it->first, it->second, data.ask_order_counts.at(it->first)});
+        // Grow first, for the stops too, so running out of memory also
+        // leaves the book as it was; the queues and stop buckets below only
+        // link pool slots
+        data.order_pool.reserve(header.order_count + stop_count);
+        data.orders.reserve(header.order_count + stop_count);
+        clear_book();
+
+        StateReader reader{image};
+        reader.skip(sizeof(StateHeader));
+        auto load_side = [&](auto& side) {
+            uint64_t level_count = 0;
+            reader.get(level_count);
+            for (uint64_t l = 0; l < level_count; ++l) {
+                StateLevel state_level;
+                reader.get(state_level);
+                BookLevel& level = side.levels[state_level.tick];
+                for (uint32_t o = 0; o < state_level.order_count; ++o) {
+                    StateOrder state_order;
+                    reader.get(state_order);
+
+                    uint32_t slot = data.order_pool.allocate();
+                    Node& node = data.order_pool.hot(slot);
+                    node.order_id = state_order.order_id;
+                    node.quantity = static_cast<QtyT>(state_order.quantity);
+                    node.tick = state_level.tick;
+                    node.is_buy = side.is_bid;
+                    node.owner = state_order.owner_id;
+                    node.iceberg = state_order.hidden_quantity > 0;
+                    node.stop = false;
+                    data.order_pool.cold(slot) = {.timestamp_ns = state_order.timestamp_ns,
+                                                  .display_quantity = state_order.display_quantity,
+                                                  .hidden_quantity = state_order.hidden_quantity,
+                                                  .stop_limit_tick = 0,
+                                                  .stop_sequence = 0,
+                                                  .owner_prev = NO_ORDER,
+                                                  .owner_next = NO_ORDER};
+                    data.orders.insert(node.order_id, slot);  // unique: checked by validate_state
+                    link_owner(slot);
+                    level.queue.push_back(data.order_pool, slot);
+                    side.quantity[state_level.tick] += node.quantity;
+                    level.order_count++;
+                    if (node.iceberg) {
+                        level.hidden += static_cast<QtyT>(state_order.hidden_quantity);
+                        side.icebergs++;
+                    }
+                    add_open(side, node, total_quantity(slot));
+                }
+                side.occupied.set(state_level.tick);
+                if (l == 0) side.best = state_level.tick;  // levels arrive best first
+            }
+        };
+        auto load_stops = [&] {
+            StateStops stops;
+            reader.get(stops);
+            last_trade_tick = stops.last_trade_tick;
+            next_stop_sequence = stops.next_sequence;
+            for (uint64_t i = 0; i < stops.count; ++i) {
+                StateStop state_stop;
+                reader.get(state_stop);
+                uint32_t slot = data.order_pool.allocate();
+                Node& node = data.order_pool.hot(slot);
+                node.order_id = state_stop.order_id;
+                node.quantity = static_cast<QtyT>(state_stop.quantity);
+                node.tick = state_stop.stop_tick;
+                node.owner = state_stop.owner_id;
+                node.is_buy = state_stop.is_buy != 0;
+                node.iceberg = false;
+                node.stop = true;
+                data.order_pool.cold(slot) = {.timestamp_ns = state_stop.timestamp_ns,
+                                              .display_quantity = 0,
+                                              .hidden_quantity = 0,
+                                              .stop_limit_tick = state_stop.limit_tick,
+                                              .stop_sequence = state_stop.sequence,
+                                              .owner_prev = NO_ORDER,
+                                              .owner_next = NO_ORDER};
+                data.orders.insert(node.order_id, slot);
+                link_owner(slot);
+                if (node.is_buy) data.buy_stops.push(data.order_pool, slot);
+                else data.sell_stops.push(data.order_pool, slot);
+            }
+        };
+        // The image is fully validated: from here on nothing can fail
+        load_side(data.bids);
+        load_side(data.asks);
+        load_stops();
+
+        auction = (header.flags & STATE_AUCTION) != 0;
+        if (sequence) *sequence = header.sequence;
+        touched.clear();
+        end_event();
+        if (market_data) {
+            publish_market_data_snapshot();
         }
+        if (conflating) {
+            sync_conflating();
+        }
+        return true;
+    }
+
+    BookStats stats() const {
+        BookStats stats;
+        stats.stop_orders = data.buy_stops.count + data.sell_stops.count;
+        stats.resting_orders = data.orders.size() - stats.stop_orders;
+        // A popcount of the ladder bitmaps, which are kept as levels come
+        // and go: tick_count / 64 words, and nothing on the matching path
+        stats.bid_levels = data.bids.occupied.count();
+        stats.ask_levels = data.asks.occupied.count();
+        stats.pool_live = data.order_pool.size();
+        stats.pool_capacity = data.order_pool.capacity();
+        stats.pool_high_water = data.order_pool.high_water();
+        stats.index_capacity = data.orders.capacity();
+        stats.index_load = static_cast<double>(data.orders.size()) / static_cast<double>(data.orders.capacity());
+        stats.index_mean_probe = data.orders.mean_probe_length();
+        stats.index_max_probe = data.orders.max_probe_length();
+        stats.bytes_allocated = counted.bytes();
+        stats.bytes_high_water = counted.high_water();
+        stats.adds = adds;
+        stats.cancels = cancels;
+        stats.fills = fills;
+        return stats;
     }
 
     void print_book(size_t depth) const {
@@ -209,6 +954,9 @@ public:
 
     data.color_cycle = (data.color_cycle + 1) % 3;
 
+    const uint64_t max_bid_quantity = max_level_quantity(data.bids);
+    const uint64_t max_ask_quantity = max_level_quantity(data.asks);
+
     // Modern colors
     const std::string CYAN = "\033[36m";
     const std::string MAGENTA = "\033[35m";
@@ -226,8 +974,8 @@ public:
               << GRAY << " | Total Orders: " << WHITE << data.orders.size() << RESET << "\n\n";
 
     // Show best bid/ask summary first (reversed order from old design)
-    double best_bid = get_best_bid();
-    double best_ask = get_best_ask();
+    double best_bid = static_cast<double>(get_best_bid());
+    double best_ask = static_cast<double>(get_best_ask());
     if (best_bid > 0 && best_ask > 0) {
         double spread = best_ask - best_bid;
         double spread_percent = (spread / best_bid) * 100.0;
@@ -289,18 +1037,41 @@ public:
 
 
 
-    double get_best_bid() const {
-        if (data.bids.empty()) return 0.0;
-        return data.bids.begin()->first;
+    PriceT get_best_bid() const {
+        if (data.bids.empty()) return PriceT{};
+        return to_price(static_cast<uint32_t>(data.bids.best));
     }
 
-    double get_best_ask() const {
-        if (data.asks.empty()) return 0.0;
-        return data.asks.begin()->first;
+    PriceT get_best_ask() const {
+        if (data.asks.empty()) return PriceT{};
+        return to_price(static_cast<uint32_t>(data.asks.best));
+    }
+
+    size_t cumulative_depth(bool bid_side, std::span<uint64_t> out) const {
+        return bid_side ? cumulative_depth(data.bids, out) : cumulative_depth(data.asks, out);
+    }
+
+    bool depth_to_quantity(bool bid_side, QtyT quantity, PriceT& price) const {
+        return bid_side ? depth_to_quantity(data.bids, quantity, price) : depth_to_quantity(data.asks, quantity, price);
+    }
+
+    double vwap(bool bid_side, QtyT quantity, QtyT* filled) const {
+        return bid_side ? vwap(data.bids, quantity, filled) : vwap(data.asks, quantity, filled);
     }
 
     bool order_exists(uint64_t order_id) const {
-        return data.orders.find(order_id) != data.orders.end();
+        return data.orders.contains(order_id);
+    }
+
+    bool set_risk_limits(uint32_t owner_id, uint64_t max_position, double max_order_notional) {
+        if (owner_id == 0 || owner_id >= accounts.size()) return false;
+        accounts[owner_id].max_position = max_position;
+        accounts[owner_id].max_order_notional = max_order_notional;
+        return true;
+    }
+
+    int64_t position(uint32_t owner_id) const {
+        return owner_id != 0 && owner_id < accounts.size() ? accounts[owner_id].position : 0;
     }
 
     void get_price_levels(std::vector<PriceLevel>& bids_out, std::vector<PriceLevel>& asks_out) const {
@@ -308,105 +1079,1363 @@ public:
     }
 
 private:
-    void update_max_quantities() {
-        max_bid_quantity = 0;
-        for (const auto& bid : data.bids) {
-            if (bid.second > max_bid_quantity) max_bid_quantity = bid.second;
+    // Validates the configuration and returns the number of ticks in its band
+    static size_t tick_count_of(const BookConfig& config) {
+        if (!(config.tick_size > 0) || !(config.max_price >= config.min_price)) {
+            throw std::invalid_argument("OrderBook: invalid tick size or price band");
+        }
+        if constexpr (std::is_integral_v<PriceT>) {
+            if (config.tick_size != std::round(config.tick_size) || config.min_price != std::round(config.min_price)) {
+                throw std::invalid_argument("OrderBook: integral prices need a whole tick size and minimum price");
+            }
+        }
+        const double ticks = std::floor((config.max_price - config.min_price) * (1.0 / config.tick_size) + 1e-6) + 1;
+        if (ticks > UINT32_MAX) {
+            throw std::invalid_argument("OrderBook: price band has too many ticks");
+        }
+        if (config.published_depth > DepthSnapshot::MAX_DEPTH) {
+            throw std::invalid_argument("OrderBook: published depth exceeds DepthSnapshot::MAX_DEPTH");
+        }
+        if (config.fixed_capacity && config.reserve_orders == 0) {
+            throw std::invalid_argument("OrderBook: a fixed-capacity book needs reserve_orders");
+        }
+        return static_cast<size_t>(ticks);
+    }
+
+    // Sizes one arena for everything a fixed-capacity book allocates: both
+    // ladders, both stop sides and their bitmaps, the order pool, the id
+    // index, the per-event and auction scratch vectors and the event trade
+    // buffer, with slack for alignment
+    static std::unique_ptr<FixedArena> make_arena(const BookConfig& config) {
+        const size_t ticks = tick_count_of(config);
+        if (!config.fixed_capacity) return nullptr;
+
+        const size_t bytes = 2 * ticks * (sizeof(BookLevel) + sizeof(QtyT) + sizeof(OrderQueue<QtyT>)) +
+                             4 * ((ticks + 63) / 64) * sizeof(uint64_t) +
+                             config.reserve_orders * sizeof(TriggeredStop) + 2 * ticks * sizeof(uint64_t) +
+                             OrderPool<QtyT>::storage_bytes(config.reserve_orders) +
+                             Index::storage_bytes(config.reserve_orders) + (2 * ticks + 2) * sizeof(TouchedLevel) +
+                             2 * ticks * sizeof(::PriceLevel) + config.max_owners * sizeof(Account) +
+                             max_event_trades(config.reserve_orders) * sizeof(Trade) + 64 * 1024;
+        return std::make_unique<FixedArena>(bytes, config.huge_pages, config.numa_node);
+    }
+
+    // Checks an image end to end before load_state touches the book: header,
+    // price grid, tick bounds, strictly worsening level order, an uncrossed
+    // book outside auctions, positive quantities that fit QtyT and the
+    // declared order count. stop_count is set to the image's stop orders.
+    bool validate_state(std::span<const char> image, StateHeader& header, uint64_t& stop_count) const {
+        StateReader reader{image};
+        if (!reader.get(header) || std::memcmp(header.magic, STATE_MAGIC, sizeof(STATE_MAGIC)) != 0 ||
+            header.version != STATE_VERSION || (header.flags & ~STATE_AUCTION) != 0 || header.tick_size != data.config.tick_size ||
+            header.min_price != data.config.min_price || header.max_price != data.config.max_price ||
+            (data.config.fixed_capacity && header.order_count > data.config.reserve_orders)) {
+            return false;
+        }
+
+        // Every id, resting and stop, so duplicates are found before the book
+        // is touched; bounded by what the image can hold, not by its header
+        std::vector<uint64_t> ids;
+        ids.reserve(std::min<uint64_t>(header.order_count, image.size() / sizeof(StateOrder)));
+        uint64_t orders = 0;
+        int64_t best[2] = {NO_LEVEL, NO_LEVEL};
+        for (int s = 0; s < 2; ++s) {
+            const bool is_bid = s == 0;
+            uint64_t level_count = 0;
+            if (!reader.get(level_count) || level_count > data.tick_count) return false;
+
+            int64_t previous = NO_LEVEL;
+            uint64_t level_quantity = 0;
+            uint64_t level_hidden = 0;
+            for (uint64_t l = 0; l < level_count; ++l) {
+                StateLevel level;
+                if (!reader.get(level) || level.tick >= data.tick_count || level.order_count == 0) return false;
+                const int64_t tick = level.tick;
+                if (previous != NO_LEVEL && (is_bid ? tick >= previous : tick <= previous)) return false;
+                if (previous == NO_LEVEL) best[s] = tick;
+                previous = tick;
+
+                level_quantity = 0;
+                level_hidden = 0;
+                for (uint32_t o = 0; o < level.order_count; ++o) {
+                    StateOrder order;
+                    if (!reader.get(order) || order.quantity == 0 || order.order_id == Index::EMPTY_KEY ||
+                        order.quantity > std::numeric_limits<QtyT>::max() - level_quantity ||
+                        order.hidden_quantity > std::numeric_limits<QtyT>::max() - level_hidden ||
+                        order.display_quantity > std::numeric_limits<QtyT>::max() ||
+                        (order.hidden_quantity > 0 && (order.display_quantity == 0 || !Policy::iceberg_orders)) ||
+                        (!accounts.empty() && order.owner_id >= accounts.size())) {
+                        return false;
+                    }
+                    level_quantity += order.quantity;
+                    level_hidden += order.hidden_quantity;
+                    ids.push_back(order.order_id);
+                }
+                orders += level.order_count;
+            }
+        }
+
+        if (!(header.flags & STATE_AUCTION) && best[0] != NO_LEVEL && best[1] != NO_LEVEL && best[0] >= best[1]) {
+            return false;
         }
 
-        max_ask_quantity = 0;
-        for (const auto& ask : data.asks) {
-            if (ask.second > max_ask_quantity) max_ask_quantity = ask.second;
+        StateStops stops;
+        if (!reader.get(stops) || stops.last_trade_tick < NO_LEVEL ||
+            stops.last_trade_tick >= static_cast<int64_t>(data.tick_count) ||
+            (data.config.fixed_capacity && stops.count > data.config.reserve_orders - header.order_count)) {
+            return false;
+        }
+        for (uint64_t i = 0; i < stops.count; ++i) {
+            StateStop stop;
+            if (!reader.get(stop) || stop.quantity == 0 || stop.quantity > std::numeric_limits<QtyT>::max() ||
+                stop.order_id == Index::EMPTY_KEY || stop.stop_tick >= data.tick_count || stop.is_buy > 1 ||
+                (stop.limit_tick == MARKET_STOP ? !Policy::market_orders : stop.limit_tick >= data.tick_count) ||
+                (!accounts.empty() && stop.owner_id >= accounts.size())) {
+                return false;
+            }
+            ids.push_back(stop.order_id);
         }
+        if (!reader.at_end() || orders != header.order_count) return false;
+        stop_count = stops.count;
+
+        std::sort(ids.begin(), ids.end());
+        return std::adjacent_find(ids.begin(), ids.end()) == ids.end();
     }
 
-    void match_orders(Order& incoming_order, double match_price, std::vector<Trade>& trades) {
-        std::vector<uint64_t> orders_to_remove;
+    // Drops every resting and waiting stop order, keeping the storage for reuse
+    void clear_book() {
+        for_each_side([&](auto& side) {
+            for (int64_t tick = side.best; tick != NO_LEVEL; tick = side.next_level(tick)) {
+                BookLevel& level = side.levels[tick];
+                for (uint32_t slot = level.queue.head; slot != NO_ORDER;) {
+                    const uint32_t next = data.order_pool.hot(slot).next;
+                    data.order_pool.release(slot);
+                    slot = next;
+                }
+                level = BookLevel{};
+                side.quantity[tick] = 0;
+            }
+            std::fill(side.occupied.words.begin(), side.occupied.words.end(), 0);
+            side.best = NO_LEVEL;
+            side.icebergs = 0;
+        });
+        auto clear_stops = [&](auto& stops) {
+            for (int64_t tick = stops.next; tick != NO_LEVEL; tick = stops.after(tick)) {
+                for (uint32_t slot = stops.buckets[tick].head; slot != NO_ORDER;) {
+                    const uint32_t next = data.order_pool.hot(slot).next;
+                    data.order_pool.release(slot);
+                    slot = next;
+                }
+                stops.buckets[tick] = OrderQueue<QtyT>{};
+            }
+            std::fill(stops.armed.words.begin(), stops.armed.words.end(), 0);
+            stops.next = NO_LEVEL;
+            stops.count = 0;
+        };
+        clear_stops(data.buy_stops);
+        clear_stops(data.sell_stops);
+        last_trade_tick = NO_LEVEL;
+        data.orders.clear();
+        for (Account& account : accounts) {
+            account.open_buy = account.open_sell = 0;
+            account.orders = NO_ORDER;
+        }
+    }
 
-        if (incoming_order.is_buy) {
-            for (auto& order_pair : data.orders) {
-                if (!order_pair.second.is_buy && 
-                    order_pair.second.order_type == OrderType::LIMIT &&
-                    order_pair.second.price == match_price && 
-                    incoming_order.quantity > 0) {
+    // The ticks of the prices in [low, high], which need not be on the grid.
+    // False if no tick of the ladder lies in the range.
+    bool tick_range(PriceT low, PriceT high, uint32_t& first, uint32_t& last) const {
+        double from, to;
+        if constexpr (std::is_integral_v<PriceT>) {
+            from = std::ceil(static_cast<double>(static_cast<int64_t>(low) - data.price_origin) / data.price_step);
+            to = std::floor(static_cast<double>(static_cast<int64_t>(high) - data.price_origin) / data.price_step);
+        } else {
+            from = std::ceil((low - data.config.min_price) * data.ticks_per_unit - 1e-6);
+            to = std::floor((high - data.config.min_price) * data.ticks_per_unit + 1e-6);
+        }
+        from = std::max(from, 0.0);
+        to = std::min(to, static_cast<double>(data.tick_count) - 1);
+        if (from > to) return false;
+        first = static_cast<uint32_t>(from);
+        last = static_cast<uint32_t>(to);
+        return true;
+    }
 
-                    uint64_t trade_quantity = std::min(incoming_order.quantity, order_pair.second.quantity);
+    // Maps a price onto the ladder; fails for prices outside the band or off the tick grid.
+    bool to_tick(PriceT price, uint32_t& tick) const {
+        if constexpr (std::is_integral_v<PriceT>) {
+            const int64_t offset = static_cast<int64_t>(price) - data.price_origin;
+            if (offset < 0 || offset % data.price_step != 0) return false;
+            const int64_t ticks = offset / data.price_step;
+            if (ticks >= static_cast<int64_t>(data.tick_count)) return false;
+            tick = static_cast<uint32_t>(ticks);
+        } else {
+            double ticks = (price - data.config.min_price) * data.ticks_per_unit;
+            double rounded = std::round(ticks);
+            if (rounded < 0 || rounded >= static_cast<double>(data.tick_count)) return false;
+            if (std::fabs(ticks - rounded) > 1e-6) return false;
+            tick = static_cast<uint32_t>(rounded);
+        }
+        return true;
+    }
 
-                    Trade trade;
-                    trade.buy_order_id = incoming_order.order_id;
-                    trade.sell_order_id = order_pair.first;
-                    trade.price = match_price;
-                    trade.quantity = trade_quantity;
-                    trade.timestamp_ns = get_current_timestamp();
-                    trades.push_back(trade);
+    PriceT to_price(uint32_t tick) const {
+        if constexpr (std::is_integral_v<PriceT>) {
+            return static_cast<PriceT>(data.price_origin + static_cast<int64_t>(tick) * data.price_step);
+        } else {
+            return static_cast<PriceT>(data.config.min_price + tick / data.ticks_per_unit);
+        }
+    }
 
-                    incoming_order.quantity -= trade_quantity;
-                    order_pair.second.quantity -= trade_quantity;
+    // The ladder side an order of the given direction rests on
+    template<bool Buy>
+    auto& side() {
+        if constexpr (Buy) return data.bids;
+        else return data.asks;
+    }
 
-                    data.asks[match_price] -= trade_quantity;
-                    if (data.asks[match_price] == 0) {
-                        data.asks.erase(match_price);
-                        data.ask_order_counts.erase(match_price);
-                    }
+    // Runs f on the bid side and then the ask side; off the matching path
+    template<typename F>
+    void for_each_side(F&& f) {
+        f(data.bids);
+        f(data.asks);
+    }
 
-                    if (order_pair.second.quantity == 0) {
-                        orders_to_remove.push_back(order_pair.first);
-                    }
+    template<typename F>
+    void for_each_side(F&& f) const {
+        f(data.bids);
+        f(data.asks);
+    }
+
+    template<typename Side>
+    void touch(const Side&, uint32_t tick) {
+        if (market_data || conflating) {
+            touched.push_back({Side::is_bid, tick});
+        }
+    }
 
-                    if (incoming_order.quantity == 0) break;
+    // One delta per distinct level. An event usually touches only a
+    // handful, where a linear duplicate check beats any set; the bulk
+    // cancels touch many, which are sorted and deduplicated instead.
+    void flush_market_data() {
+        const bool compacted = touched.size() > 16;
+        if (compacted) compact_touched();
+        for (size_t i = 0; i < touched.size(); ++i) {
+            const TouchedLevel t = touched[i];
+            bool seen = false;
+            for (size_t j = 0; j < i && !seen && !compacted; ++j) {
+                seen = touched[j].is_bid == t.is_bid && touched[j].tick == t.tick;
+            }
+            if (seen) continue;
+            const uint64_t quantity = t.is_bid ? data.bids.quantity[t.tick] : data.asks.quantity[t.tick];
+            const BookLevel& level = t.is_bid ? data.bids.levels[t.tick] : data.asks.levels[t.tick];
+            const double price = static_cast<double>(to_price(t.tick));
+            if (market_data) market_data->level_changed(t.is_bid, price, quantity, level.order_count);
+            if (conflating) conflating->level_changed(t.is_bid, t.tick, price, quantity, level.order_count);
+        }
+        touched.clear();
+
+        if (conflating) conflating->end_event();
+        if (market_data && market_data->end_event()) {
+            publish_market_data_snapshot();
+        }
+    }
+
+    void compact_touched() {
+        auto key = [](const TouchedLevel& t) { return (uint64_t{t.is_bid} << 32) | t.tick; };
+        auto less = [&](const TouchedLevel& a, const TouchedLevel& b) { return key(a) < key(b); };
+        auto same = [&](const TouchedLevel& a, const TouchedLevel& b) { return key(a) == key(b); };
+        std::sort(touched.begin(), touched.end(), less);
+        touched.erase(std::unique(touched.begin(), touched.end(), same), touched.end());
+    }
+
+    void publish_trade(const Trade& trade, uint32_t buy_owner, uint32_t sell_owner, Aggressor aggressor) {
+        trade_feed->push({trade.buy_order_id, trade.sell_order_id, static_cast<double>(trade.price), trade.quantity,
+                          trade.timestamp_ns, buy_owner, sell_owner, aggressor});
+    }
+
+    // Sends a due snapshot if the channel has room for it. The room is
+    // checked before the book is copied, so while a consumer is behind each
+    // event pays a popcount of the level bitmaps, not a copy of the book.
+    void publish_market_data_snapshot() {
+        if (!market_data->has_room(data.bids.occupied.count() + data.asks.occupied.count() + 2)) return;
+        snapshot_bids.clear();
+        snapshot_asks.clear();
+        copy_levels(data.bids, data.tick_count, snapshot_bids);
+        copy_levels(data.asks, data.tick_count, snapshot_asks);
+        market_data->publish_snapshot(snapshot_bids, snapshot_asks);
+    }
+
+    // Brings every slot of the conflating table to the book's state: each
+    // level that rests now or that the table still shows, as one event
+    void sync_conflating() {
+        for_each_side([&](const auto& side) {
+            for (uint32_t tick = 0; tick < data.tick_count; ++tick) {
+                const uint64_t quantity = side.quantity[tick];
+                if (quantity == 0 && conflating->published_quantity(side.is_bid, tick) == 0) continue;
+                conflating->level_changed(side.is_bid, tick, static_cast<double>(to_price(tick)), quantity,
+                                          side.levels[tick].order_count);
+            }
+        });
+        conflating->end_event();
+    }
+
+    // A validated order or, re-entering as its MARKET or LIMIT form, a
+    // fired stop order, within the current event
+    template<typename Trades>
+    bool enter_order(const Order& order, Trades& trades) {
+        notional_left = std::numeric_limits<double>::infinity();
+        const bool stop = order.order_type == OrderType::STOP || order.order_type == OrderType::STOP_LIMIT;
+        uint32_t tick = 0;
+        uint32_t stop_tick = 0;
+        {
+            OB_TIME_PHASE(LOOKUP);
+            if (order.order_id == Index::EMPTY_KEY || data.orders.contains(order.order_id)) {
+                return false;
+            }
+            if (order.order_type == OrderType::MARKET || order.order_type == OrderType::STOP) {
+                if constexpr (!Policy::market_orders) return false;
+            } else if (order.order_type > OrderType::STOP_LIMIT || !to_tick(order.price, tick)) {
+                return false;
+            }
+            if (data.config.fixed_capacity && data.orders.size() >= data.config.reserve_orders &&
+                (order.order_type == OrderType::LIMIT || order.order_type == OrderType::POST_ONLY || stop)) {
+                return false;  // might have to rest or wait with no slot left; the other types never do
+            }
+            if (order.display_quantity > 0 && order.display_quantity < order.quantity) {
+                if (!Policy::iceberg_orders || stop) return false;  // stop orders are never icebergs
+            }
+            if (stop && !to_tick(order.stop_price, stop_tick)) {
+                return false;
+            }
+            if (order.owner_id != 0 && !accounts.empty() &&
+                !within_limits(order.owner_id, order.is_buy,
+                               order.order_type == OrderType::MARKET || order.order_type == OrderType::STOP,
+                               order.price, order.quantity, 0)) {
+                return false;
+            }
+        }
+
+        if (stop) {
+            if (!stop_reached(order.is_buy, stop_tick)) {
+                OB_TIME_PHASE(LEVEL_UPDATE);
+                wait_stop(order, stop_tick, order.order_type == OrderType::STOP ? MARKET_STOP : tick);
+                return true;
+            }
+            Order entered = order;
+            entered.order_type = order.order_type == OrderType::STOP ? OrderType::MARKET : OrderType::LIMIT;
+            return order.is_buy ? add_order<true>(entered, tick, trades) : add_order<false>(entered, tick, trades);
+        }
+        return order.is_buy ? add_order<true>(order, tick, trades) : add_order<false>(order, tick, trades);
+    }
+
+    template<typename Trades>
+    bool enter_amend(uint64_t order_id, PriceT new_price, QtyT new_quantity, Trades& trades) {
+        notional_left = std::numeric_limits<double>::infinity();
+        uint32_t* handle;
+        uint32_t new_tick;
+        {
+            OB_TIME_PHASE(LOOKUP);
+            handle = data.orders.find(order_id);
+            if (handle == nullptr || !to_tick(new_price, new_tick)) {
+                return false;
+            }
+        }
+
+        if (new_quantity == 0) {
+            return cancel_order(order_id);
+        }
+
+        const uint32_t slot = *handle;
+        const Node& node = data.order_pool.hot(slot);
+        if (node.stop) {
+            return false;  // waiting stop orders can only be cancelled
+        }
+        if (node.owner != 0 && !accounts.empty() &&
+            !within_limits(node.owner, node.is_buy, false, new_price, new_quantity, total_quantity(slot))) {
+            return false;
+        }
+        return node.is_buy ? amend_order<true>(slot, new_tick, new_quantity, trades)
+                           : amend_order<false>(slot, new_tick, new_quantity, trades);
+    }
+
+    // A validated add, once its side is known. Market orders sweep the whole
+    // opposite side; limit orders match up to their tick and rest the rest.
+    // The other types take their shortest path: post-only never enters the
+    // matching loop, IOC and FOK never reach the resting structures, and a
+    // FOK that cannot fill is rejected before anything changes. During an
+    // auction orders only rest, and the types that cannot are rejected.
+    template<bool Buy, typename Trades>
+    bool add_order(Order order, uint32_t tick, Trades& trades) {
+        if (auction) [[unlikely]] {
+            if (order.order_type != OrderType::LIMIT && order.order_type != OrderType::POST_ONLY) return false;
+            OB_TIME_PHASE(LEVEL_UPDATE);
+            rest_order(side<Buy>(), order, tick);
+            return true;
+        }
+
+        if constexpr (Policy::market_orders) {
+            if (order.order_type == OrderType::MARKET) {
+                OB_TIME_PHASE(MATCH);
+                match_limit<Buy>(order, Buy ? static_cast<uint32_t>(data.tick_count - 1) : 0, trades);
+                return true;
+            }
+        }
+
+        if (order.order_type == OrderType::POST_ONLY) {
+            if (side<!Buy>().reaches(tick)) return false;
+        } else {
+            OB_TIME_PHASE(MATCH);
+            if (order.order_type == OrderType::FOK) {
+                const bool fillable =
+                    data.config.self_trade_prevention != SelfTradePrevention::NONE && order.owner_id != 0
+                        ? can_fill_apart(side<!Buy>(), order.quantity, tick, order.owner_id)
+                        : can_fill(side<!Buy>(), order.quantity, tick);
+                if (!fillable) return false;
+            }
+            match_limit<Buy>(order, tick, trades);
+            if (order.order_type != OrderType::LIMIT) return true;  // IOC and FOK never rest
+        }
+
+        if (order.quantity > 0) {
+            OB_TIME_PHASE(LEVEL_UPDATE);
+            rest_order(side<Buy>(), order, tick);
+        }
+        return true;
+    }
+
+    template<bool Buy, typename Trades>
+    bool amend_order(uint32_t slot, uint32_t new_tick, QtyT new_quantity, Trades& trades) {
+        auto& own = side<Buy>();
+        Node& node = data.order_pool.hot(slot);
+
+        // Same price, smaller size: shrink in place and keep queue position.
+        // An iceberg gives up hidden quantity before displayed quantity.
+        if constexpr (Policy::shrink_keeps_priority) {
+            if (new_tick == node.tick && new_quantity <= total_quantity(slot)) {
+                OB_TIME_PHASE(LEVEL_UPDATE);
+                uint64_t reduction = total_quantity(slot) - new_quantity;
+                add_open(own, node, -static_cast<int64_t>(reduction));
+                if (node.iceberg) reduction = reduce_hidden(own, slot, reduction);
+                own.quantity[node.tick] -= static_cast<QtyT>(reduction);
+                node.quantity -= static_cast<QtyT>(reduction);
+                touch(own, node.tick);
+                return true;
+            }
+        }
+
+        // Anything else loses its place. A price through the opposite best
+        // trades first, exactly like a new aggressive limit order would.
+        {
+            OB_TIME_PHASE(LEVEL_UPDATE);
+            remove_from_level(own, slot);
+            node.quantity = new_quantity;
+            node.tick = new_tick;
+        }
+
+        if (!auction && side<!Buy>().reaches(new_tick)) {
+            Order incoming{node.order_id, Buy, OrderType::LIMIT, to_price(new_tick), new_quantity,
+                           data.order_pool.cold(slot).timestamp_ns, 0, node.owner};
+            {
+                OB_TIME_PHASE(MATCH);
+                match_limit<Buy>(incoming, new_tick, trades);
+            }
+            node.quantity = incoming.quantity;
+
+            if (node.quantity == 0) {
+                release_order(slot);
+                return true;
+            }
+        }
+
+        OB_TIME_PHASE(LEVEL_UPDATE);
+        show(slot, node.quantity);
+        enqueue(own, slot);
+        return true;
+    }
+
+    template<typename Side>
+    void rest_order(Side& side, const Order& order, uint32_t tick) {
+        uint32_t slot = data.order_pool.allocate();
+        Node& node = data.order_pool.hot(slot);
+        node.order_id = order.order_id;
+        node.quantity = order.quantity;
+        node.tick = tick;
+        node.owner = order.owner_id;
+        node.is_buy = Side::is_bid;
+        node.stop = false;
+        data.order_pool.cold(slot) = {.timestamp_ns = order.timestamp_ns,
+                                      .display_quantity = Policy::iceberg_orders ? order.display_quantity : QtyT{0},
+                                      .hidden_quantity = 0,
+                                      .stop_limit_tick = 0,
+                                      .stop_sequence = 0,
+                                      .owner_prev = NO_ORDER,
+                                      .owner_next = NO_ORDER};
+        link_owner(slot);
+        show(slot, order.quantity);
+        data.orders.insert(order.order_id, slot);
+        enqueue(side, slot);
+    }
+
+    // Sets how much of a resting order shows: all of quantity, or for an
+    // iceberg one display slice with the rest hidden. The node must be off
+    // its level.
+    void show(uint32_t slot, uint64_t quantity) {
+        Node& node = data.order_pool.hot(slot);
+        node.quantity = static_cast<QtyT>(quantity);
+        node.iceberg = false;
+        if constexpr (Policy::iceberg_orders) {
+            OrderDetails& details = data.order_pool.cold(slot);
+            details.hidden_quantity = 0;
+            if (details.display_quantity > 0 && details.display_quantity < quantity) {
+                node.quantity = static_cast<QtyT>(details.display_quantity);
+                details.hidden_quantity = quantity - details.display_quantity;
+                node.iceberg = true;
+            }
+        }
+    }
+
+    uint64_t total_quantity(uint32_t slot) const {
+        const Node& node = data.order_pool.hot(slot);
+        return node.quantity + (node.iceberg ? data.order_pool.cold(slot).hidden_quantity : 0);
+    }
+
+    // Takes up to amount from an iceberg's hidden part and returns what is
+    // left to take from its displayed part
+    template<typename Side>
+    uint64_t reduce_hidden(Side& side, uint32_t slot, uint64_t amount) {
+        Node& node = data.order_pool.hot(slot);
+        OrderDetails& details = data.order_pool.cold(slot);
+        const uint64_t taken = std::min(amount, details.hidden_quantity);
+        details.hidden_quantity -= taken;
+        side.levels[node.tick].hidden -= static_cast<QtyT>(taken);
+        if (details.hidden_quantity == 0) {
+            node.iceberg = false;
+            side.icebergs--;
+        }
+        return amount - taken;
+    }
+
+    // A resting order whose displayed quantity has just reached zero inside
+    // the matching loop: an iceberg shows its next slice, anything else
+    // leaves the book. Emptying the level is left to the loop.
+    template<typename Side>
+    void retire(Side& side, BookLevel& level, uint32_t slot) {
+        const Node& node = data.order_pool.hot(slot);
+        if constexpr (Policy::iceberg_orders) {
+            if (node.iceberg) {
+                replenish(side, level, slot);
+                return;
+            }
+        }
+        level.queue.unlink(data.order_pool, slot);
+        level.order_count--;
+        release_order(slot);
+    }
+
+    // Resolves incoming meeting a resting order of its own owner without a
+    // trade, per BookConfig::self_trade_prevention
+    template<typename Side>
+    void prevent_self_trade(Side& side, BookLevel& level, Order& incoming, uint32_t slot) {
+        Node& resting = data.order_pool.hot(slot);
+        Account* maker = accounts.empty() ? nullptr : &accounts[resting.owner];
+        switch (data.config.self_trade_prevention) {
+            case SelfTradePrevention::CANCEL_OLDEST:
+                add_open(side, resting, -static_cast<int64_t>(total_quantity(slot)));
+                side.quantity[resting.tick] -= resting.quantity;
+                if (resting.iceberg) {
+                    level.hidden -= static_cast<QtyT>(data.order_pool.cold(slot).hidden_quantity);
+                    side.icebergs--;
+                    resting.iceberg = false;
                 }
+                resting.quantity = 0;
+                retire(side, level, slot);
+                break;
+            case SelfTradePrevention::DECREMENT: {
+                const QtyT decrement = std::min(incoming.quantity, resting.quantity);
+                incoming.quantity -= decrement;
+                resting.quantity -= decrement;
+                side.quantity[resting.tick] -= decrement;
+                if (maker) (Side::is_bid ? maker->open_buy : maker->open_sell) -= decrement;
+                if (resting.quantity == 0) retire(side, level, slot);
+                break;
             }
+            default:  // CANCEL_NEWEST
+                incoming.quantity = 0;
+                break;
+        }
+    }
+
+    // Adjusts the open quantity of node's account, if it has one
+    template<typename Side>
+    void add_open(Side&, const Node& node, int64_t change) {
+        if (node.owner == 0 || accounts.empty()) return;
+        Account& account = accounts[node.owner];
+        (Side::is_bid ? account.open_buy : account.open_sell) += static_cast<uint64_t>(change);
+    }
+
+    // Pre-trade check of an order or amend of owner_id for quantity at
+    // price, with released the quantity of the order it replaces. Market
+    // orders skip the notional bound here and arm notional_left instead.
+    bool within_limits(uint32_t owner_id, bool is_buy, bool is_market, PriceT price, uint64_t quantity,
+                       uint64_t released) {
+        if (owner_id >= accounts.size()) return false;
+        const Account& account = accounts[owner_id];
+        if (account.max_position != 0) {
+            const int64_t open = static_cast<int64_t>((is_buy ? account.open_buy : account.open_sell) - released);
+            const int64_t exposure = open + static_cast<int64_t>(quantity) + (is_buy ? account.position : -account.position);
+            if (exposure > static_cast<int64_t>(account.max_position)) return false;
+        }
+        if (account.max_order_notional != 0) {
+            if (is_market) {
+                notional_left = account.max_order_notional;
+            } else if (static_cast<double>(price) * static_cast<double>(quantity) > account.max_order_notional) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // An iceberg whose displayed slice has just filled shows its next slice
+    // at the back of the level, as a new order at that price would queue
+    template<typename Side>
+    void replenish(Side& side, BookLevel& level, uint32_t slot) {
+        Node& node = data.order_pool.hot(slot);
+        const uint64_t slice = std::min(data.order_pool.cold(slot).display_quantity,
+                                        data.order_pool.cold(slot).hidden_quantity);
+        reduce_hidden(side, slot, slice);
+        node.quantity = static_cast<QtyT>(slice);
+        side.quantity[node.tick] += node.quantity;
+        level.queue.unlink(data.order_pool, slot);
+        level.queue.push_back(data.order_pool, slot);
+    }
+
+    // Appends the node at the back of its level's FIFO
+    template<typename Side>
+    void enqueue(Side& side, uint32_t slot) {
+        const Node& node = data.order_pool.hot(slot);
+        BookLevel& level = side.levels[node.tick];
+        side.quantity[node.tick] += node.quantity;
+        if (node.iceberg) {
+            level.hidden += static_cast<QtyT>(data.order_pool.cold(slot).hidden_quantity);
+            side.icebergs++;
+        }
+        add_open(side, node, total_quantity(slot));
+        level.order_count++;
+        level.queue.push_back(data.order_pool, slot);
+        side.add_level(node.tick);
+        touch(side, node.tick);
+    }
+
+    template<typename Side>
+    void remove_from_level(Side& side, uint32_t slot) {
+        const Node& node = data.order_pool.hot(slot);
+        BookLevel& level = side.levels[node.tick];
+        add_open(side, node, -static_cast<int64_t>(total_quantity(slot)));
+        side.quantity[node.tick] -= node.quantity;
+        if (node.iceberg) {
+            level.hidden -= static_cast<QtyT>(data.order_pool.cold(slot).hidden_quantity);
+            side.icebergs--;
+        }
+        level.order_count--;
+        level.queue.unlink(data.order_pool, slot);
+        if (level.queue.empty()) {
+            side.remove_level(node.tick);
+        }
+        touch(side, node.tick);
+    }
+
+    // Takes a resting or waiting stop order out of the book
+    void cancel_slot(uint32_t slot) {
+        const Node& node = data.order_pool.hot(slot);
+        if (node.stop) {
+            if (node.is_buy) data.buy_stops.remove(data.order_pool, slot);
+            else data.sell_stops.remove(data.order_pool, slot);
+        } else if (node.is_buy) {
+            remove_from_level(data.bids, slot);
         } else {
-            for (auto& order_pair : data.orders) {
-                if (order_pair.second.is_buy && 
-                    order_pair.second.order_type == OrderType::LIMIT &&
-                    order_pair.second.price == match_price && 
-                    incoming_order.quantity > 0) {
-
-                    uint64_t trade_quantity = std::min(incoming_order.quantity, order_pair.second.quantity);
-
-                    Trade trade;
-                    trade.buy_order_id = order_pair.first;
-                    trade.sell_order_id = incoming_order.order_id;
-                    trade.price = match_price;
-                    trade.quantity = trade_quantity;
-                    trade.timestamp_ns = get_current_timestamp();
-                    trades.push_back(trade);
+            remove_from_level(data.asks, slot);
+        }
+        release_order(slot);
+    }
 
-                    incoming_order.quantity -= trade_quantity;
-                    order_pair.second.quantity -= trade_quantity;
+    // Empties every level of side from tick first to last, releasing their
+    // orders without unlinking them one by one
+    template<typename Side>
+    size_t clear_levels(Side& side, uint32_t first, uint32_t last) {
+        size_t cancelled = 0;
+        for (int64_t tick = side.occupied.find_next(first); tick != NO_LEVEL && tick <= last;
+             tick = side.occupied.find_next(tick + 1)) {
+            BookLevel& level = side.levels[tick];
+            for (uint32_t slot = level.queue.head; slot != NO_ORDER;) {
+                const Node& node = data.order_pool.hot(slot);
+                const uint32_t next = node.next;
+                add_open(side, node, -static_cast<int64_t>(total_quantity(slot)));
+                if (node.iceberg) side.icebergs--;
+                release_order(slot);
+                slot = next;
+            }
+            cancelled += level.order_count;
+            level = BookLevel{};
+            side.quantity[tick] = 0;
+            side.remove_level(static_cast<uint32_t>(tick));
+            touch(side, static_cast<uint32_t>(tick));
+        }
+        return cancelled;
+    }
 
-                    data.bids[match_price] -= trade_quantity;
-                    if (data.bids[match_price] == 0) {
-                        data.bids.erase(match_price);
-                        data.bid_order_counts.erase(match_price);
-                    }
+    // Puts a new order at the head of its account's list
+    void link_owner(uint32_t slot) {
+        const uint32_t owner = data.order_pool.hot(slot).owner;
+        OrderDetails& details = data.order_pool.cold(slot);
+        details.owner_prev = details.owner_next = NO_ORDER;
+        if (owner == 0 || accounts.empty()) return;
+        uint32_t& head = accounts[owner].orders;
+        details.owner_next = head;
+        if (head != NO_ORDER) data.order_pool.cold(head).owner_prev = slot;
+        head = slot;
+    }
 
-                    if (order_pair.second.quantity == 0) {
-                        orders_to_remove.push_back(order_pair.first);
-                    }
+    // Drops an order that has left its queue: from its account's list, the
+    // id index and the pool
+    void release_order(uint32_t slot) {
+        const Node& node = data.order_pool.hot(slot);
+        if (node.owner != 0 && !accounts.empty()) {
+            const OrderDetails& details = data.order_pool.cold(slot);
+            if (details.owner_prev != NO_ORDER) data.order_pool.cold(details.owner_prev).owner_next = details.owner_next;
+            else accounts[node.owner].orders = details.owner_next;
+            if (details.owner_next != NO_ORDER) data.order_pool.cold(details.owner_next).owner_prev = details.owner_prev;
+        }
+        data.orders.erase(node.order_id);
+        data.order_pool.release(slot);
+    }
+
+    // Appends up to depth levels, best first, converting to the element's field types
+    template<typename Side, typename Levels>
+    void copy_levels(const Side& side, size_t depth, Levels& out) const {
+        using Out = typename Levels::value_type;
+        size_t count = 0;
+        for (int64_t tick = side.best; tick != NO_LEVEL && count < depth; tick = side.next_level(tick), ++count) {
+            const BookLevel& level = side.levels[tick];
+            out.push_back({static_cast<decltype(Out::price)>(to_price(static_cast<uint32_t>(tick))),
+                           side.quantity[tick], level.order_count});
+        }
+    }
+
+    template<typename Side>
+    uint32_t copy_levels(const Side& side, size_t depth, PriceLevel* out) const {
+        uint32_t count = 0;
+        for (int64_t tick = side.best; tick != NO_LEVEL && count < depth; tick = side.next_level(tick), ++count) {
+            const BookLevel& level = side.levels[tick];
+            out[count] = {to_price(static_cast<uint32_t>(tick)), side.quantity[tick], level.order_count};
+        }
+        return count;
+    }
+
+    // Running totals from the best tick outwards, one tick per entry: the
+    // side's quantity array is copied in scan order and prefix-summed in place
+    template<typename Side>
+    size_t cumulative_depth(const Side& side, std::span<uint64_t> out) const {
+        if (side.empty()) return 0;
+        const size_t best = static_cast<size_t>(side.best);
+        const size_t behind = Side::is_bid ? best + 1 : side.quantity.size() - best;
+        const size_t count = std::min(out.size(), behind);
+        const QtyT* quantity = side.quantity.data();
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = quantity[Side::is_bid ? best - i : best + i];
+        }
+        depth_scan::inclusive_scan(out.data(), count);
+        return count;
+    }
 
-                    if (incoming_order.quantity == 0) break;
+    template<typename Side>
+    bool depth_to_quantity(const Side& side, QtyT quantity, PriceT& price) const {
+        uint64_t before;
+        const size_t tick = find_fill(side, quantity, before);
+        if (tick == depth_scan::NOT_FOUND) return false;
+        price = to_price(static_cast<uint32_t>(tick));
+        return true;
+    }
+
+    // Sums the populated levels up to the fill point; only the last one is
+    // taken in part
+    template<typename Side>
+    double vwap(const Side& side, QtyT quantity, QtyT* filled) const {
+        uint64_t taken = 0;
+        double notional = 0;
+        if (quantity > 0) {
+            uint64_t before;
+            const size_t last = find_fill(side, quantity, before);
+            for (int64_t tick = side.best; tick != NO_LEVEL; tick = side.next_level(tick)) {
+                const bool partial = static_cast<size_t>(tick) == last;
+                const uint64_t take = partial ? quantity - before : side.quantity[tick];
+                notional += static_cast<double>(to_price(static_cast<uint32_t>(tick))) * static_cast<double>(take);
+                taken += take;
+                if (partial) break;
+            }
+        }
+        if (filled) *filled = static_cast<QtyT>(taken);
+        return taken ? notional / static_cast<double>(taken) : 0.0;
+    }
+
+    // Tick at which the running total from the best tick first reaches
+    // quantity, with before set to the total ahead of it, or NOT_FOUND with
+    // before set to everything counted. Only ticks no worse than limit_tick
+    // count. The scan stops at the worst populated tick rather than the
+    // ladder's end.
+    template<typename Side>
+    size_t find_fill(const Side& side, uint64_t quantity, uint64_t& before, int64_t limit_tick) const {
+        before = 0;
+        if (side.empty() || Side::better(limit_tick, side.best)) return depth_scan::NOT_FOUND;
+        const size_t best = static_cast<size_t>(side.best);
+        const QtyT* ticks = side.quantity.data();
+        size_t found;
+        if constexpr (Side::is_bid) {
+            const size_t worst = static_cast<size_t>(std::max(side.occupied.find_next(0), limit_tick));
+            found = depth_scan::find_fill(ticks + worst, best - worst + 1, best - worst, false, quantity, before);
+            return found == depth_scan::NOT_FOUND ? found : worst + found;
+        } else {
+            const int64_t last_tick = static_cast<int64_t>(side.quantity.size()) - 1;
+            const size_t worst = static_cast<size_t>(std::min(side.occupied.find_prev(last_tick), limit_tick));
+            found = depth_scan::find_fill(ticks + best, worst - best + 1, 0, true, quantity, before);
+            return found == depth_scan::NOT_FOUND ? found : best + found;
+        }
+    }
+
+    template<typename Side>
+    size_t find_fill(const Side& side, uint64_t quantity, uint64_t& before) const {
+        return find_fill(side, quantity, before, Side::is_bid ? 0 : static_cast<int64_t>(side.quantity.size()) - 1);
+    }
+
+    // FOK pre-check, before anything changes: whether side holds quantity at
+    // ticks no worse than limit_tick. Displayed quantity comes from the
+    // dense scan; hidden iceberg quantity is added level by level only when
+    // that falls short and the side has icebergs.
+    template<typename Side>
+    bool can_fill(const Side& side, uint64_t quantity, uint32_t limit_tick) const {
+        uint64_t available;
+        if (find_fill(side, quantity, available, limit_tick) != depth_scan::NOT_FOUND) return true;
+        if constexpr (Policy::iceberg_orders) {
+            if (side.icebergs == 0) return false;
+            for (int64_t tick = side.best; tick != NO_LEVEL && !Side::better(limit_tick, tick);
+                 tick = side.next_level(tick)) {
+                available += side.levels[tick].hidden;
+                if (available >= quantity) return true;
+            }
+        }
+        return false;
+    }
+
+    // can_fill for a FOK of owner under self-trade prevention, walking the
+    // orders in the sequence matching meets them. Orders of the owner never
+    // fill it: with CANCEL_OLDEST they are skipped, as matching cancels
+    // them; with CANCEL_NEWEST or DECREMENT meeting one before the FOK is
+    // filled would cancel or shrink its rest, so it cannot fill. Hidden
+    // slices come back after the shown quantity of their level.
+    template<typename Side>
+    bool can_fill_apart(const Side& side, uint64_t quantity, uint32_t limit_tick, uint32_t owner) const {
+        const bool skip_own = data.config.self_trade_prevention == SelfTradePrevention::CANCEL_OLDEST;
+        uint64_t available = 0;
+        for (int64_t tick = side.best; tick != NO_LEVEL && !Side::better(limit_tick, tick);
+             tick = side.next_level(tick)) {
+            uint64_t hidden = 0;
+            for (uint32_t slot = side.levels[tick].queue.head; slot != NO_ORDER;
+                 slot = data.order_pool.hot(slot).next) {
+                const Node& node = data.order_pool.hot(slot);
+                if (node.owner == owner) {
+                    if (!skip_own) return false;
+                    continue;
+                }
+                available += node.quantity;
+                if (available >= quantity) return true;
+                if (node.iceberg) hidden += data.order_pool.cold(slot).hidden_quantity;
+            }
+            available += hidden;
+            if (available >= quantity) return true;
+        }
+        return false;
+    }
+
+    // Largest level on a side, used to scale the depth bars. Display-only, so it
+    // is computed here on demand rather than maintained on the order paths.
+    template<typename Side>
+    uint64_t max_level_quantity(const Side& side) const {
+        uint64_t max_quantity = 0;
+        for (int64_t tick = side.best; tick != NO_LEVEL; tick = side.next_level(tick)) {
+            max_quantity = std::max<uint64_t>(max_quantity, side.quantity[tick]);
+        }
+        return max_quantity;
+    }
+
+    // Matches an order from the Buy side against the opposite side up to its
+    // limit tick.
+    template<bool Buy, typename Trades>
+    void match_limit(Order& incoming_order, uint32_t limit_tick, Trades& trades) {
+        auto& opposite = side<!Buy>();
+        while (incoming_order.quantity > 0 && opposite.reaches(limit_tick)) {
+            match_orders<Buy>(incoming_order, static_cast<uint32_t>(opposite.best), trades);
+        }
+    }
+
+    // Fills the incoming order against the resting orders at tick,
+    // oldest first, until either side is exhausted.
+    template<bool Buy, typename Trades>
+    void match_orders(Order& incoming_order, uint32_t tick, Trades& trades) {
+        auto& book_side = side<!Buy>();
+        BookLevel& level = book_side.levels[tick];
+        OrderQueue<QtyT>& queue = level.queue;
+        PriceT match_price = to_price(tick);
+        if (event_timestamp == 0) event_timestamp = clock.now_ns();
+        const uint64_t timestamp = event_timestamp;
+        const size_t first_trade = trades.size();
+        touch(book_side, tick);
+
+        // Decided once per level: flow without owners, or with self-trade
+        // prevention off, pays one predictable branch per fill
+        const bool prevent_self_trades =
+            data.config.self_trade_prevention != SelfTradePrevention::NONE && incoming_order.owner_id != 0;
+        Account* const taker = incoming_order.owner_id != 0 && !accounts.empty() ? &accounts[incoming_order.owner_id]
+                                                                                  : nullptr;
+
+        while (incoming_order.quantity > 0 && !queue.empty()) {
+            const uint32_t slot = queue.head;
+            Node& resting = data.order_pool.hot(slot);
+            if (prevent_self_trades && resting.owner == incoming_order.owner_id) [[unlikely]] {
+                prevent_self_trade(book_side, level, incoming_order, slot);
+                continue;
+            }
+            QtyT trade_quantity = std::min(incoming_order.quantity, resting.quantity);
+            if (static_cast<double>(match_price) * static_cast<double>(trade_quantity) > notional_left) [[unlikely]] {
+                // A market order at its account's notional limit: fill what fits and drop the rest
+                trade_quantity = std::min<QtyT>(trade_quantity,
+                                                static_cast<QtyT>(notional_left / static_cast<double>(match_price)));
+                incoming_order.quantity = trade_quantity;
+                if (trade_quantity == 0) break;
+            }
+            notional_left -= static_cast<double>(match_price) * static_cast<double>(trade_quantity);
+
+            Trade trade;
+            trade.buy_order_id = Buy ? incoming_order.order_id : resting.order_id;
+            trade.sell_order_id = Buy ? resting.order_id : incoming_order.order_id;
+            trade.price = match_price;
+            trade.quantity = trade_quantity;
+            trade.timestamp_ns = timestamp;
+            if constexpr (std::is_same_v<Trades, EventTrades> && Policy::iceberg_orders) {
+                // A fixed book keeps one trade per resting order met here:
+                // each new slice of an iceberg adds to its first one
+                if (data.order_pool.cold(slot).display_quantity == 0 || !trades.merge(trade, first_trade)) {
+                    trades.push_back(trade);
                 }
+            } else {
+                trades.push_back(trade);
+            }
+            fills++;
+            if (trade_feed) {
+                publish_trade(trade, Buy ? incoming_order.owner_id : resting.owner,
+                              Buy ? resting.owner : incoming_order.owner_id, Buy ? Aggressor::BUY : Aggressor::SELL);
+            }
+
+            incoming_order.quantity -= trade_quantity;
+            resting.quantity -= trade_quantity;
+            book_side.quantity[tick] -= trade_quantity;
+            const int64_t bought = Buy ? static_cast<int64_t>(trade_quantity) : -static_cast<int64_t>(trade_quantity);
+            if (taker) taker->position += bought;
+            if (resting.owner != 0 && !accounts.empty()) {
+                Account& maker = accounts[resting.owner];
+                maker.position -= bought;
+                (Buy ? maker.open_sell : maker.open_buy) -= trade_quantity;
+            }
+
+            if (resting.quantity == 0) {
+                retire(book_side, level, slot);
             }
         }
 
-        for (uint64_t order_id : orders_to_remove) {
-            data.orders.erase(order_id);
+        if (queue.empty()) {
+            book_side.remove_level(tick);
         }
+        if (trades.size() != first_trade) {
+            last_trade_tick = tick;
+            if (data.buy_stops.crossed_by(tick) || data.sell_stops.crossed_by(tick)) trigger_stops(tick);
+        }
+    }
+
+    // True if the last trade has already reached a stop order's trigger
+    bool stop_reached(bool is_buy, uint32_t stop_tick) const {
+        if (last_trade_tick == NO_LEVEL) return false;
+        return is_buy ? stop_tick <= last_trade_tick : stop_tick >= last_trade_tick;
+    }
 
-        update_max_quantities();
+    // Parks a stop order in its direction's bucket at stop_tick
+    void wait_stop(const Order& order, uint32_t stop_tick, uint32_t limit_tick) {
+        uint32_t slot = data.order_pool.allocate();
+        Node& node = data.order_pool.hot(slot);
+        node.order_id = order.order_id;
+        node.quantity = order.quantity;
+        node.tick = stop_tick;
+        node.owner = order.owner_id;
+        node.is_buy = order.is_buy;
+        node.iceberg = false;
+        node.stop = true;
+        data.order_pool.cold(slot) = {.timestamp_ns = order.timestamp_ns,
+                                      .display_quantity = 0,
+                                      .hidden_quantity = 0,
+                                      .stop_limit_tick = limit_tick,
+                                      .stop_sequence = next_stop_sequence++,
+                                      .owner_prev = NO_ORDER,
+                                      .owner_next = NO_ORDER};
+        link_owner(slot);
+        data.orders.insert(order.order_id, slot);
+        if (order.is_buy) data.buy_stops.push(data.order_pool, slot);
+        else data.sell_stops.push(data.order_pool, slot);
+    }
+
+    // Fires every stop order a trade at tick reaches. The bitmap leads from
+    // next to each armed bucket up to (buys) or down to (sells) tick, so
+    // stops out of reach are never visited. Fired orders leave the book now
+    // and are queued in arrival order for activate_stops.
+    void trigger_stops(uint32_t tick) {
+        const size_t first = triggered.size();
+        fire(data.buy_stops, tick);
+        fire(data.sell_stops, tick);
+        std::sort(triggered.begin() + first, triggered.end(), [](const TriggeredStop& a, const TriggeredStop& b) {
+            return static_cast<int32_t>(a.sequence - b.sequence) < 0;  // survives the counter wrapping
+        });
+    }
+
+    template<typename Stops>
+    void fire(Stops& stops, uint32_t tick) {
+        while (stops.crossed_by(tick)) {
+            const uint32_t stop_tick = static_cast<uint32_t>(stops.next);
+            for (uint32_t slot = stops.buckets[stop_tick].head; slot != NO_ORDER;) {
+                const Node& node = data.order_pool.hot(slot);
+                const uint32_t next = node.next;
+                const OrderDetails& details = data.order_pool.cold(slot);
+                const bool market = details.stop_limit_tick == MARKET_STOP;
+                Order order{node.order_id, node.is_buy, market ? OrderType::MARKET : OrderType::LIMIT,
+                            market ? PriceT{} : to_price(details.stop_limit_tick), node.quantity,
+                            details.timestamp_ns, 0, node.owner, to_price(stop_tick)};
+                triggered.push_back({details.stop_sequence, order});
+                release_order(slot);
+                stops.count--;
+                slot = next;
+            }
+            stops.take(stop_tick);
+        }
+    }
+
+    // Enters the fired stop orders of the current event in turn. Their own
+    // trades may fire more, which join the back of the queue.
+    template<typename Trades>
+    void activate_stops(Trades& trades) {
+        for (size_t i = 0; i < triggered.size(); ++i) {
+            const Order order = triggered[i].order;  // entering it may grow triggered
+            enter_order(order, trades);
+        }
+        triggered.clear();
+    }
+
+    // Displayed and hidden quantity at tick: all of it trades in an auction
+    template<typename Side>
+    uint64_t auction_quantity(const Side& side, uint32_t tick) const {
+        return side.quantity[tick] + (side.icebergs ? side.levels[tick].hidden : 0);
+    }
+
+    // Finds the uncrossing tick. Only the crossed range, best ask up to best
+    // bid, can trade: supply at or below each tick in it and demand at or
+    // above are one prefix sum each, then one pass picks the tick.
+    bool equilibrium(uint32_t& tick, uint64_t& volume) const {
+        if (data.bids.empty() || data.asks.empty() || data.bids.best < data.asks.best) return false;
+        const uint32_t low = static_cast<uint32_t>(data.asks.best);
+        const uint32_t high = static_cast<uint32_t>(data.bids.best);
+        const size_t count = high - low + 1;
+        auction_supply.resize(count);
+        auction_demand.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            auction_supply[i] = auction_quantity(data.asks, low + i);
+            auction_demand[i] = auction_quantity(data.bids, high - i);  // highest tick first
+        }
+        depth_scan::inclusive_scan(auction_supply.data(), count);
+        depth_scan::inclusive_scan(auction_demand.data(), count);
+
+        // Ties on volume and surplus form [first, last]
+        volume = 0;
+        uint64_t surplus = 0;
+        size_t first = 0;
+        size_t last = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const uint64_t supply = auction_supply[i];
+            const uint64_t demand = auction_demand[count - 1 - i];
+            const uint64_t executed = std::min(supply, demand);
+            const uint64_t left = std::max(supply, demand) - executed;
+            if (executed > volume || (executed == volume && left < surplus)) {
+                volume = executed;
+                surplus = left;
+                first = last = i;
+            } else if (executed == volume && left == surplus) {
+                last = i;
+            }
+        }
+
+        size_t chosen = first + (last - first) / 2;
+        if (auction_demand[count - 1 - first] > auction_supply[first]) chosen = last;        // buyers left over
+        else if (auction_supply[last] > auction_demand[count - 1 - last]) chosen = first;    // sellers left over
+        tick = static_cast<uint32_t>(low + chosen);
+        return true;
+    }
+
+    // Fills volume at tick from the best bid and the best ask inwards,
+    // oldest first at each level; the bids at or above tick and the asks at
+    // or below it hold at least that much between them.
+    void execute_auction(uint32_t tick, uint64_t volume, std::vector<Trade>& trades) {
+        if (event_timestamp == 0) event_timestamp = clock.now_ns();
+        const PriceT price = to_price(tick);
+        int64_t bid_tick = NO_LEVEL;
+        int64_t ask_tick = NO_LEVEL;
+        while (volume > 0) {
+            if (data.bids.best != bid_tick) {
+                bid_tick = data.bids.best;
+                touch(data.bids, static_cast<uint32_t>(bid_tick));
+            }
+            if (data.asks.best != ask_tick) {
+                ask_tick = data.asks.best;
+                touch(data.asks, static_cast<uint32_t>(ask_tick));
+            }
+            BookLevel& bid_level = data.bids.levels[bid_tick];
+            BookLevel& ask_level = data.asks.levels[ask_tick];
+            const uint32_t buy_slot = bid_level.queue.head;
+            const uint32_t sell_slot = ask_level.queue.head;
+            const Node& buy = data.order_pool.hot(buy_slot);
+            const Node& sell = data.order_pool.hot(sell_slot);
+            const QtyT quantity = static_cast<QtyT>(std::min<uint64_t>(std::min(buy.quantity, sell.quantity), volume));
+
+            Trade trade;
+            trade.buy_order_id = buy.order_id;
+            trade.sell_order_id = sell.order_id;
+            trade.price = price;
+            trade.quantity = quantity;
+            trade.timestamp_ns = event_timestamp;
+            trades.push_back(trade);
+            fills++;
+            if (trade_feed) publish_trade(trade, buy.owner, sell.owner, Aggressor::AUCTION);
+            volume -= quantity;
+
+            fill_resting(data.bids, bid_level, buy_slot, quantity);
+            fill_resting(data.asks, ask_level, sell_slot, quantity);
+        }
+
+        last_trade_tick = tick;
+        if (data.buy_stops.crossed_by(tick) || data.sell_stops.crossed_by(tick)) trigger_stops(tick);
+    }
+
+    // Takes quantity from a resting order in the auction, on both sides
+    // alike: the matching loop's maker half of a fill
+    template<typename Side>
+    void fill_resting(Side& side, BookLevel& level, uint32_t slot, QtyT quantity) {
+        Node& node = data.order_pool.hot(slot);
+        const uint32_t tick = node.tick;
+        node.quantity -= quantity;
+        side.quantity[tick] -= quantity;
+        if (node.owner != 0 && !accounts.empty()) {
+            Account& account = accounts[node.owner];
+            account.position += Side::is_bid ? static_cast<int64_t>(quantity) : -static_cast<int64_t>(quantity);
+            (Side::is_bid ? account.open_buy : account.open_sell) -= quantity;
+        }
+        if (node.quantity == 0) {
+            retire(side, level, slot);
+            if (level.queue.empty()) side.remove_level(tick);
+        }
     }
 };
 
-OrderBook::OrderBook() : impl(new OrderBookImpl()) {}
-OrderBook::~OrderBook() { delete impl; }
-std::vector<Trade> OrderBook::add_order(const Order& order) { return impl->add_order(order); }
-bool OrderBook::cancel_order(uint64_t order_id) { return impl->cancel_order(order_id); }
-bool OrderBook::amend_order(uint64_t order_id, double new_price, uint64_t new_quantity) { return impl->amend_order(order_id, new_price, new_quantity); }
-void OrderBook::get_snapshot(size_t depth, std::vector<PriceLevel>& bids, std::vector<PriceLevel>& asks) const { impl->get_snapshot(depth, bids, asks); }
-void OrderBook::print_book(size_t depth) const { impl->print_book(depth); }
-double OrderBook::get_best_bid() const { return impl->get_best_bid(); }
-double OrderBook::get_best_ask() const { return impl->get_best_ask(); }
-bool OrderBook::order_exists(uint64_t order_id) const { return impl->order_exists(order_id); }
-void OrderBook::get_price_levels(std::vector<PriceLevel>& bids, std::vector<PriceLevel>& asks) const { impl->get_price_levels(bids, asks); }
\ No newline at end of file
+template<typename PriceT, typename QtyT, typename Policy>
+BasicOrderBook<PriceT, QtyT, Policy>::BasicOrderBook() : impl(new OrderBookImpl(BookConfig{})) {}
+
+template<typename PriceT, typename QtyT, typename Policy>
+BasicOrderBook<PriceT, QtyT, Policy>::BasicOrderBook(const BookConfig& config) : impl(new OrderBookImpl(config)) {}
+
+template<typename PriceT, typename QtyT, typename Policy>
+BasicOrderBook<PriceT, QtyT, Policy>::~BasicOrderBook() { delete impl; }
+
+template<typename PriceT, typename QtyT, typename Policy>
+auto BasicOrderBook<PriceT, QtyT, Policy>::add_order(const Order& order) -> std::vector<Trade> {
+    std::vector<Trade> trades;
+    add_order(order, trades);
+    return trades;
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+size_t BasicOrderBook<PriceT, QtyT, Policy>::add_order(const Order& order, std::vector<Trade>& trades) {
+    const size_t first_trade = trades.size();
+    if (impl->add_order(order, trades)) impl->end_event();
+    return trades.size() - first_trade;
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+bool BasicOrderBook<PriceT, QtyT, Policy>::cancel_order(uint64_t order_id) {
+    if (!impl->cancel_order(order_id)) return false;
+    impl->end_event();
+    return true;
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+size_t BasicOrderBook<PriceT, QtyT, Policy>::mass_cancel(uint32_t owner_id) {
+    const size_t cancelled = impl->mass_cancel(owner_id);
+    if (cancelled > 0) impl->end_event();
+    return cancelled;
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+size_t BasicOrderBook<PriceT, QtyT, Policy>::mass_cancel(bool bid_side, PriceT low, PriceT high) {
+    const size_t cancelled = impl->mass_cancel(bid_side, low, high);
+    if (cancelled > 0) impl->end_event();
+    return cancelled;
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+size_t BasicOrderBook<PriceT, QtyT, Policy>::cancel_all() {
+    const size_t cancelled = impl->cancel_all();
+    if (cancelled > 0) impl->end_event();
+    return cancelled;
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+auto BasicOrderBook<PriceT, QtyT, Policy>::add_order_fixed(const Order& order) -> std::span<const Trade> {
+    if (impl->add_order_fixed(order)) impl->end_event();
+    return impl->fixed_trades();
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+bool BasicOrderBook<PriceT, QtyT, Policy>::amend_order_fixed(uint64_t order_id, PriceT new_price, QtyT new_quantity) {
+    if (!impl->amend_order_fixed(order_id, new_price, new_quantity)) return false;
+    impl->end_event();
+    return true;
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+auto BasicOrderBook<PriceT, QtyT, Policy>::fixed_trades() const -> std::span<const Trade> {
+    return impl->fixed_trades();
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+bool BasicOrderBook<PriceT, QtyT, Policy>::amend_order(uint64_t order_id, PriceT new_price, QtyT new_quantity) {
+    std::vector<Trade> trades;
+    return amend_order(order_id, new_price, new_quantity, trades);
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+bool BasicOrderBook<PriceT, QtyT, Policy>::amend_order(uint64_t order_id, PriceT new_price, QtyT new_quantity,
+                                                       std::vector<Trade>& trades) {
+    if (!impl->amend_order(order_id, new_price, new_quantity, trades)) return false;
+    impl->end_event();
+    return true;
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+size_t BasicOrderBook<PriceT, QtyT, Policy>::process_batch(std::span<const Command> commands, std::vector<Trade>& trades,
+                                                           std::vector<CommandResult>& results) {
+    return impl->process_batch(commands, trades, results);
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+void BasicOrderBook<PriceT, QtyT, Policy>::begin_auction() { impl->begin_auction(); }
+
+template<typename PriceT, typename QtyT, typename Policy>
+bool BasicOrderBook<PriceT, QtyT, Policy>::in_auction() const { return impl->in_auction(); }
+
+template<typename PriceT, typename QtyT, typename Policy>
+bool BasicOrderBook<PriceT, QtyT, Policy>::auction_price(PriceT& price, uint64_t& volume) const {
+    return impl->auction_price(price, volume);
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+size_t BasicOrderBook<PriceT, QtyT, Policy>::uncross(std::vector<Trade>& trades) {
+    const size_t count = impl->uncross(trades);
+    impl->end_event();
+    return count;
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+void BasicOrderBook<PriceT, QtyT, Policy>::get_snapshot(size_t depth, std::vector<PriceLevel>& bids,
+                                                        std::vector<PriceLevel>& asks) const {
+    impl->get_snapshot(depth, bids, asks);
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+void BasicOrderBook<PriceT, QtyT, Policy>::print_book(size_t depth) const { impl->print_book(depth); }
+
+template<typename PriceT, typename QtyT, typename Policy>
+BookStats BasicOrderBook<PriceT, QtyT, Policy>::stats() const { return impl->stats(); }
+
+template<typename PriceT, typename QtyT, typename Policy>
+bool BasicOrderBook<PriceT, QtyT, Policy>::read_depth_snapshot(DepthSnapshot& out) const {
+    return impl->read_depth_snapshot(out);
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+void BasicOrderBook<PriceT, QtyT, Policy>::set_market_data(MarketDataPublisher* publisher) {
+    impl->set_market_data(publisher);
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+void BasicOrderBook<PriceT, QtyT, Policy>::set_conflating_publisher(ConflatingPublisher* publisher) {
+    impl->set_conflating_publisher(publisher);
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+void BasicOrderBook<PriceT, QtyT, Policy>::set_trade_feed(ShmBroadcastWriter<TradeReport>* feed) {
+    impl->set_trade_feed(feed);
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+void BasicOrderBook<PriceT, QtyT, Policy>::save_state(std::vector<char>& image, uint64_t sequence) const {
+    impl->save_state(image, sequence);
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+bool BasicOrderBook<PriceT, QtyT, Policy>::load_state(std::span<const char> image, uint64_t* sequence) {
+    return impl->load_state(image, sequence);
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+PriceT BasicOrderBook<PriceT, QtyT, Policy>::get_best_bid() const { return impl->get_best_bid(); }
+
+template<typename PriceT, typename QtyT, typename Policy>
+PriceT BasicOrderBook<PriceT, QtyT, Policy>::get_best_ask() const { return impl->get_best_ask(); }
+
+template<typename PriceT, typename QtyT, typename Policy>
+size_t BasicOrderBook<PriceT, QtyT, Policy>::cumulative_depth(bool bid_side, std::span<uint64_t> out) const {
+    return impl->cumulative_depth(bid_side, out);
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+bool BasicOrderBook<PriceT, QtyT, Policy>::depth_to_quantity(bool bid_side, QtyT quantity, PriceT& price) const {
+    return impl->depth_to_quantity(bid_side, quantity, price);
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+double BasicOrderBook<PriceT, QtyT, Policy>::vwap(bool bid_side, QtyT quantity, QtyT* filled) const {
+    return impl->vwap(bid_side, quantity, filled);
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+bool BasicOrderBook<PriceT, QtyT, Policy>::order_exists(uint64_t order_id) const { return impl->order_exists(order_id); }
+
+template<typename PriceT, typename QtyT, typename Policy>
+bool BasicOrderBook<PriceT, QtyT, Policy>::set_risk_limits(uint32_t owner_id, uint64_t max_position,
+                                                           double max_order_notional) {
+    return impl->set_risk_limits(owner_id, max_position, max_order_notional);
+}
+
+template<typename PriceT, typename QtyT, typename Policy>
+int64_t BasicOrderBook<PriceT, QtyT, Policy>::position(uint32_t owner_id) const { return impl->position(owner_id); }
+
+template<typename PriceT, typename QtyT, typename Policy>
+void BasicOrderBook<PriceT, QtyT, Policy>::get_price_levels(std::vector<PriceLevel>& bids,
+                                                            std::vector<PriceLevel>& asks) const {
+    impl->get_price_levels(bids, asks);
+}
+
+// Every BasicOrderBook in use; each one here is declared extern in order_book.h
+template class BasicOrderBook<double, uint64_t, PriceTimePolicy>;
+template class BasicOrderBook<int64_t, uint32_t, PriceTimePolicy>;
@@ -1,59 +1,451 @@
 #pragma once
 #include <cstdint>
+#include <memory_resource>
 #include <vector>
+#include <span>
 #include <string>
 
+// IOC, FOK and POST_ONLY orders are priced like LIMIT orders:
+//   IOC        matches up to its price; any remainder is dropped, never rested
+//   FOK        fills in full up to its price or is rejected, untouched, if
+//              the opposite side does not hold that much
+//   POST_ONLY  rests; rejected if it would trade on arrival
+// LIMIT and POST_ONLY orders may also be icebergs (see display_quantity).
+//
+// STOP and STOP_LIMIT orders wait off the book until a trade prints at
+// their stop_price or through it (at or above for a buy, at or below for a
+// sell), then enter as a MARKET order or as a LIMIT order at price. They
+// are entered at once if the last trade has already reached stop_price.
 enum class OrderType {
     LIMIT,
-    MARKET
+    MARKET,
+    IOC,
+    FOK,
+    POST_ONLY,
+    STOP,
+    STOP_LIMIT
 };
 
-struct Order {
+// The vocabulary types are templates over the price and quantity types of
+// the book that uses them; Order, Trade and the rest below are the
+// double/uint64_t instantiations every existing caller uses.
+template<typename PriceT, typename QtyT>
+struct BasicOrder {
     uint64_t order_id;     
     bool is_buy;           
     OrderType order_type;  
-    double price;          
-    uint64_t quantity;      
+    PriceT price;          
+    QtyT quantity;      
     uint64_t timestamp_ns; 
+    // Iceberg: only this much of a resting order shows and trades at a
+    // time; each time it fills a new slice shows at the back of the level.
+    // 0, or not below quantity, shows the whole order.
+    QtyT display_quantity = 0;
+    // Account the order trades for. 0 is no account: never subject to
+    // self-trade prevention or risk limits.
+    uint32_t owner_id = 0;
+    // STOP and STOP_LIMIT: the trigger price, on the tick grid
+    PriceT stop_price = 0;
 };
 
-struct PriceLevel {
-    double price;
-    uint64_t total_quantity;
+template<typename PriceT, typename QtyT>
+struct BasicPriceLevel {
+    PriceT price;
+    QtyT total_quantity;
     uint64_t order_count;
 };
 
-struct Trade {
+// What happens when an order would trade with a resting order of the same
+// non-zero owner_id. No trade is printed in any mode.
+enum class SelfTradePrevention : uint8_t {
+    NONE,           // they trade
+    CANCEL_NEWEST,  // the rest of the incoming order is cancelled
+    CANCEL_OLDEST,  // the resting order is cancelled and matching goes on
+    DECREMENT       // both shrink by the smaller quantity and matching goes on
+};
+
+// Price grid of the book's tick ladder. Limit prices must lie on the grid
+// inside [min_price, max_price]; other prices are rejected.
+struct BookConfig {
+    double tick_size = 0.01;
+    double min_price = 0.0;
+    double max_price = 1000.0;
+
+    // Resting orders to preallocate storage for at construction (0 = grow on demand)
+    size_t reserve_orders = 0;
+
+    // Levels per side published after every event for read_depth_snapshot
+    // (0 = off, at most DepthSnapshot::MAX_DEPTH)
+    size_t published_depth = 0;
+
+    // Makes reserve_orders a hard limit: the ladders, order pool, id index
+    // and per-event scratch are all carved at construction from one
+    // populated region, nothing is allocated afterwards, and limit orders
+    // are rejected while reserve_orders orders rest
+    bool fixed_capacity = false;
+    // Backs that region with huge pages (explicit ones if reserved, else
+    // transparent ones)
+    bool huge_pages = false;
+    // NUMA node that region is bound to; -1 is the constructing thread's
+    int numa_node = -1;
+
+    // Where a growable book's ladders, order pool and index come from, e.g.
+    // a HugePageResource (SPSC_QUEUES/huge_page_allocator.h) on the matching
+    // thread's node. Not owned; must outlive the book. nullptr is the global
+    // heap. Ignored with fixed_capacity, which has its own region.
+    std::pmr::memory_resource* memory = nullptr;
+
+    SelfTradePrevention self_trade_prevention = SelfTradePrevention::NONE;
+    // Owner ids 1 .. max_owners - 1 get a risk account (see set_risk_limits);
+    // orders from higher ids are rejected. 0 keeps risk checks off.
+    size_t max_owners = 0;
+};
+
+template<typename PriceT, typename QtyT>
+struct BasicTrade {
     uint64_t buy_order_id;
     uint64_t sell_order_id;
-    double price;
-    uint64_t quantity;
+    PriceT price;
+    QtyT quantity;
     uint64_t timestamp_ns;
 };
 
-class OrderBook {
+// Top of the book as last published by the thread that owns it
+template<typename PriceT, typename QtyT>
+struct BasicDepthSnapshot {
+    static constexpr size_t MAX_DEPTH = 10;
+
+    uint64_t sequence;     // book-changing events published so far
+    uint32_t bid_count;    // valid entries in bids, best first
+    uint32_t ask_count;    // valid entries in asks, best first
+    BasicPriceLevel<PriceT, QtyT> bids[MAX_DEPTH];
+    BasicPriceLevel<PriceT, QtyT> asks[MAX_DEPTH];
+};
+
+enum class CommandType : uint8_t {
+    ADD,
+    CANCEL,
+    AMEND
+};
+
+// One entry of a batch. ADD uses the whole order; CANCEL reads order_id;
+// AMEND reads order_id, price and quantity.
+template<typename PriceT, typename QtyT>
+struct BasicCommand {
+    CommandType type;
+    BasicOrder<PriceT, QtyT> order;
+};
+
+struct CommandResult {
+    bool accepted;         // ADD: not rejected; CANCEL/AMEND: order was found and changed
+    uint32_t trade_count;  // trades this command appended to the batch's trade buffer
+};
+
+// Size and health of a book at one moment (see BasicOrderBook::stats)
+struct BookStats {
+    size_t resting_orders = 0;   // on the ladder
+    size_t stop_orders = 0;      // waiting for their trigger
+    size_t bid_levels = 0;
+    size_t ask_levels = 0;
+
+    // Order pool: slots in use, carved so far, and most ever in use
+    size_t pool_live = 0;
+    size_t pool_capacity = 0;
+    size_t pool_high_water = 0;
+
+    // Order id index: ids / slots (kept at or below 1/2), the mean slots a
+    // lookup reads, and the longest insert probe since it last grew or
+    // was emptied
+    size_t index_capacity = 0;
+    double index_load = 0;
+    double index_mean_probe = 0;
+    size_t index_max_probe = 0;
+
+    // Bytes the book holds from its memory resource (its region with
+    // BookConfig::fixed_capacity), now and at most
+    size_t bytes_allocated = 0;
+    size_t bytes_high_water = 0;
+
+    // Since construction: accepted adds, orders taken out by cancel_order,
+    // amends to zero and the bulk cancels, and trades printed
+    uint64_t adds = 0;
+    uint64_t cancels = 0;
+    uint64_t fills = 0;
+};
+
+using Order = BasicOrder<double, uint64_t>;
+using PriceLevel = BasicPriceLevel<double, uint64_t>;
+using Trade = BasicTrade<double, uint64_t>;
+using DepthSnapshot = BasicDepthSnapshot<double, uint64_t>;
+using Command = BasicCommand<double, uint64_t>;
+
+// Matching rules of a BasicOrderBook, fixed at compile time. A policy is a
+// struct of static constexpr members; derive from PriceTimePolicy and
+// override what differs.
+struct PriceTimePolicy {
+    // Accepts OrderType::MARKET; when false they are rejected like an
+    // off-grid price and the market sweep is not compiled in
+    static constexpr bool market_orders = true;
+    // An amend that only reduces quantity keeps its queue position
+    static constexpr bool shrink_keeps_priority = true;
+    // Honours Order::display_quantity; when false icebergs are rejected and
+    // the slice refill is not compiled into the matching loop
+    static constexpr bool iceberg_orders = true;
+};
+
+class MarketDataPublisher;
+class ConflatingPublisher;
+struct TradeReport;
+template<typename T> class ShmBroadcastWriter;
+
+// Price-time limit order book over PriceT prices and QtyT quantities.
+//
+// PriceT is floating point (prices on the BookConfig grid, as before) or
+// integral (prices counted in the same units as BookConfig, which must then
+// hold whole numbers). QtyT also holds level totals. Side comparisons are
+// resolved at compile time: every path dispatches on the side once, on
+// entry, and the matching loops are instantiated per side.
+//
+// The implementation lives in order_book.cpp, which explicitly instantiates
+// the book for the parameter sets listed at its end; add a line there for a
+// new one.
+//
+// A book is owned by one thread: every member below must be called from it,
+// except read_depth_snapshot.
+template<typename PriceT, typename QtyT, typename Policy = PriceTimePolicy>
+class BasicOrderBook {
+public:
+    using Order = BasicOrder<PriceT, QtyT>;
+    using PriceLevel = BasicPriceLevel<PriceT, QtyT>;
+    using Trade = BasicTrade<PriceT, QtyT>;
+    using DepthSnapshot = BasicDepthSnapshot<PriceT, QtyT>;
+    using Command = BasicCommand<PriceT, QtyT>;
+
 private:
     class OrderBookImpl;
     OrderBookImpl* impl;
 
 public:
-    OrderBook();
-    ~OrderBook();
+    BasicOrderBook();
+    explicit BasicOrderBook(const BookConfig& config);
+    ~BasicOrderBook();
+
+    BasicOrderBook(const BasicOrderBook&) = delete;
+    BasicOrderBook& operator=(const BasicOrderBook&) = delete;
 
     std::vector<Trade> add_order(const Order& order);
 
+    // Appends the fills to a caller-owned buffer instead of returning a new
+    // vector. Reuse one buffer (clear() keeps its capacity) and the add/match
+    // path stops allocating once it has grown to the largest sweep seen.
+    // Returns the number of trades appended.
+    size_t add_order(const Order& order, std::vector<Trade>& trades);
+
     bool cancel_order(uint64_t order_id);
 
-    bool amend_order(uint64_t order_id, double new_price, uint64_t new_quantity);
+    // Bulk cancels, e.g. on a client's disconnect or to pull a price band.
+    // Each is one event however many orders it takes: one depth publish
+    // and one market-data delta per level it changed. Each returns the
+    // number of orders cancelled.
+    //
+    // Every resting and waiting stop order of owner_id. The account keeps a
+    // list of its orders, so this costs the owner's orders and no others;
+    // owners without an account (see BookConfig::max_owners) have none.
+    size_t mass_cancel(uint32_t owner_id);
+    // Every resting order of one side (bid_side selects it) priced in
+    // [low, high], taken from the book a whole level at a time. Waiting
+    // stop orders stay.
+    size_t mass_cancel(bool bid_side, PriceT low, PriceT high);
+    // Every resting and waiting stop order
+    size_t cancel_all();
+
+    // Reducing quantity at the same price keeps queue position; any other
+    // change re-queues at the back of the new level. A price that crosses the
+    // spread is matched first, with the fills appended to trades. A new
+    // quantity of zero cancels the order. For an iceberg new_quantity is the
+    // total, displayed and hidden, and a reduction comes out of the hidden
+    // part first. A stop order still waiting for its trigger can only be
+    // cancelled.
+    bool amend_order(uint64_t order_id, PriceT new_price, QtyT new_quantity, std::vector<Trade>& trades);
+    bool amend_order(uint64_t order_id, PriceT new_price, QtyT new_quantity);
+
+    // Applies commands in order with one call into the book, appending every
+    // fill to trades and one CommandResult per command to results. Returns
+    // the number of accepted commands.
+    size_t process_batch(std::span<const Command> commands, std::vector<Trade>& trades,
+                         std::vector<CommandResult>& results);
+
+    // Opening or closing auction. Until uncross(), limit and post-only
+    // orders rest without matching, so the book may cross; market, IOC and
+    // FOK orders are rejected and amends re-queue without trading.
+    void begin_auction();
+    bool in_auction() const;
+
+    // The price uncross() would trade at and the volume it would fill,
+    // hidden iceberg quantity included. False if the book is not crossed.
+    bool auction_price(PriceT& price, uint64_t& volume) const;
+
+    // Ends the auction. Every crossing order fills at one price: the one
+    // that executes the most volume, then leaves the smallest surplus, then
+    // lies towards the surplus side (the middle of the range if there is
+    // none). Both sides fill in price-time priority, self-trade prevention
+    // does not apply, and matching is continuous again afterwards. Returns
+    // the number of trades appended.
+    size_t uncross(std::vector<Trade>& trades);
 
     void get_snapshot(size_t depth, std::vector<PriceLevel>& bids, std::vector<PriceLevel>& asks) const;
 
     void print_book(size_t depth = 10) const;
 
-    double get_best_bid() const;
-    double get_best_ask() const;
+    // The book's size and health from counters kept as it runs, cheap
+    // enough to scrape every second: no order or level is visited.
+    BookStats stats() const;
+
+    // Safe from any thread while the owner is matching: copies the depth the
+    // owner published after its last event, without locks and without ever
+    // delaying it. Returns false if BookConfig::published_depth is 0.
+    bool read_depth_snapshot(DepthSnapshot& out) const;
+
+    // Emits one level delta per changed level after every event into the
+    // publisher's channel, plus full snapshots (see market_data.h). A snapshot
+    // is sent on attach. The publisher is not owned; nullptr detaches.
+    void set_market_data(MarketDataPublisher* publisher);
+
+    // Keeps the latest state of every changed level in the publisher's
+    // table for consumers that may fall behind (see market_data.h), next
+    // to or instead of a MarketDataPublisher. Attaching brings the table up
+    // to the book. Throws std::invalid_argument if the publisher was built
+    // for another price grid. Not owned; nullptr detaches.
+    void set_conflating_publisher(ConflatingPublisher* publisher);
+
+    // Publishes every fill, as it happens, into a shared-memory ring that
+    // other processes read (see trade_feed.h). The ring is not owned;
+    // nullptr detaches.
+    void set_trade_feed(ShmBroadcastWriter<TradeReport>* feed);
+
+    // Serializes every resting order, level by level in time priority, and
+    // every waiting stop order into a compact versioned binary image
+    // (replacing image's contents). sequence is stored with it, e.g. the
+    // journal position the image corresponds to.
+    void save_state(std::vector<char>& image, uint64_t sequence = 0) const;
+
+    // Replaces the book's contents with an image from save_state, building
+    // the ladder and order index directly. Fails, leaving the book unchanged,
+    // if the image is malformed, of another version, or from a book with a
+    // different price grid.
+    bool load_state(std::span<const char> image, uint64_t* sequence = nullptr);
+
+    PriceT get_best_bid() const;
+    PriceT get_best_ask() const;
+
+    // Depth queries for strategies polling the book between events. They
+    // read one side (bid_side selects it) from its best price outwards, and
+    // none of them allocates. Like the snapshots and market data they see
+    // displayed quantity only, not the hidden part of icebergs.
+
+    // Writes to out[i] the quantity resting within i ticks of the best
+    // price, for as many entries as out holds and the ladder has ticks.
+    // Returns the number written, 0 if the side is empty.
+    size_t cumulative_depth(bool bid_side, std::span<uint64_t> out) const;
+
+    // Sets price to the worst price a market order for quantity would
+    // trade at. False, leaving price alone, if the side holds less.
+    bool depth_to_quantity(bool bid_side, QtyT quantity, PriceT& price) const;
+
+    // Average price of taking quantity from the side, or all of it if it
+    // holds less; 0 if nothing would fill. filled, if given, receives the
+    // quantity that would fill, so the cost is vwap() * *filled.
+    double vwap(bool bid_side, QtyT quantity, QtyT* filled = nullptr) const;
 
     bool order_exists(uint64_t order_id) const;
 
+    // Pre-trade limits for one account, checked in O(1) as each order or
+    // amend arrives and kept up to date by the matching loop itself:
+    //   max_position        bound on |position| if every resting order of
+    //                       the account and the new one filled (0 = none)
+    //   max_order_notional  bound on price * quantity of one order; market
+    //                       orders stop filling when they reach it (0 = none)
+    // Returns false if owner_id has no account (see BookConfig::max_owners).
+    bool set_risk_limits(uint32_t owner_id, uint64_t max_position, double max_order_notional);
+
+    // Net filled quantity of an account, buys positive; 0 without one.
+    // Positions are not part of save_state images.
+    int64_t position(uint32_t owner_id) const;
+
     void get_price_levels(std::vector<PriceLevel>& bids, std::vector<PriceLevel>& asks) const;
-};
\ No newline at end of file
+
+protected:
+    // For FixedOrderBook: add_order and amend_order with the fills in a
+    // buffer the book carves from its BookConfig::fixed_capacity region.
+    // fixed_trades() holds the fills of the latest such call.
+    std::span<const Trade> add_order_fixed(const Order& order);
+    bool amend_order_fixed(uint64_t order_id, PriceT new_price, QtyT new_quantity);
+    std::span<const Trade> fixed_trades() const;
+};
+
+extern template class BasicOrderBook<double, uint64_t, PriceTimePolicy>;
+extern template class BasicOrderBook<int64_t, uint32_t, PriceTimePolicy>;
+
+using OrderBook = BasicOrderBook<double, uint64_t>;
+
+// Exact fixed-point prices (e.g. in cents with tick_size 1) and 32-bit sizes
+using TickOrderBook = BasicOrderBook<int64_t, uint32_t>;
+
+// Book with its capacity fixed at compile time: MaxOrders resting orders on
+// MaxLevels ticks per side, starting at min_price. All storage is mapped,
+// optionally on huge pages, and faulted in by the constructor (see
+// BookConfig::fixed_capacity), trade buffer included. The add_order and
+// amend_order overloads without a trade buffer fill that one, so they never
+// allocate or fault; last_trades() holds the fills of the latest such call.
+//
+// The buffer holds two trades per order plus two. To keep within it,
+// last_trades() has one trade per resting order each aggressor meets at a
+// level: the slices of an iceberg it fills there are added together, where
+// the trade feed and the other overloads print each slice. With stop orders
+// waiting as well as icebergs resting, an event whose trades could still
+// outgrow the buffer is rejected before it touches the book.
+template<size_t MaxOrders, size_t MaxLevels, typename PriceT = double, typename QtyT = uint64_t,
+         typename Policy = PriceTimePolicy>
+class FixedOrderBook : public BasicOrderBook<PriceT, QtyT, Policy> {
+    static_assert(MaxOrders > 0 && MaxLevels > 0, "FixedOrderBook: capacity must be non-zero");
+    static_assert(MaxLevels <= UINT32_MAX, "FixedOrderBook: too many levels");
+
+    using Base = BasicOrderBook<PriceT, QtyT, Policy>;
+
+public:
+    using typename Base::Order;
+    using typename Base::Trade;
+
+    static constexpr size_t max_orders = MaxOrders;
+    static constexpr size_t max_levels = MaxLevels;
+
+    explicit FixedOrderBook(double tick_size, double min_price = 0.0, bool huge_pages = true,
+                            size_t published_depth = 0, int numa_node = -1)
+        : Base(config_for(tick_size, min_price, huge_pages, published_depth, numa_node)) {}
+
+    using Base::add_order;
+    using Base::amend_order;
+
+    std::span<const Trade> add_order(const Order& order) { return Base::add_order_fixed(order); }
+
+    bool amend_order(uint64_t order_id, PriceT new_price, QtyT new_quantity) {
+        return Base::amend_order_fixed(order_id, new_price, new_quantity);
+    }
+
+    std::span<const Trade> last_trades() const { return Base::fixed_trades(); }
+
+private:
+    static BookConfig config_for(double tick_size, double min_price, bool huge_pages, size_t published_depth,
+                                 int numa_node) {
+        BookConfig config;
+        config.tick_size = tick_size;
+        config.min_price = min_price;
+        config.max_price = min_price + static_cast<double>(MaxLevels - 1) * tick_size;
+        config.reserve_orders = MaxOrders;
+        config.published_depth = published_depth;
+        config.fixed_capacity = true;
+        config.huge_pages = huge_pages;
+        config.numa_node = numa_node;
+        return config;
+    }
+};
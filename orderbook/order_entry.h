@@ -0,0 +1,176 @@
+#pragma once
+#include "order_book.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+// Fixed-width binary order-entry protocol. All fields are little-endian;
+// prices are IEEE-754 binary64. Every message starts with the same 8-byte
+// header and has one fixed length per type, so a receiver frames a stream
+// by reading the length at offset 0 and decodes fields straight out of its
+// receive buffer.
+//
+//   header   0  u16 length     total bytes, header included
+//            2  u8  type
+//            3  u8  reserved   0
+//            4  u32 client_seq chosen by the client, echoed in ACK and TRADE
+//
+//   ADD      8  u64 order_id   16 f64 price   24 u64 quantity
+//           32  u64 timestamp_ns              40 u8 side (0 buy, 1 sell)
+//           41  u8  order_type (OrderType: 0 limit, 1 market, 2 IOC, 3 FOK,
+//                                4 post-only; stop orders cannot be
+//                                sent)          42 2 bytes zero
+//           44  u32 display_quantity (iceberg slice, 0 = all shown;
+//                                larger slices are sent capped)
+//   CANCEL   8  u64 order_id
+//   AMEND    8  u64 order_id   16 f64 new_price     24 u64 new_quantity
+//
+//   ACK      8  u64 order_id   16 u8 accepted (0/1)  17 3 bytes zero
+//           20  u32 trade_count (TRADE messages that follow this ACK)
+//   TRADE    8  u64 buy_order_id   16 u64 sell_order_id   24 f64 price
+//           32  u64 quantity       40 u64 timestamp_ns
+//
+// An OrderEntryServer fronts one book. A Gateway (gateway.h) fronts many,
+// and routes by the instrument named in the top 16 bits of order_id (see
+// symbol_of), so CANCEL and AMEND need no field of their own.
+namespace order_entry {
+
+enum MessageType : uint8_t {
+    ADD = 1,
+    CANCEL = 2,
+    AMEND = 3,
+    ACK = 0x81,
+    TRADE = 0x82
+};
+
+constexpr size_t HEADER_SIZE = 8;
+constexpr size_t ADD_SIZE = 48;
+constexpr size_t CANCEL_SIZE = 16;
+constexpr size_t AMEND_SIZE = 32;
+constexpr size_t ACK_SIZE = 24;
+constexpr size_t TRADE_SIZE = 48;
+constexpr size_t MAX_MESSAGE_SIZE = 48;
+
+constexpr unsigned SYMBOL_SHIFT = 48;
+
+// The instrument a Gateway routes an order id to
+inline uint32_t symbol_of(uint64_t order_id) { return static_cast<uint32_t>(order_id >> SYMBOL_SHIFT); }
+
+// Expected length of an inbound message type, 0 if the type is not inbound
+inline size_t inbound_size(uint8_t type) {
+    switch (type) {
+        case ADD: return ADD_SIZE;
+        case CANCEL: return CANCEL_SIZE;
+        case AMEND: return AMEND_SIZE;
+        default: return 0;
+    }
+}
+
+// Fields are copied as host bytes, which is the wire order on every target
+// this engine runs on
+static_assert(std::endian::native == std::endian::little, "order_entry assumes a little-endian host");
+
+template<typename T>
+T load(const char* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+template<typename T>
+void store(char* p, T value) {
+    std::memcpy(p, &value, sizeof(T));
+}
+
+inline uint16_t message_length(const char* message) { return load<uint16_t>(message); }
+inline uint8_t message_type(const char* message) { return load<uint8_t>(message + 2); }
+inline uint32_t client_seq(const char* message) { return load<uint32_t>(message + 4); }
+
+inline void store_header(char* out, uint16_t length, uint8_t type, uint32_t seq) {
+    store<uint16_t>(out, length);
+    store<uint8_t>(out + 2, type);
+    store<uint8_t>(out + 3, 0);
+    store<uint32_t>(out + 4, seq);
+}
+
+// Decodes a complete inbound message of a known type into a book command
+inline Command decode_command(const char* message) {
+    Command command{};
+    command.order.order_id = load<uint64_t>(message + 8);
+    switch (message_type(message)) {
+        case ADD:
+            command.type = CommandType::ADD;
+            command.order.price = load<double>(message + 16);
+            command.order.quantity = load<uint64_t>(message + 24);
+            command.order.timestamp_ns = load<uint64_t>(message + 32);
+            command.order.is_buy = load<uint8_t>(message + 40) == 0;
+            // Unknown types pass through and the book rejects them. ADD has no
+            // stop price field, so the stop types are made unknown as well.
+            command.order.order_type = static_cast<OrderType>(load<uint8_t>(message + 41));
+            if (command.order.order_type == OrderType::STOP || command.order.order_type == OrderType::STOP_LIMIT) {
+                command.order.order_type = static_cast<OrderType>(UINT8_MAX);
+            }
+            command.order.display_quantity = load<uint32_t>(message + 44);
+            break;
+        case CANCEL:
+            command.type = CommandType::CANCEL;
+            break;
+        case AMEND:
+            command.type = CommandType::AMEND;
+            command.order.price = load<double>(message + 16);
+            command.order.quantity = load<uint64_t>(message + 24);
+            break;
+    }
+    return command;
+}
+
+// Encoders; each writes exactly its message size at out and returns it
+
+inline size_t encode_add(char* out, uint32_t seq, const Order& order) {
+    std::memset(out, 0, ADD_SIZE);
+    store_header(out, ADD_SIZE, ADD, seq);
+    store<uint64_t>(out + 8, order.order_id);
+    store<double>(out + 16, order.price);
+    store<uint64_t>(out + 24, order.quantity);
+    store<uint64_t>(out + 32, order.timestamp_ns);
+    store<uint8_t>(out + 40, order.is_buy ? 0 : 1);
+    store<uint8_t>(out + 41, static_cast<uint8_t>(order.order_type));
+    store<uint32_t>(out + 44, static_cast<uint32_t>(std::min<uint64_t>(order.display_quantity, UINT32_MAX)));
+    return ADD_SIZE;
+}
+
+inline size_t encode_cancel(char* out, uint32_t seq, uint64_t order_id) {
+    store_header(out, CANCEL_SIZE, CANCEL, seq);
+    store<uint64_t>(out + 8, order_id);
+    return CANCEL_SIZE;
+}
+
+inline size_t encode_amend(char* out, uint32_t seq, uint64_t order_id, double new_price, uint64_t new_quantity) {
+    store_header(out, AMEND_SIZE, AMEND, seq);
+    store<uint64_t>(out + 8, order_id);
+    store<double>(out + 16, new_price);
+    store<uint64_t>(out + 24, new_quantity);
+    return AMEND_SIZE;
+}
+
+inline size_t encode_ack(char* out, uint32_t seq, uint64_t order_id, bool accepted, uint32_t trade_count) {
+    std::memset(out, 0, ACK_SIZE);
+    store_header(out, ACK_SIZE, ACK, seq);
+    store<uint64_t>(out + 8, order_id);
+    store<uint8_t>(out + 16, accepted ? 1 : 0);
+    store<uint32_t>(out + 20, trade_count);
+    return ACK_SIZE;
+}
+
+inline size_t encode_trade(char* out, uint32_t seq, const Trade& trade) {
+    store_header(out, TRADE_SIZE, TRADE, seq);
+    store<uint64_t>(out + 8, trade.buy_order_id);
+    store<uint64_t>(out + 16, trade.sell_order_id);
+    store<double>(out + 24, trade.price);
+    store<uint64_t>(out + 32, trade.quantity);
+    store<uint64_t>(out + 40, trade.timestamp_ns);
+    return TRADE_SIZE;
+}
+
+}
@@ -0,0 +1,153 @@
+#include "order_entry_server.h"
+#include "order_entry.h"
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    // How often a blocked accept() or recv() comes back to look at stop
+    constexpr int STOP_POLL_MS = 100;
+
+    void set_receive_timeout(int fd) {
+        timeval timeout{0, STOP_POLL_MS * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+    bool would_block() {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+}
+
+OrderEntryServer::OrderEntryServer(OrderBook& book, const OrderEntryServerConfig& config)
+    : book(book), config(config) {
+    in.resize(config.buffer_bytes < order_entry::MAX_MESSAGE_SIZE ? order_entry::MAX_MESSAGE_SIZE : config.buffer_bytes);
+}
+
+OrderEntryServer::~OrderEntryServer() {
+    if (listen_fd >= 0) close(listen_fd);
+}
+
+bool OrderEntryServer::listen() {
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) return false;
+
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(config.port);
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listen_fd, 1) != 0) {
+        int saved = errno;
+        close(listen_fd);
+        listen_fd = -1;
+        errno = saved;
+        return false;
+    }
+
+    socklen_t length = sizeof(address);
+    getsockname(listen_fd, reinterpret_cast<sockaddr*>(&address), &length);
+    bound_port = ntohs(address.sin_port);
+    set_receive_timeout(listen_fd);
+    return true;
+}
+
+void OrderEntryServer::run(const std::atomic<bool>& stop) {
+    while (!stop.load(std::memory_order_relaxed)) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) continue;  // timeout: re-check stop
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        set_receive_timeout(fd);
+        serve(fd, stop);
+        close(fd);
+    }
+}
+
+bool OrderEntryServer::serve(int fd, const std::atomic<bool>& stop) {
+    using namespace order_entry;
+    size_t pending = 0;
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        ssize_t received = recv(fd, in.data() + pending, in.size() - pending, 0);
+        if (received == 0) return true;
+        if (received < 0) {
+            if (would_block()) continue;
+            return false;
+        }
+
+        // Frame every complete message where it landed
+        const size_t available = pending + static_cast<size_t>(received);
+        size_t offset = 0;
+        bool broken = false;
+        while (available - offset >= HEADER_SIZE) {
+            const char* message = in.data() + offset;
+            const size_t length = message_length(message);
+            if (length != inbound_size(message_type(message))) {
+                broken = true;
+                break;
+            }
+            if (available - offset < length) break;
+            commands.push_back(decode_command(message));
+            if (commands.back().order.owner_id == 0) commands.back().order.owner_id = config.owner_id;
+            client_seqs.push_back(client_seq(message));
+            offset += length;
+        }
+        messages += commands.size();
+
+        // Answer what was framed, even if the stream broke after it
+        if (!commands.empty()) {
+            book.process_batch(commands, trades, results);
+            if (journal && !journal->append_batch(commands, results, trades)) {
+                journal_failures++;
+            }
+
+            out.resize(commands.size() * ACK_SIZE + trades.size() * TRADE_SIZE);
+            char* cursor = out.data();
+            size_t next_trade = 0;
+            for (size_t i = 0; i < commands.size(); ++i) {
+                cursor += encode_ack(cursor, client_seqs[i], commands[i].order.order_id,
+                                     results[i].accepted, results[i].trade_count);
+                for (uint32_t t = 0; t < results[i].trade_count; ++t) {
+                    cursor += encode_trade(cursor, client_seqs[i], trades[next_trade++]);
+                }
+            }
+
+            commands.clear();
+            client_seqs.clear();
+            trades.clear();
+            results.clear();
+            if (!send_all(fd, out.data(), out.size())) return false;
+        }
+
+        if (broken) {
+            protocol_errors++;
+            return false;
+        }
+
+        pending = available - offset;
+        if (pending > 0) {
+            std::memmove(in.data(), in.data() + offset, pending);
+        }
+    }
+    return true;
+}
+
+bool OrderEntryServer::send_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        length -= static_cast<size_t>(sent);
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "order_book.h"
+#include "journal.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+struct OrderEntryServerConfig {
+    uint16_t port = 9000;  // 0 picks an ephemeral port, see port()
+    // Receive buffer per session; one recv() fills as much as fits
+    size_t buffer_bytes = 1 << 16;
+    // Stamped on every order of the connection, for the book's self-trade
+    // prevention and risk limits (0 = none)
+    uint32_t owner_id = 0;
+};
+
+// Non-interactive front end for one OrderBook speaking the binary protocol
+// in order_entry.h over TCP, one client session at a time.
+//
+// Each recv() is framed in place: every complete message in it is decoded
+// from the buffer into a Command and the whole run goes through a single
+// process_batch. For every command, in order, the session returns one ACK
+// followed by its TRADE messages, all in one send(). Nothing is printed on
+// this path. A message with an unknown type or a wrong length ends the
+// session, because the stream can no longer be framed.
+class OrderEntryServer {
+public:
+    explicit OrderEntryServer(OrderBook& book, const OrderEntryServerConfig& config = OrderEntryServerConfig{});
+    ~OrderEntryServer();
+
+    OrderEntryServer(const OrderEntryServer&) = delete;
+    OrderEntryServer& operator=(const OrderEntryServer&) = delete;
+
+    // Binds and listens on the configured port; false (errno set) on failure
+    bool listen();
+
+    // Port actually bound, once listen() succeeded
+    uint16_t port() const { return bound_port; }
+
+    // Accepts and serves clients one after another until stop is set
+    void run(const std::atomic<bool>& stop);
+
+    // Serves one connected socket until the peer closes, stop is set, or the
+    // peer breaks the protocol. Returns false on a protocol or socket error.
+    bool serve(int fd, const std::atomic<bool>& stop);
+
+    // Journals every batch (commands and their trades) before its replies
+    // are sent; the journal is not owned, nullptr turns journaling off
+    void set_journal(JournalWriter* writer) { journal = writer; }
+
+    uint64_t message_count() const { return messages; }
+    uint64_t protocol_error_count() const { return protocol_errors; }
+    // Batches that did not fit in the journal
+    uint64_t journal_failure_count() const { return journal_failures; }
+
+private:
+    bool send_all(int fd, const char* data, size_t length);
+
+    OrderBook& book;
+    OrderEntryServerConfig config;
+    JournalWriter* journal = nullptr;
+    int listen_fd = -1;
+    uint16_t bound_port = 0;
+
+    // Reused across batches so the session loop stops allocating once warm
+    std::vector<char> in;
+    std::vector<char> out;
+    std::vector<Command> commands;
+    std::vector<uint32_t> client_seqs;
+    std::vector<Trade> trades;
+    std::vector<CommandResult> results;
+
+    uint64_t messages = 0;
+    uint64_t protocol_errors = 0;
+    uint64_t journal_failures = 0;
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+
+/// Flat open-addressing map from order id to a handle into the order pool.
+/// Linear probing over one contiguous slot array, with backward-shift deletion
+/// so cancel-heavy flow never leaves tombstones behind to lengthen probes.
+/// The id ~0 is reserved as the empty-slot marker and cannot be stored.
+/// The slot array comes from `resource`, the global heap by default.
+template<typename Handle>
+class OrderIndex
+{
+public:
+    static constexpr uint64_t EMPTY_KEY = ~uint64_t{0};
+
+    explicit OrderIndex(size_t capacity = 1024,
+                        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : slots_{resource}
+    {
+        rehash(slots_for(capacity));
+    }
+
+    /// Bytes of slot array an index constructed for `count` ids allocates.
+    static size_t storage_bytes(size_t count) noexcept { return slots_for(count) * sizeof(Slot); }
+
+    /// Grows the table so that `count` ids fit without another rehash.
+    void reserve(size_t count) {
+        size_t wanted = slots_for(count);
+        if (wanted > slots_.size()) {
+            rehash(wanted);
+        }
+    }
+
+    /// Returns the handle stored for `key`, or nullptr if absent.
+    Handle* find(uint64_t key) noexcept {
+        if (key == EMPTY_KEY) return nullptr;  // would match the first empty slot
+        for (size_t i = home(key);; i = (i + 1) & mask_) {
+            Slot& slot = slots_[i];
+            if (slot.key == key) return &slot.value;
+            if (slot.key == EMPTY_KEY) return nullptr;
+        }
+    }
+
+    Handle const* find(uint64_t key) const noexcept {
+        return const_cast<OrderIndex*>(this)->find(key);
+    }
+
+    bool contains(uint64_t key) const noexcept { return find(key) != nullptr; }
+
+    /// Hints the cache to load the home slot of `key` ahead of a lookup.
+    void prefetch(uint64_t key) const noexcept { __builtin_prefetch(&slots_[home(key)]); }
+
+    /// Inserts `key`; returns `false` without modifying anything if already present.
+    bool insert(uint64_t key, Handle value) {
+        if ((size_ + 1) * 2 > slots_.size()) {
+            rehash(slots_.size() * 2);
+        }
+        const size_t start = home(key);
+        for (size_t i = start;; i = (i + 1) & mask_) {
+            Slot& slot = slots_[i];
+            if (slot.key == key) return false;
+            if (slot.key == EMPTY_KEY) {
+                slot.key = key;
+                slot.value = value;
+                ++size_;
+                const size_t distance = (i - start) & mask_;
+                displacement_ += distance;
+                if (distance >= max_probe_) max_probe_ = distance + 1;
+                return true;
+            }
+        }
+    }
+
+    /// Removes `key`; returns `false` if it was absent.
+    bool erase(uint64_t key) noexcept {
+        if (key == EMPTY_KEY) return false;
+        size_t hole = home(key);
+        while (slots_[hole].key != key) {
+            if (slots_[hole].key == EMPTY_KEY) return false;
+            hole = (hole + 1) & mask_;
+        }
+        displacement_ -= (hole - home(key)) & mask_;
+
+        // Shift later members of the probe run back into the hole so that
+        // every remaining key is still reachable from its home slot.
+        for (size_t next = (hole + 1) & mask_; slots_[next].key != EMPTY_KEY; next = (next + 1) & mask_) {
+            size_t next_home = home(slots_[next].key);
+            if (((next - next_home) & mask_) >= ((next - hole) & mask_)) {
+                displacement_ -= (next - hole) & mask_;
+                slots_[hole] = slots_[next];
+                hole = next;
+            }
+        }
+        slots_[hole].key = EMPTY_KEY;
+        --size_;
+        return true;
+    }
+
+    /// Removes every key, keeping the slot array.
+    void clear() noexcept {
+        for (Slot& slot : slots_) slot.key = EMPTY_KEY;
+        size_ = 0;
+        displacement_ = 0;
+        max_probe_ = 0;
+    }
+
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    size_t capacity() const noexcept { return slots_.size(); }
+
+    /// Slots a successful lookup reads on average: one more than the mean
+    /// distance of the stored ids from their home slots, kept exactly as
+    /// ids are inserted and shifted back. 0 while empty.
+    double mean_probe_length() const noexcept {
+        return size_ == 0 ? 0.0 : 1.0 + static_cast<double>(displacement_) / static_cast<double>(size_);
+    }
+
+    /// Slots the longest insert has probed since the table last grew or was
+    /// cleared, 0 if none has. A high-water mark: erasing ids does not lower it.
+    size_t max_probe_length() const noexcept { return max_probe_; }
+
+private:
+    struct Slot {
+        uint64_t key = EMPTY_KEY;
+        Handle value{};
+    };
+
+    // Keeps the load factor at or below 1/2
+    static size_t slots_for(size_t count) noexcept {
+        size_t slots = 16;
+        while (slots < count * 2) slots *= 2;
+        return slots;
+    }
+
+    // Fibonacci hashing spreads sequential ids evenly over the table
+    size_t home(uint64_t key) const noexcept {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    void rehash(size_t slot_count) {
+        std::pmr::vector<Slot> old{slots_.get_allocator()};
+        old.swap(slots_);
+        slots_.assign(slot_count, Slot{});
+        mask_ = slot_count - 1;
+        shift_ = 64 - __builtin_ctzll(slot_count);
+        size_ = 0;
+        displacement_ = 0;
+        max_probe_ = 0;
+        for (Slot const& slot : old) {
+            if (slot.key != EMPTY_KEY) insert(slot.key, slot.value);
+        }
+    }
+
+    std::pmr::vector<Slot> slots_;
+    size_t mask_ = 0;
+    unsigned shift_ = 64;
+    size_t size_ = 0;
+    size_t displacement_ = 0;      // sum over stored ids of their distance from home
+    size_t max_probe_ = 0;
+};
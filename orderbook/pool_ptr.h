@@ -0,0 +1,177 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "memory_pool.h"
+
+
+/// Deleter that hands an object back to the ObjectPool it came from rather
+/// than to the global heap.
+template<typename T>
+struct PoolDelete
+{
+    ObjectPool<T>* pool;
+
+    void operator()(T* object) const noexcept { pool->destroy(object); }
+};
+
+/// Sole owner of a pooled object: the UniquePtr of L8/unqiePtr.cpp, with
+/// reset and destruction returning the slot to its pool.
+template<typename T>
+using PoolUniquePtr = std::unique_ptr<T, PoolDelete<T>>;
+
+template<typename T, typename... Args>
+PoolUniquePtr<T> make_pool_unique(ObjectPool<T>& pool, Args&&... args) {
+    return PoolUniquePtr<T>{pool.create(std::forward<Args>(args)...), PoolDelete<T>{&pool}};
+}
+
+
+template<typename T>
+class IntrusivePtr;
+
+template<typename T, typename... Args>
+IntrusivePtr<T> make_intrusive(ObjectPool<T>& pool, Args&&... args);
+
+
+/// Base for objects shared through IntrusivePtr. The count and the pool live
+/// in the object itself, so sharing it takes no control block and no
+/// allocation beyond the object's own pool slot, where std::make_shared (see
+/// L10/sharedPtrMore.cpp) needs a heap block per object.
+///
+/// With `Atomic` false the count is a plain integer and every copy or drop
+/// is an ordinary increment: for objects only one thread ever sees, the
+/// common case. With `Atomic` true references may be copied and dropped
+/// from any thread, but the pool is single-threaded like the rest of
+/// memory_pool.h, so the last reference must still be dropped on the
+/// pool's thread (e.g. by handing it back through an SPSC queue).
+///
+/// An object not created through make_intrusive has no pool and is deleted
+/// when its last reference goes, so it must come from new. Derive publicly:
+/// `struct Session : RefCounted<Session> { ... };`
+template<typename Derived, bool Atomic = false>
+class RefCounted
+{
+public:
+    /// References currently held; only a hint while other threads hold some
+    uint32_t use_count() const noexcept {
+        if constexpr (Atomic) {
+            return refs_.load(std::memory_order_relaxed);
+        } else {
+            return refs_;
+        }
+    }
+
+protected:
+    RefCounted() = default;
+    ~RefCounted() = default;
+
+    // A copy is a new object: it starts unowned and keeps no pool
+    RefCounted(RefCounted const&) noexcept {}
+    RefCounted& operator=(RefCounted const&) noexcept { return *this; }
+
+private:
+    template<typename T>
+    friend class IntrusivePtr;
+
+    template<typename T, typename... Args>
+    friend IntrusivePtr<T> make_intrusive(ObjectPool<T>& pool, Args&&... args);
+
+    void add_ref() noexcept {
+        if constexpr (Atomic) {
+            refs_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            ++refs_;
+        }
+    }
+
+    void release() noexcept {
+        if constexpr (Atomic) {
+            // Release so this thread's writes happen before the destruction,
+            // acquire so the destroying thread sees everyone's
+            if (refs_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                return;
+            }
+        } else {
+            if (--refs_ != 0) {
+                return;
+            }
+        }
+        Derived* self = static_cast<Derived*>(this);
+        if (pool_ != nullptr) {
+            pool_->destroy(self);
+        } else {
+            delete self;
+        }
+    }
+
+    std::conditional_t<Atomic, std::atomic<uint32_t>, uint32_t> refs_{0};
+    ObjectPool<Derived>* pool_ = nullptr;
+};
+
+/// Shared owner of an object derived from RefCounted. One pointer wide;
+/// copying touches only the count in the object, and moving touches nothing.
+template<typename T>
+class IntrusivePtr
+{
+public:
+    IntrusivePtr() noexcept = default;
+
+    /// Adopts `object`, adding a reference
+    explicit IntrusivePtr(T* object) noexcept
+        : object_{object}
+    {
+        if (object_ != nullptr) {
+            object_->add_ref();
+        }
+    }
+
+    IntrusivePtr(IntrusivePtr const& other) noexcept
+        : IntrusivePtr{other.object_}
+    {}
+
+    IntrusivePtr(IntrusivePtr&& other) noexcept
+        : object_{std::exchange(other.object_, nullptr)}
+    {}
+
+    IntrusivePtr& operator=(IntrusivePtr const& other) noexcept {
+        IntrusivePtr{other}.swap(*this);
+        return *this;
+    }
+
+    IntrusivePtr& operator=(IntrusivePtr&& other) noexcept {
+        IntrusivePtr{std::move(other)}.swap(*this);
+        return *this;
+    }
+
+    ~IntrusivePtr() {
+        if (object_ != nullptr) {
+            object_->release();
+        }
+    }
+
+    void reset() noexcept { IntrusivePtr{}.swap(*this); }
+    void swap(IntrusivePtr& other) noexcept { std::swap(object_, other.object_); }
+
+    T* get() const noexcept { return object_; }
+    T& operator*() const noexcept { return *object_; }
+    T* operator->() const noexcept { return object_; }
+    explicit operator bool() const noexcept { return object_ != nullptr; }
+
+    friend bool operator==(IntrusivePtr const& a, IntrusivePtr const& b) noexcept { return a.object_ == b.object_; }
+
+private:
+    T* object_ = nullptr;
+};
+
+/// Creates an object in `pool` and returns the first reference to it; the
+/// last reference returns it to `pool`.
+template<typename T, typename... Args>
+IntrusivePtr<T> make_intrusive(ObjectPool<T>& pool, Args&&... args) {
+    T* object = pool.create(std::forward<Args>(args)...);
+    object->pool_ = &pool;
+    return IntrusivePtr<T>{object};
+}
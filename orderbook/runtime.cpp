@@ -0,0 +1,249 @@
+#include "runtime.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+    std::string trim(const std::string& text) {
+        const size_t begin = text.find_first_not_of(" \t\r");
+        if (begin == std::string::npos) return "";
+        const size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    // First line of a sysfs file, or empty if it does not exist
+    std::string read_line(const std::string& path) {
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line);
+        return trim(line);
+    }
+
+    // A sysfs CPU list ("1-3,6"); empty or missing is no CPUs
+    std::set<int> parse_cpu_list(const std::string& list) {
+        std::set<int> cpus;
+        std::stringstream stream(list);
+        std::string range;
+        while (std::getline(stream, range, ',')) {
+            if (range.empty() || !std::isdigit(static_cast<unsigned char>(range[0]))) continue;  // "(null)"
+            const size_t dash = range.find('-');
+            const int first = std::atoi(range.c_str());
+            const int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+            for (int cpu = first; cpu <= last; ++cpu) cpus.insert(cpu);
+        }
+        return cpus;
+    }
+
+    std::string cpu_path(const RuntimeConfig& config, int core, const char* leaf) {
+        return config.sysfs + "/devices/system/cpu/cpu" + std::to_string(core) + "/" + leaf;
+    }
+
+    bool parse_int(const std::string& text, int& value) {
+        char* end = nullptr;
+        errno = 0;
+        const long parsed = std::strtol(text.c_str(), &end, 10);
+        if (text.empty() || *end != '\0' || errno != 0) return false;
+        value = static_cast<int>(parsed);
+        return true;
+    }
+
+    bool parse_bool(const std::string& text, bool& value) {
+        if (text == "true" || text == "1" || text == "yes") return value = true, true;
+        if (text == "false" || text == "0" || text == "no") return value = false, true;
+        return false;
+    }
+}
+
+RuntimeConfig load_runtime_config(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("Runtime: cannot open " + path);
+
+    RuntimeConfig config;
+    std::string line;
+    for (int number = 1; std::getline(file, line); ++number) {
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) line.resize(comment);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        auto fail = [&](const std::string& what) {
+            return std::runtime_error("Runtime: " + path + ":" + std::to_string(number) + ": " + what);
+        };
+        const size_t equals = line.find('=');
+        if (equals == std::string::npos) throw fail("expected key = value");
+        const std::string key = trim(line.substr(0, equals));
+        const std::string value = trim(line.substr(equals + 1));
+
+        bool valid = false;
+        if (key == "lock_memory") {
+            valid = parse_bool(value, config.lock_memory);
+        } else if (key == "strict") {
+            valid = parse_bool(value, config.strict);
+        } else if (key.rfind("thread.", 0) == 0) {
+            // thread.<role>.core / thread.<role>.priority
+            const size_t dot = key.rfind('.');
+            if (dot <= 7) throw fail("expected thread.<role>.core or .priority");
+            const std::string role = key.substr(7, dot - 7);
+            const std::string field = key.substr(dot + 1);
+            ThreadPlacement& placement = config.threads[role];
+            if (field == "core") {
+                valid = parse_int(value, placement.core) && placement.core >= -1;
+            } else if (field == "priority") {
+                valid = parse_int(value, placement.priority) && placement.priority >= 0 && placement.priority <= 99;
+            } else {
+                throw fail("unknown key " + key);
+            }
+        } else {
+            throw fail("unknown key " + key);
+        }
+        if (!valid) throw fail("bad value for " + key + ": " + value);
+    }
+    return config;
+}
+
+bool apply_thread_placement(const ThreadPlacement& placement, std::string& error) {
+    if (placement.core >= CPU_SETSIZE) {
+        error = "no core " + std::to_string(placement.core);
+        return false;
+    }
+    if (placement.core >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(placement.core, &cpus);
+        int result = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (result != 0) {
+            error = "cannot pin to core " + std::to_string(placement.core) + ": " + std::strerror(result);
+            return false;
+        }
+    }
+    if (placement.priority > 0) {
+        sched_param param{};
+        param.sched_priority = placement.priority;
+        int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (result != 0) {
+            error = "cannot set SCHED_FIFO priority " + std::to_string(placement.priority) + ": " +
+                    std::strerror(result);
+            return false;
+        }
+    }
+    return true;
+}
+
+Runtime::Runtime(RuntimeConfig config) : settings(std::move(config)) {}
+
+void Runtime::start() {
+    std::vector<std::string> problems = preflight();
+    if (!problems.empty()) {
+        if (settings.strict) {
+            std::string message = "Runtime: preflight failed:";
+            for (const std::string& problem : problems) message += "\n  " + problem;
+            throw std::runtime_error(message);
+        }
+        for (const std::string& problem : problems) {
+            std::cerr << "Runtime: warning: " << problem << "\n";
+        }
+    }
+
+    if (settings.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        std::string problem = std::string{"cannot lock memory: "} + std::strerror(errno);
+        if (settings.strict) throw std::runtime_error("Runtime: " + problem);
+        std::cerr << "Runtime: warning: " << problem << "\n";
+    }
+}
+
+std::vector<std::string> Runtime::preflight() const {
+    std::vector<std::string> problems;
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool know_allowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    const std::string cpu_root = settings.sysfs + "/devices/system/cpu/";
+    const std::set<int> isolated = parse_cpu_list(read_line(cpu_root + "isolated"));
+    const std::set<int> tickless = parse_cpu_list(read_line(cpu_root + "nohz_full"));
+
+    std::map<int, std::string> core_owner;
+    bool wants_fifo = false;
+    for (const auto& [role, placement] : settings.threads) {
+        wants_fifo |= placement.priority > 0;
+        if (placement.core < 0) continue;
+        const int core = placement.core;
+        const std::string who = role + " (core " + std::to_string(core) + ")";
+
+        if (core >= CPU_SETSIZE || (know_allowed && !CPU_ISSET(core, &allowed))) {
+            problems.push_back(who + ": core not in the process's allowed CPUs");
+            continue;
+        }
+        if (!isolated.count(core)) {
+            problems.push_back(who + ": core not isolated (isolcpus); other tasks may run on it");
+        }
+        if (!tickless.count(core)) {
+            problems.push_back(who + ": core not in nohz_full; the scheduler tick interrupts it");
+        }
+        const std::string governor = read_line(cpu_path(settings, core, "cpufreq/scaling_governor"));
+        if (!governor.empty() && governor != "performance") {
+            problems.push_back(who + ": frequency governor is " + governor + ", not performance");
+        }
+
+        auto [owner, inserted] = core_owner.emplace(core, role);
+        if (!inserted) {
+            problems.push_back(who + ": core shared with " + owner->second);
+        }
+    }
+
+    // Hyperthread siblings share a core's execution units and caches
+    for (const auto& [core, role] : core_owner) {
+        for (int sibling : parse_cpu_list(read_line(cpu_path(settings, core, "topology/thread_siblings_list")))) {
+            auto other = core_owner.find(sibling);
+            if (sibling > core && other != core_owner.end()) {
+                problems.push_back(role + " (core " + std::to_string(core) + "): hyperthread sibling of " +
+                                   other->second + " (core " + std::to_string(sibling) + ")");
+            }
+        }
+    }
+
+    if (wants_fifo) {
+        rlimit limit{};
+        getrlimit(RLIMIT_RTPRIO, &limit);
+        int highest = 0;
+        for (const auto& [role, placement] : settings.threads) {
+            if (placement.priority > highest) highest = placement.priority;
+        }
+        if (geteuid() != 0 && limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < static_cast<rlim_t>(highest)) {
+            problems.push_back("SCHED_FIFO priority " + std::to_string(highest) + " above RLIMIT_RTPRIO " +
+                               std::to_string(limit.rlim_cur));
+        }
+    }
+
+    if (settings.lock_memory) {
+        rlimit limit{};
+        getrlimit(RLIMIT_MEMLOCK, &limit);
+        if (geteuid() != 0 && limit.rlim_cur != RLIM_INFINITY) {
+            problems.push_back("lock_memory with RLIMIT_MEMLOCK of " + std::to_string(limit.rlim_cur) +
+                               " bytes; mlockall may fail or later allocations may");
+        }
+    }
+    return problems;
+}
+
+ThreadPlacement Runtime::placement_of(const std::string& role) const {
+    auto it = settings.threads.find(role);
+    return it == settings.threads.end() ? ThreadPlacement{} : it->second;
+}
+
+void Runtime::place(const std::string& role, const ThreadPlacement& placement) const {
+    std::string error;
+    if (apply_thread_placement(placement, error)) return;
+    std::cerr << "Runtime: " << role << ": " << error << "\n";
+    if (settings.strict) std::abort();
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Where one latency-critical thread runs
+struct ThreadPlacement {
+    int core = -1;     // pinned to this CPU; -1 leaves it to the scheduler
+    int priority = 0;  // SCHED_FIFO priority 1-99; 0 keeps SCHED_OTHER
+};
+
+// How a deployment runs its threads: one file, so every host is tuned the
+// same way. The file is lines of `key = value`, `#` starting a comment:
+//
+//     lock_memory = true
+//     strict = true
+//     thread.feed.core = 2
+//     thread.feed.priority = 80
+//     thread.matching.core = 3
+//     thread.publisher.core = 4
+//
+// Thread names are the roles the program asks Runtime::launch for; see
+// runtime.conf for the ones this repo uses.
+struct RuntimeConfig {
+    // mlockall(MCL_CURRENT | MCL_FUTURE) at start(), so no page of the
+    // process is ever paged out or faulted in on a hot path
+    bool lock_memory = false;
+    // Preflight problems stop start() instead of being printed
+    bool strict = false;
+    std::map<std::string, ThreadPlacement> threads;
+    // Root of the sysfs tree preflight reads; only tests change it
+    std::string sysfs = "/sys";
+};
+
+// Parses a config file as above. Throws std::runtime_error naming the file
+// and line if it cannot be read, a key is unknown or a value is malformed.
+RuntimeConfig load_runtime_config(const std::string& path);
+
+// Pins and prioritises the calling thread. Returns false, with a reason in
+// error, if the kernel refused either (the thread then runs as before).
+bool apply_thread_placement(const ThreadPlacement& placement, std::string& error);
+
+// Starts the process's latency-critical threads as configured.
+//
+// start() runs a preflight check and then locks memory. The check looks
+// for what silently adds latency: a pinned core outside the process's
+// allowed set, or not isolated from the scheduler (isolcpus) and from the
+// tick (nohz_full); a core not running the performance governor; two
+// roles on one core or on hyperthread siblings; SCHED_FIFO asked for
+// without RLIMIT_RTPRIO to allow it; and mlockall asked for under a
+// RLIMIT_MEMLOCK too small to honour it. The problems are printed, or
+// with strict set, start() throws std::runtime_error listing them.
+//
+// launch() then starts each role's thread; the thread places itself
+// before it runs the body, so nothing of the body runs on the wrong core.
+class Runtime {
+public:
+    explicit Runtime(RuntimeConfig config);
+
+    // Preflight and mlockall; call once before the first launch()
+    void start();
+
+    // Runs the checks start() runs; returns the problems found
+    std::vector<std::string> preflight() const;
+
+    // Runs body on a new thread placed as role is configured; a role not
+    // in the config runs unplaced. Failing to apply the placement aborts
+    // the process if strict, else is printed.
+    template<typename Body>
+    std::thread launch(const std::string& role, Body&& body) {
+        ThreadPlacement placement = placement_of(role);
+        return std::thread([this, role, placement, body = std::forward<Body>(body)]() mutable {
+            place(role, placement);
+            body();
+        });
+    }
+
+    ThreadPlacement placement_of(const std::string& role) const;
+    const RuntimeConfig& config() const { return settings; }
+
+private:
+    void place(const std::string& role, const ThreadPlacement& placement) const;
+
+    RuntimeConfig settings;
+};
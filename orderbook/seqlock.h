@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Single-writer sequence lock over a trivially copyable value. The writer
+// never waits: it makes the sequence odd, stores the value and makes it even
+// again. Readers copy the value and keep the copy only if the sequence was
+// even and unchanged across it, so any number of them can read concurrently
+// without writing shared memory.
+//
+// The value is held as relaxed atomic words rather than a plain T, so a
+// reader racing a store reads torn but well-defined data that it then
+// discards, instead of racing non-atomic memory.
+template<typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock copies its value word by word");
+
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    alignas(64) std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> words[WORDS] = {};
+
+public:
+    // Writer thread only
+    void store(const T& value) {
+        uint64_t buffer[WORDS] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+
+        const uint64_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Returns false if a store overlapped the copy; out is then unspecified
+    bool try_load(T& out) const {
+        const uint64_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1) return false;
+
+        uint64_t buffer[WORDS];
+        for (size_t i = 0; i < WORDS; ++i) {
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) != before) return false;
+
+        std::memcpy(&out, buffer, sizeof(T));
+        return true;
+    }
+
+    // Retries until a consistent copy is read; waits only while a store is in flight
+    void load(T& out) const {
+        while (!try_load(out)) {
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#endif
+        }
+    }
+};
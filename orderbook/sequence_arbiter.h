@@ -0,0 +1,167 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// An inclusive run of sequence numbers no line delivered
+struct SequenceGap {
+    uint64_t first;
+    uint64_t last;
+};
+
+// First-copy-wins arbitration of one sequenced feed received on several
+// redundant lines (the A and B multicast lines).
+//
+// accept() keeps the copy that arrives first, from whichever line, and
+// drops any later copy. Each decision is O(1): a ring of bits records
+// the sequences seen in a sliding window [expected(), expected() + window)
+// and is cleared as the window moves past them.
+//
+// A hole is not a gap until no line can still fill it. Each line carries
+// the feed in order, so once every line has delivered a sequence past the
+// hole, it is a true gap: it is queued for next_gap(), and only then does
+// the owner need to recover from a snapshot. A silent line would hold
+// holes open forever, so anything that falls out of the bottom of the
+// window is declared lost too. A copy that arrives once the window has
+// passed its sequence (reordered on its line, or from a line more than a
+// window behind) is dropped and counted as late.
+class SequenceArbiter {
+public:
+    // window is rounded up to a power of two of at least 64 sequences
+    explicit SequenceArbiter(size_t lines = 2, size_t window = 1 << 16)
+        : window(std::bit_ceil(window < 64 ? size_t{64} : window))
+        , mask(this->window - 1)
+        , seen(this->window / 64, 0)
+        , high(lines, 0) {
+        if (lines == 0) throw std::invalid_argument("SequenceArbiter: no lines");
+    }
+
+    // Whether this copy of sequence on line is the first: true to deliver
+    // it, false for a duplicate or a late copy
+    bool accept(size_t line, uint64_t sequence) {
+        if (!started) {
+            started = true;
+            base = sequence;
+        }
+        if (sequence + 1 > high[line] && high[line] != CLOSED) {
+            high[line] = sequence + 1;
+        }
+
+        bool first = false;
+        if (sequence < base) {
+            ++late;
+        } else {
+            if (sequence - base >= window) {
+                advance(sequence - window + 1);  // the window's bottom is lost
+            }
+            uint64_t& word = seen[(sequence & mask) / 64];
+            const uint64_t bit = uint64_t{1} << (sequence % 64);
+            if (word & bit) {
+                ++duplicates;
+            } else {
+                word |= bit;
+                first = true;
+            }
+        }
+
+        uint64_t horizon = CLOSED;
+        for (uint64_t line_high : high) {
+            if (line_high < horizon) horizon = line_high;
+        }
+        if (horizon != CLOSED && horizon > base) advance(horizon);
+        return first;
+    }
+
+    // A line that stopped for good no longer holds holes open
+    void close_line(size_t line) { high[line] = CLOSED; }
+
+    // Takes the oldest true gap not yet taken; false if there is none
+    bool next_gap(SequenceGap& gap) {
+        if (gaps_taken == pending_gaps.size()) return false;
+        gap = pending_gaps[gaps_taken++];
+        if (gaps_taken == pending_gaps.size()) {
+            pending_gaps.clear();
+            gaps_taken = 0;
+        }
+        return true;
+    }
+
+    // After recovering from a snapshot that covers everything before next:
+    // forgets the window and any gaps below next
+    void reset(uint64_t next) {
+        std::fill(seen.begin(), seen.end(), 0);
+        started = true;
+        base = next;
+        for (uint64_t& line_high : high) {
+            if (line_high != CLOSED) line_high = next;
+        }
+        pending_gaps.clear();
+        gaps_taken = 0;
+    }
+
+    // Lowest sequence that is neither delivered nor declared lost
+    uint64_t expected() const { return base; }
+
+    uint64_t duplicate_count() const { return duplicates; }
+    uint64_t late_count() const { return late; }
+    uint64_t gap_count() const { return gaps; }
+    uint64_t lost_count() const { return lost; }
+
+private:
+    static constexpr uint64_t CLOSED = ~uint64_t{0};
+
+    // Moves the window's bottom to limit: seen sequences are retired, the
+    // others become gaps. Each word is visited once per 64 sequences.
+    void advance(uint64_t limit) {
+        // Past the window nothing was recorded: all of it is missing
+        const uint64_t end = limit - base > window ? base + window : limit;
+        while (base < end) {
+            const size_t offset = base % 64;
+            uint64_t& word = seen[(base & mask) / 64];
+            const uint64_t bits = word >> offset;
+            const uint64_t span = std::min<uint64_t>(64 - offset, end - base);
+
+            const uint64_t ones = std::min<uint64_t>(std::countr_one(bits), span);
+            if (ones > 0) {
+                word &= ~((ones == 64 ? ~uint64_t{0} : (uint64_t{1} << ones) - 1) << offset);
+                base += ones;
+                continue;
+            }
+            const uint64_t zeros = std::min<uint64_t>(std::countr_zero(bits), span);
+            record_gap(base, base + zeros - 1);
+            base += zeros;
+        }
+        if (base < limit) {
+            record_gap(base, limit - 1);
+            base = limit;
+        }
+    }
+
+    void record_gap(uint64_t first, uint64_t last) {
+        lost += last - first + 1;
+        if (pending_gaps.size() > gaps_taken && pending_gaps.back().last + 1 == first) {
+            pending_gaps.back().last = last;  // continues the one still queued
+            return;
+        }
+        pending_gaps.push_back({first, last});
+        ++gaps;
+    }
+
+    const size_t window;
+    const size_t mask;
+    std::vector<uint64_t> seen;  // sequence s at bit s & mask
+    std::vector<uint64_t> high;  // per line: last sequence delivered + 1
+    bool started = false;
+    uint64_t base = 0;
+
+    std::vector<SequenceGap> pending_gaps;
+    size_t gaps_taken = 0;
+
+    uint64_t duplicates = 0;
+    uint64_t late = 0;
+    uint64_t gaps = 0;
+    uint64_t lost = 0;
+};
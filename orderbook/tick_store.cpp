@@ -0,0 +1,324 @@
+#include "tick_store.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr char MAGIC[8] = {'O', 'B', 'T', 'I', 'C', 'K', 0, 0};
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t HEADER_SIZE = 64;
+    constexpr size_t COLUMNS = 4;  // sequence, timestamp, price, volume
+    enum Column { SEQUENCE, TIMESTAMP, PRICE, VOLUME };
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t block_ticks;
+        uint32_t price_scale;
+        uint32_t reserved0;
+        uint64_t tick_count;
+        uint64_t block_count;
+        uint64_t index_offset;
+        char reserved[HEADER_SIZE - 48];
+    };
+    static_assert(sizeof(FileHeader) == HEADER_SIZE);
+
+    // Followed by the columns, each padded to 8 bytes: value i of a column
+    // is value i - 1 plus min_delta plus its stored delta (count - 1 of them)
+    struct BlockHeader {
+        uint32_t count;
+        uint8_t width[COLUMNS];
+        uint64_t first[COLUMNS];
+        uint64_t min_delta[COLUMNS];
+    };
+    static_assert(sizeof(BlockHeader) == 72);
+
+    struct IndexEntry {
+        uint64_t offset;
+        uint64_t first_sequence;
+        uint64_t first_timestamp_ns;
+        uint64_t last_timestamp_ns;
+        uint32_t count;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(IndexEntry) == 40);
+
+    constexpr size_t padded(size_t bytes) { return (bytes + 7) & ~size_t{7}; }
+
+    size_t column_bytes(uint32_t count, uint8_t width) { return padded(size_t{count - 1} * width); }
+
+    size_t block_bytes(const BlockHeader& header) {
+        size_t bytes = sizeof(BlockHeader);
+        for (size_t c = 0; c < COLUMNS; ++c) bytes += column_bytes(header.count, header.width[c]);
+        return bytes;
+    }
+
+    uint8_t width_of(uint64_t largest) {
+        if (largest == 0) return 0;
+        if (largest <= UINT8_MAX) return 1;
+        if (largest <= UINT16_MAX) return 2;
+        if (largest <= UINT32_MAX) return 4;
+        return 8;
+    }
+
+    // Deltas are taken and added modulo 2^64, so columns that step down
+    // (signed prices, out-of-order timestamps) need no special case
+    template<typename W>
+    void encode_column(const std::vector<uint64_t>& values, uint64_t min_delta, char* out) {
+        for (size_t i = 1; i < values.size(); ++i) {
+            const W stored = static_cast<W>(values[i] - values[i - 1] - min_delta);
+            std::memcpy(out + (i - 1) * sizeof(W), &stored, sizeof(W));
+        }
+    }
+
+    // One loop per width, so each compiles to fixed-size loads and adds
+    template<typename W, typename T, typename Convert>
+    void decode_column(const char* data, uint32_t count, uint64_t first, uint64_t min_delta, T* out,
+                       Convert convert) {
+        uint64_t value = first;
+        out[0] = convert(value);
+        for (uint32_t i = 1; i < count; ++i) {
+            W stored;
+            std::memcpy(&stored, data + (i - 1) * sizeof(W), sizeof(W));
+            value += min_delta + stored;
+            out[i] = convert(value);
+        }
+    }
+
+    template<typename T, typename Convert>
+    void decode_column(const BlockHeader& header, size_t c, const char* data, T* out, Convert convert) {
+        const uint32_t count = header.count;
+        const uint64_t first = header.first[c];
+        const uint64_t min_delta = header.min_delta[c];
+        switch (header.width[c]) {
+            case 0:
+                for (uint32_t i = 0; i < count; ++i) out[i] = convert(first + i * min_delta);
+                break;
+            case 1: decode_column<uint8_t>(data, count, first, min_delta, out, convert); break;
+            case 2: decode_column<uint16_t>(data, count, first, min_delta, out, convert); break;
+            case 4: decode_column<uint32_t>(data, count, first, min_delta, out, convert); break;
+            default: decode_column<uint64_t>(data, count, first, min_delta, out, convert); break;
+        }
+    }
+}
+
+TickStoreWriter::TickStoreWriter(const TickStoreConfig& config) : config(config) {
+    if (config.block_ticks == 0 || config.block_ticks > UINT32_MAX) {
+        throw std::invalid_argument("TickStoreWriter: block_ticks must be between 1 and 2^32 - 1");
+    }
+    if (config.price_scale == 0) throw std::invalid_argument("TickStoreWriter: price_scale must be positive");
+
+    fd = open(config.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) throw std::runtime_error("TickStoreWriter: cannot create " + config.path);
+    for (auto& column : columns) column.reserve(config.block_ticks);
+    buffer.resize(sizeof(BlockHeader) + COLUMNS * padded(config.block_ticks * sizeof(uint64_t)));
+
+    // The header is written last, once the index is in place; until then
+    // the file reads as no store at all
+    const FileHeader blank{};
+    write_all(&blank, sizeof(blank));
+    offset = HEADER_SIZE;
+}
+
+TickStoreWriter::~TickStoreWriter() {
+    if (fd < 0) return;
+    try {
+        finish();
+    } catch (const std::exception&) {
+        close(fd);
+    }
+}
+
+bool TickStoreWriter::append(const MarketTick& tick) {
+    const double scaled = tick.price * config.price_scale;
+    if (!(std::fabs(scaled) < 0x1p62)) return false;
+    const int64_t units = std::llround(scaled);
+    if (static_cast<double>(units) / config.price_scale != tick.price) return false;
+
+    columns[SEQUENCE].push_back(tick.sequence);
+    columns[TIMESTAMP].push_back(tick.timestamp_ns);
+    columns[PRICE].push_back(static_cast<uint64_t>(units));
+    columns[VOLUME].push_back(tick.volume);
+    ++ticks;
+    if (columns[SEQUENCE].size() == config.block_ticks) write_block();
+    return true;
+}
+
+void TickStoreWriter::write_block() {
+    BlockHeader header{};
+    header.count = static_cast<uint32_t>(columns[SEQUENCE].size());
+    char* out = buffer.data() + sizeof(BlockHeader);
+    for (size_t c = 0; c < COLUMNS; ++c) {
+        const std::vector<uint64_t>& values = columns[c];
+        uint64_t min_delta = 0;
+        uint64_t max_delta = 0;
+        if (values.size() > 1) {
+            // Smallest and largest as signed steps, so a column that only
+            // steps down still packs into few bytes
+            int64_t low = INT64_MAX;
+            int64_t high = INT64_MIN;
+            for (size_t i = 1; i < values.size(); ++i) {
+                const int64_t delta = static_cast<int64_t>(values[i] - values[i - 1]);
+                low = std::min(low, delta);
+                high = std::max(high, delta);
+            }
+            min_delta = static_cast<uint64_t>(low);
+            max_delta = static_cast<uint64_t>(high);
+        }
+        header.first[c] = values[0];
+        header.min_delta[c] = min_delta;
+        header.width[c] = width_of(max_delta - min_delta);
+        switch (header.width[c]) {
+            case 0: break;
+            case 1: encode_column<uint8_t>(values, min_delta, out); break;
+            case 2: encode_column<uint16_t>(values, min_delta, out); break;
+            case 4: encode_column<uint32_t>(values, min_delta, out); break;
+            default: encode_column<uint64_t>(values, min_delta, out); break;
+        }
+        const size_t bytes = column_bytes(header.count, header.width[c]);
+        std::memset(out + (size_t{header.count - 1} * header.width[c]), 0,
+                    bytes - size_t{header.count - 1} * header.width[c]);
+        out += bytes;
+    }
+    std::memcpy(buffer.data(), &header, sizeof(header));
+
+    IndexEntry entry{};
+    entry.offset = offset;
+    entry.first_sequence = columns[SEQUENCE][0];
+    entry.first_timestamp_ns = columns[TIMESTAMP][0];
+    entry.last_timestamp_ns = *std::max_element(columns[TIMESTAMP].begin(), columns[TIMESTAMP].end());
+    entry.count = header.count;
+    const char* bytes = reinterpret_cast<const char*>(&entry);
+    index.insert(index.end(), bytes, bytes + sizeof(entry));
+
+    const size_t length = static_cast<size_t>(out - buffer.data());
+    write_all(buffer.data(), length);
+    offset += length;
+    for (auto& column : columns) column.clear();
+}
+
+void TickStoreWriter::finish() {
+    if (fd < 0) return;
+    if (!columns[SEQUENCE].empty()) write_block();
+
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.block_ticks = static_cast<uint32_t>(config.block_ticks);
+    header.price_scale = config.price_scale;
+    header.tick_count = ticks;
+    header.block_count = index.size() / sizeof(IndexEntry);
+    header.index_offset = offset;
+    write_all(index.data(), index.size());
+    if (pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+        throw std::runtime_error("TickStoreWriter: cannot write " + config.path);
+    }
+    close(fd);
+    fd = -1;
+}
+
+void TickStoreWriter::write_all(const void* data, size_t size) {
+    const char* next = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t written = write(fd, next, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("TickStoreWriter: cannot write " + config.path);
+        }
+        next += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+TickStoreReader::TickStoreReader(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("TickStoreReader: cannot open " + path);
+    struct stat st;
+    fstat(fd, &st);
+    size = static_cast<size_t>(st.st_size);
+    void* mapping = size >= HEADER_SIZE ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapping == MAP_FAILED) throw std::runtime_error("TickStoreReader: " + path + " is not a tick store");
+    base = static_cast<const char*>(mapping);
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    auto corrupt = [&] {
+        munmap(const_cast<char*>(base), size);
+        base = nullptr;
+        return std::runtime_error("TickStoreReader: " + path + " is not an intact tick store");
+    };
+
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.block_ticks == 0 || header.price_scale == 0 || header.index_offset < HEADER_SIZE ||
+        header.index_offset > size || header.block_count > (size - header.index_offset) / sizeof(IndexEntry)) {
+        throw corrupt();
+    }
+    ticks = header.tick_count;
+    max_block_ticks = header.block_ticks;
+    scale = header.price_scale;
+
+    blocks.reserve(header.block_count);
+    uint64_t total = 0;
+    for (uint64_t b = 0; b < header.block_count; ++b) {
+        IndexEntry entry;
+        std::memcpy(&entry, base + header.index_offset + b * sizeof(IndexEntry), sizeof(entry));
+        BlockHeader block;
+        if (entry.offset < HEADER_SIZE || entry.offset % 8 != 0 || entry.offset > header.index_offset ||
+            header.index_offset - entry.offset < sizeof(BlockHeader)) {
+            throw corrupt();
+        }
+        std::memcpy(&block, base + entry.offset, sizeof(block));
+        bool widths_valid = true;
+        for (uint8_t width : block.width) widths_valid &= width == 0 || width == 1 || width == 2 || width == 4 || width == 8;
+        if (!widths_valid || block.count == 0 || block.count != entry.count || block.count > header.block_ticks ||
+            block_bytes(block) > header.index_offset - entry.offset) {
+            throw corrupt();
+        }
+        blocks.push_back({{entry.first_sequence, entry.first_timestamp_ns, entry.last_timestamp_ns, entry.count},
+                          base + entry.offset});
+        total += entry.count;
+    }
+    if (total != ticks) throw corrupt();
+}
+
+TickStoreReader::~TickStoreReader() {
+    if (base) munmap(const_cast<char*>(base), size);
+}
+
+size_t TickStoreReader::find_block(uint64_t timestamp_ns) const {
+    const auto it = std::partition_point(blocks.begin(), blocks.end(), [&](const Block& block) {
+        return block.info.last_timestamp_ns < timestamp_ns;
+    });
+    return static_cast<size_t>(it - blocks.begin());
+}
+
+size_t TickStoreReader::decode(size_t i, TickColumns& out) const {
+    BlockHeader header;
+    std::memcpy(&header, blocks[i].data, sizeof(header));
+    out.sequence.resize(header.count);
+    out.timestamp_ns.resize(header.count);
+    out.price.resize(header.count);
+    out.volume.resize(header.count);
+
+    const char* data = blocks[i].data + sizeof(BlockHeader);
+    auto same = [](uint64_t value) { return value; };
+    const double divisor = scale;
+    decode_column(header, SEQUENCE, data, out.sequence.data(), same);
+    data += column_bytes(header.count, header.width[SEQUENCE]);
+    decode_column(header, TIMESTAMP, data, out.timestamp_ns.data(), same);
+    data += column_bytes(header.count, header.width[TIMESTAMP]);
+    decode_column(header, PRICE, data, out.price.data(),
+                  [divisor](uint64_t value) { return static_cast<double>(static_cast<int64_t>(value)) / divisor; });
+    data += column_bytes(header.count, header.width[PRICE]);
+    decode_column(header, VOLUME, data, out.volume.data(),
+                  [](uint64_t value) { return static_cast<uint32_t>(value); });
+    return header.count;
+}
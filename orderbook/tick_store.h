@@ -0,0 +1,136 @@
+#pragma once
+#include "market_tick.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Columnar on-disk store of recorded MarketTicks, for replay and analytics.
+//
+// The file is a 64-byte header, then blocks of up to block_ticks ticks, then
+// an index of one entry per block. A block holds each field of its ticks
+// (sequence, timestamp, price, volume) as a separate column of deltas: the
+// block header keeps a column's first value and smallest delta, and the
+// column stores each further delta minus that smallest one in the fewest
+// whole bytes (0, 1, 2, 4 or 8) that fit the block's largest. Sequences
+// counting up by one take no bytes at all, and nearby timestamps and prices
+// a byte or two each. Prices are stored as integer multiples of
+// 1 / price_scale and come back exactly as recorded.
+//
+// Everything is little-endian host order, as the journal is.
+struct TickStoreConfig {
+    std::string path;
+    size_t block_ticks = 4096;
+    // Price units per 1.0, e.g. 100 for prices in cents
+    uint32_t price_scale = 100;
+};
+
+// One decoded block, a column per field; every column has size() entries.
+// The vectors are reused from block to block, so decoding into the same
+// TickColumns allocates only for the first block.
+struct TickColumns {
+    std::vector<uint64_t> sequence;
+    std::vector<uint64_t> timestamp_ns;
+    std::vector<double> price;
+    std::vector<uint32_t> volume;
+
+    size_t size() const { return sequence.size(); }
+};
+
+struct TickBlockInfo {
+    uint64_t first_sequence;
+    uint64_t first_timestamp_ns;
+    uint64_t last_timestamp_ns;  // largest in the block
+    uint32_t count;
+};
+
+// Records ticks into a new store at config.path, replacing any file there.
+// Ticks are buffered a block at a time and each full block is written with
+// one write(); finish() writes the last block, the index and the header.
+// Throws std::invalid_argument for a bad config and std::runtime_error if
+// the file cannot be created or written.
+class TickStoreWriter {
+public:
+    explicit TickStoreWriter(const TickStoreConfig& config);
+    // Finishes the store if finish() was not called; errors are dropped
+    ~TickStoreWriter();
+
+    TickStoreWriter(const TickStoreWriter&) = delete;
+    TickStoreWriter& operator=(const TickStoreWriter&) = delete;
+
+    // Returns false, storing nothing, if tick.price is not a multiple of
+    // 1 / price_scale. receive_ns is not stored.
+    bool append(const MarketTick& tick);
+    void finish();
+
+    uint64_t tick_count() const { return ticks; }
+
+private:
+    void write_block();
+    void write_all(const void* data, size_t size);
+
+    TickStoreConfig config;
+    int fd = -1;
+    uint64_t ticks = 0;
+    uint64_t offset = 0;  // where the next block goes
+    // The block being filled, one column per field as integers
+    std::vector<uint64_t> columns[4];
+    std::vector<char> buffer;
+    std::vector<char> index;
+};
+
+// Reads a store through one read-only mapping advised MADV_SEQUENTIAL, so
+// the kernel reads ahead of a replay and drops the pages behind it.
+// Opening checks the header, the index and every block header against the
+// file size, so decoding never reads out of bounds. Throws
+// std::runtime_error if path cannot be read or is not an intact store.
+class TickStoreReader {
+public:
+    explicit TickStoreReader(const std::string& path);
+    ~TickStoreReader();
+
+    TickStoreReader(const TickStoreReader&) = delete;
+    TickStoreReader& operator=(const TickStoreReader&) = delete;
+
+    uint64_t tick_count() const { return ticks; }
+    size_t block_count() const { return blocks.size(); }
+    size_t block_ticks() const { return max_block_ticks; }
+    uint32_t price_scale() const { return scale; }
+    const TickBlockInfo& block(size_t i) const { return blocks[i].info; }
+
+    // The first block that may hold a tick at or after timestamp_ns
+    // (block_count() if none), for timestamps recorded in order
+    size_t find_block(uint64_t timestamp_ns) const;
+
+    // Decodes block i into out and returns its tick count
+    size_t decode(size_t i, TickColumns& out) const;
+
+    // Calls on_tick(const MarketTick&) for every tick from block first_block
+    // on, decoding one block at a time. Returns the number of ticks.
+    template<typename F>
+    uint64_t for_each(F&& on_tick, size_t first_block = 0) const {
+        TickColumns columns;
+        uint64_t count = 0;
+        for (size_t b = first_block; b < blocks.size(); ++b) {
+            const size_t n = decode(b, columns);
+            for (size_t i = 0; i < n; ++i) {
+                on_tick(MarketTick{columns.sequence[i], columns.timestamp_ns[i], columns.price[i],
+                                   columns.volume[i], 0});
+            }
+            count += n;
+        }
+        return count;
+    }
+
+private:
+    struct Block {
+        TickBlockInfo info;
+        const char* data;  // the block header
+    };
+
+    const char* base = nullptr;
+    size_t size = 0;
+    uint64_t ticks = 0;
+    size_t max_block_ticks = 0;
+    uint32_t scale = 0;
+    std::vector<Block> blocks;
+};
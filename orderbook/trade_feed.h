@@ -0,0 +1,29 @@
+#pragma once
+#include "../SPSC_QUEUES/shm_broadcast_ring.h"
+#include <cstdint>
+
+// Who took liquidity in a fill: the buyer, the seller, or neither (an
+// auction uncross, where both orders rested)
+enum class Aggressor : uint8_t { BUY, SELL, AUCTION };
+
+// One fill as the processes outside the matching thread see it: the trade
+// print plus what drop-copy and risk need to attribute it. Prices are
+// doubles whatever the book's PriceT, as on the market-data channel.
+struct TradeReport {
+    uint64_t buy_order_id;
+    uint64_t sell_order_id;
+    double price;
+    uint64_t quantity;
+    uint64_t timestamp_ns;
+    uint32_t buy_owner_id;   // 0: no account
+    uint32_t sell_owner_id;
+    Aggressor aggressor;
+};
+
+// Every fill of a book, published from inside the matching loop into a
+// shared-memory broadcast ring (see shm_broadcast_ring.h): a few relaxed
+// stores per fill and no syscall on the matching thread. Readers in other
+// processes attach with TradeFeedReader under the same name; the ring
+// position doubles as the fill's sequence number.
+using TradeFeed = ShmBroadcastWriter<TradeReport>;
+using TradeFeedReader = ShmBroadcastReader<TradeReport>;